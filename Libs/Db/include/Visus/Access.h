@@ -41,6 +41,11 @@ For support : support@visus.net
 
 #include <Visus/Db.h>
 #include <Visus/BlockQuery.h>
+#include <Visus/BlockSummary.h>
+#include <Visus/CriticalSection.h>
+
+#include <map>
+#include <functional>
 
 namespace Visus {
 
@@ -50,14 +55,40 @@ class VISUS_DB_API AccessStatistics
 {
 public:
 
-  Int64 rok = 0, rfail = 0;
-  Int64 wok = 0, wfail = 0;
+#if SWIG
+  //the generated wrappers read/assign them as Int64, which std::atomic supports
+  Int64 rok, rfail;
+  Int64 wok, wfail;
+  Int64 rcoalesced;
+#else
+  //atomic since an Access can complete block queries from several threads (e.g. IdxDiskAccess nthreads>1)
+  std::atomic<Int64> rok, rfail;
+  std::atomic<Int64> wok, wfail;
+  std::atomic<Int64> rcoalesced; //reads served by an in-flight read of the same block (see CoalescedReads)
+#endif
+
+  //constructor
+  AccessStatistics() : rok(0), rfail(0), wok(0), wfail(0), rcoalesced(0) {
+  }
+
+  //copy constructor
+  AccessStatistics(const AccessStatistics& other) : rok((Int64)other.rok), rfail((Int64)other.rfail), wok((Int64)other.wok), wfail((Int64)other.wfail), rcoalesced((Int64)other.rcoalesced) {
+  }
+
+  //operator=
+  AccessStatistics& operator=(const AccessStatistics& other) {
+    rok = (Int64)other.rok; rfail = (Int64)other.rfail;
+    wok = (Int64)other.wok; wfail = (Int64)other.wfail;
+    rcoalesced = (Int64)other.rcoalesced;
+    return *this;
+  }
 
   //reset
   void reset()
   {
     rok = rfail = 0;
     wok = wfail = 0;
+    rcoalesced = 0;
   }
 };
 
@@ -138,12 +169,12 @@ public:
   }
 
   //getStartAddress
-  Int64 getStartAddress(Int64 block_id) const {
+  BigInt getStartAddress(BigInt block_id) const {
     return block_id * getSamplesPerBlock();
   }
 
   //getEndAddress
-  Int64 getEndAddress(Int64 block_id) const {
+  BigInt getEndAddress(BigInt block_id) const {
     return (block_id + 1) * getSamplesPerBlock();
   }
 
@@ -177,9 +208,24 @@ public:
   //readBlock
   virtual void readBlock(SharedPtr<BlockQuery> query) = 0;
 
+  //readBlocks (independent reads submitted together, an access can override it to sort/merge them)
+  virtual void readBlocks(std::vector< SharedPtr<BlockQuery> > queries) {
+    for (auto query : queries)
+      readBlock(query);
+  }
+
   //writeBlock
   virtual void writeBlock(SharedPtr<BlockQuery> query) = 0;
 
+  //encodeBlock (thread safe, can be called before writeBlock to move the encoding out of the writing thread)
+  virtual void encodeBlock(SharedPtr<BlockQuery> query) {
+  }
+
+  //readBlockSummary (metadata only, false if the summary is not available, see BlockSummary)
+  virtual bool readBlockSummary(Field field, double time, BigInt blockid, BlockSummary& summary) {
+    return false;
+  }
+
   //beginRead
   void beginRead() {
     beginIO('r');
@@ -223,8 +269,8 @@ public:
   virtual void printStatistics()
   {
     PrintInfo("type", typeid(*this).name(), "chmod", can_read ? "r" : "", can_write ? "w" : "", "bitsperblock", bitsperblock);
-    PrintInfo("rok", statistics.rok, "rfail", statistics.rfail);
-    PrintInfo("wok", statistics.wok, "wfail", statistics.wfail);
+    PrintInfo("rok", (Int64)statistics.rok, "rfail", (Int64)statistics.rfail, "rcoalesced", (Int64)statistics.rcoalesced);
+    PrintInfo("wok", (Int64)statistics.wok, "wfail", (Int64)statistics.wfail);
   }
 
   //write
@@ -290,6 +336,89 @@ private:
 
 }; //end class
 
+
+#if !SWIG
+///////////////////////////////////////////////////////////////////////////////////////
+//single-flight reads: concurrent reads of the same (field,time,blockid) share one downstream fetch, even between different Access instances of the same source
+//the first query is the leader and is fetched as usual, the others wait for it and get the same (shared) buffer
+//if the leader is aborted (or its access destroyed), the first waiter still alive is fetched again
+//aborted waiters are failed as soon as possible, without waiting for the leader
+class VISUS_DB_API CoalescedReads
+{
+public:
+
+  VISUS_NON_COPYABLE_CLASS(CoalescedReads)
+
+  typedef std::function<void(SharedPtr<BlockQuery>)> Fetch;
+
+  //constructor
+  CoalescedReads() {
+  }
+
+  //destructor
+  ~CoalescedReads();
+
+  //getSingleton (accesses with the same <source> share in-flight reads)
+  static SharedPtr<CoalescedReads> getSingleton(String source);
+
+  //readBlock (<fetch> is called from the calling thread, <refetch> can be called from any thread to restart a read, by default it's <fetch>)
+  void readBlock(Access* access, SharedPtr<BlockQuery> query, Fetch fetch, Fetch refetch = Fetch());
+
+  //detach (must be called by the access destructor: its waiters are failed and the access is never called back again)
+  void detach(Access* access);
+
+  //failAborted
+  void failAborted();
+
+private:
+
+  //the access of a reader, cleared by detach (the lock is held while calling back the access)
+  class Owner
+  {
+  public:
+    std::recursive_mutex lock;
+    Access*              access = nullptr;
+  };
+
+  class Reader
+  {
+  public:
+    SharedPtr<Owner>      owner;
+    SharedPtr<BlockQuery> query;
+    Fetch                 refetch;
+  };
+
+  class Inflight
+  {
+  public:
+    Reader              leader;
+    std::vector<Reader> waiters;
+  };
+
+  String          source;
+  CriticalSection lock;
+
+  std::map<String, Inflight>            inflight;
+  std::map<Access*, SharedPtr<Owner> >  owners;
+
+  //startRead
+  void startRead(String key, Reader leader, Fetch fetch);
+
+  //readDone
+  void readDone(String key, Reader leader);
+
+  //restartRead (a new leader is needed since <leader> is not going to complete the read)
+  void restartRead(String key, SharedPtr<BlockQuery> leader);
+
+  //takeWaiters (lock must be held)
+  std::vector<Reader> takeWaiters(std::function<bool(const Reader&)> pred);
+
+  //notify
+  static void notify(Reader reader, SharedPtr<BlockQuery> from, String errormsg);
+
+};
+#endif
+
 } //namespace Visus
 
 #endif //__VISUS_DB_ACCESS_H
@@ -0,0 +1,122 @@
+/*-----------------------------------------------------------------------------
+Copyright(c) 2010 - 2018 ViSUS L.L.C.,
+Scientific Computing and Imaging Institute of the University of Utah
+
+ViSUS L.L.C., 50 W.Broadway, Ste. 300, 84101 - 2044 Salt Lake City, UT
+University of Utah, 72 S Central Campus Dr, Room 3750, 84112 Salt Lake City, UT
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met :
+
+* Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED.IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+For additional information about this project contact : pascucci@acm.org
+For support : support@visus.net
+-----------------------------------------------------------------------------*/
+
+#ifndef __VISUS_DB_ARCO_SHARD_H
+#define __VISUS_DB_ARCO_SHARD_H
+
+#include <Visus/Db.h>
+#include <Visus/HeapMemory.h>
+
+namespace Visus {
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//container file packing <nblocks> consecutive ARCO blocks (i.e. one encoded blob for each block), to avoid millions of tiny files
+//the index has a fixed size and is at the beginning of the file, so a block can be read with one range read (plus the index, usually cached)
+/*
+  [Int32 magic][Int32 version][Int64 nblocks]
+  nblocks * [Int64 offset][Int64 size]         (network byte order, offset==0 means block not stored)
+  encoded blocks (appended in writing order, a rewritten block reuses its space if it fits)
+*/
+class VISUS_DB_API ArcoShard
+{
+public:
+
+  VISUS_CLASS(ArcoShard)
+
+  static const Int32 Magic   = 0x56534844; //VSHD
+  static const Int32 Version = 1;
+
+  //Entry
+  class Entry
+  {
+  public:
+    Int64 offset = 0;
+    Int64 size = 0;
+  };
+
+  std::vector<Entry> entries;
+
+  //constructor
+  ArcoShard(int nblocks = 0) : entries(nblocks) {
+  }
+
+  //getNumberOfBlocks
+  int getNumberOfBlocks() const {
+    return (int)entries.size();
+  }
+
+  //getHeaderSize
+  static Int64 getHeaderSize(int nblocks) {
+    return 16 + 16 * (Int64)nblocks;
+  }
+
+  //getFirstBlock (i.e. the block used to generate the shard filename)
+  static BigInt getFirstBlock(BigInt blockid, int nblocks) {
+    return blockid - getBlockPosition(blockid, nblocks);
+  }
+
+  //getBlockPosition
+  static int getBlockPosition(BigInt blockid, int nblocks) {
+    VisusAssert(blockid >= 0 && nblocks > 0);
+    return (int)cint64(blockid % nblocks);
+  }
+
+  //getEntry
+  const Entry& getEntry(BigInt blockid) const {
+    return entries[getBlockPosition(blockid, getNumberOfBlocks())];
+  }
+
+  //setEntry
+  void setEntry(BigInt blockid, Int64 offset, Int64 size) {
+    auto& entry = entries[getBlockPosition(blockid, getNumberOfBlocks())];
+    entry.offset = offset;
+    entry.size = size;
+  }
+
+  //encodeHeader
+  SharedPtr<HeapMemory> encodeHeader() const;
+
+  //decodeHeader (false if <header> is not the header of a shard with <nblocks> blocks)
+  bool decodeHeader(SharedPtr<HeapMemory> header, int nblocks);
+
+};
+
+} //namespace Visus
+
+#endif //__VISUS_DB_ARCO_SHARD_H
+
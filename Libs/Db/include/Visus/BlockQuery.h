@@ -84,6 +84,13 @@ public:
   int          H = 0;
   LogicSamples logic_samples;
 
+  //(optional) buffer already encoded with <compression>, see Access::encodeBlock
+  SharedPtr<HeapMemory> encoded;
+  String                compression;
+
+  //if true, a reading Access keeps the bytes it decoded in <encoded>/<compression> (e.g. to cache them verbatim)
+  bool                  bKeepEncoded = false;
+
   //constructor
   BlockQuery() {
   }
@@ -0,0 +1,130 @@
+/*-----------------------------------------------------------------------------
+Copyright(c) 2010 - 2018 ViSUS L.L.C.,
+Scientific Computing and Imaging Institute of the University of Utah
+
+ViSUS L.L.C., 50 W.Broadway, Ste. 300, 84101 - 2044 Salt Lake City, UT
+University of Utah, 72 S Central Campus Dr, Room 3750, 84112 Salt Lake City, UT
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met :
+
+* Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED.IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+For additional information about this project contact : pascucci@acm.org
+For support : support@visus.net
+-----------------------------------------------------------------------------*/
+
+#ifndef __VISUS_DB_BLOCK_SUMMARY_H
+#define __VISUS_DB_BLOCK_SUMMARY_H
+
+#include <Visus/Db.h>
+#include <Visus/Array.h>
+#include <Visus/Range.h>
+#include <Visus/Histogram.h>
+#include <Visus/StringTree.h>
+
+namespace Visus {
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//per-block metadata (min, max, mean and a small histogram for each component) computed when the block is written
+//so that ranges, histograms and "which blocks can contain a value" do not need to read/decode the samples
+class VISUS_DB_API BlockSummary
+{
+public:
+
+  VISUS_CLASS(BlockSummary)
+
+  //number of histogram bins stored for each block
+  static const int NumBins = 16;
+
+  //Component
+  class VISUS_DB_API Component
+  {
+  public:
+
+    double              min = 0;
+    double              max = 0;
+    double              mean = 0;
+    std::vector<Int64>  bins; //uniform bins in [min,max]
+
+    //getRange
+    Range getRange() const {
+      return Range(min, max, 0);
+    }
+  };
+
+  bool                    bValid = false;
+  bool                    bMissing = false; //block never written
+  Int64                   nsamples = 0;     //samples inside the dataset logic box
+  std::vector<Component>  components;
+
+  //constructor
+  BlockSummary() {
+  }
+
+  //valid
+  bool valid() const {
+    return bValid;
+  }
+
+  //missing
+  static BlockSummary missing();
+
+  //isConstant
+  bool isConstant() const;
+
+  //isNull (i.e. missing or all samples are zero)
+  bool isNull() const;
+
+  //compute (optional <mask> has one byte for each sample, samples with 0 are not part of the dataset)
+  static BlockSummary compute(Array buffer, const Uint8* mask = nullptr, int nbins = NumBins);
+
+  //mayContain (false if there is no sample of component C inside [range.from,range.to])
+  bool mayContain(Range range, int C = 0) const;
+
+  //merge (min/max/mean/nsamples are exact, bins are redistributed to the merged range; invalid if any summary is invalid)
+  static BlockSummary merge(const std::vector<BlockSummary>& summaries, int nbins = NumBins);
+
+  //getHistogram
+  Histogram getHistogram(int C = 0) const;
+
+  //getRecordSize (fixed size on disk for a certain dtype)
+  static int getRecordSize(DType dtype);
+
+  //writeRecord (network byte order)
+  void writeRecord(Uint8* dst, DType dtype) const;
+
+  //readRecord (returns an invalid summary if the record was never written)
+  static BlockSummary readRecord(const Uint8* src, DType dtype);
+
+  //write
+  void write(Archive& ar) const;
+
+};
+
+} //namespace Visus
+
+#endif //__VISUS_DB_BLOCK_SUMMARY_H
+
@@ -48,6 +48,7 @@ namespace Visus {
 //predeclaration
 class IdxFilter;
 class Dataset;
+class BlockQuery;
 class Access;
 
 //-1 guess progression
@@ -92,6 +93,7 @@ public:
     BoxNi                    domain;
     BoxNi                    adjusted_logic_box;
     SharedPtr<BoxQuery>      query;
+    SharedPtr<BlockQuery>    block0; //raw coefficients of block 0, merged once for each level up to bitsperblock
   }
   filter;
 #endif
@@ -101,6 +103,21 @@ public:
   std::map<String, SharedPtr<BoxQuery> >  down_queries;
 #endif
 
+  //(optional) samples of a previous query (e.g. before a camera move) copied instead of being read again, see Dataset::reuseBoxQuerySamples
+#if !SWIG
+  struct
+  {
+    Array                    buffer;
+    LogicSamples             logic_samples;
+    std::vector<BoxNi>       failed_boxes; //failed_boxes of the previous query (i.e. samples to read again)
+    Int64                    nskipped = 0; //number of blocks not read
+  }
+  reuse;
+
+  //logic boxes of the blocks that could not be read (i.e. samples not valid, see reuse)
+  std::vector<BoxNi> failed_boxes;
+#endif
+
   //internal use only
 #if !SWIG
   std::function<void(Array)> incrementalPublish;
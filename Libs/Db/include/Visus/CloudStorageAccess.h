@@ -43,6 +43,7 @@ For support : support@visus.net
 #include <Visus/Access.h>
 #include <Visus/CloudStorage.h>
 #include <Visus/NetService.h>
+#include <Visus/ArcoShard.h>
 
 namespace Visus {
 
@@ -87,7 +88,33 @@ private:
   SharedPtr<NetService>    netservice;
   SharedPtr<CloudStorage>  cloud_storage;
   String                   filename_template;
+  SharedPtr<CoalescedReads> coalesced_reads;
 
+  //CachedShard
+  class CachedShard
+  {
+  public:
+    Future< SharedPtr<ArcoShard> > index;
+    Int64                          timestamp = 0;
+  };
+
+  //blocks packed in container blobs (0 means one blob for each block), see ArcoShard
+  int                      arco_shard = 0;
+  int                      shard_ttl = 60; //seconds before downloading the index again (the blob can be rewritten), 0 means forever
+  CriticalSection          shards_lock;
+  std::map<String, CachedShard> shards;
+
+  //fetchBlock
+  void fetchBlock(SharedPtr<BlockQuery> query);
+
+  //fetchShard (the index of a container blob, cached for <shard_ttl> seconds)
+  Future< SharedPtr<ArcoShard> > fetchShard(String blob_name);
+
+  //invalidateShard (the cached index does not match the blob anymore)
+  void invalidateShard(String blob_name);
+
+  //blobReady
+  void blobReady(SharedPtr<BlockQuery> query, SharedPtr<CloudStorageItem> blob);
 
 };
 
@@ -57,6 +57,7 @@ namespace Visus {
 
 //predeclaration
 class RamAccess;
+class FastHzOrder;
 
 
 ////////////////////////////////////////////////////////
@@ -123,12 +124,24 @@ public:
   //annotations
   SharedPtr<Annotations> annotations;
 
+  //max number of blocks merged/encoded in parallel on the shared pool for box query writes (0 means VISUS_WRITE_NTHREADS or the shared pool size)
+  int write_nthreads = 0;
+
+  //max number of block merges in flight on the shared pool for box query reads (0 means VISUS_MERGE_NTHREADS or the shared pool size, 1 means merge in the query thread)
+  int merge_nthreads = 0;
+
+  //filtered box queries read block 0 only once for all the levels up to bitsperblock (false means one executeBoxQuery for each level)
+  bool incremental_filter_query = true;
+
   //internal use only
   std::vector<LogicSamples> level_samples;
 
   //internal use only
   std::vector<LogicSamples> block_samples;
 
+  //internal use only (created together with level_samples and block_samples)
+  SharedPtr<FastHzOrder> fast_hzorder;
+
   //constructor
   Dataset() {
   }
@@ -329,6 +342,11 @@ public:
     return level_samples[lvl];
   }
 
+  //getFastHzOrder (can be null if the dataset has no bitmask)
+  SharedPtr<FastHzOrder> getFastHzOrder() const {
+    return fast_hzorder;
+  }
+
 
   //________________________________________________
   //fields stuff
@@ -404,6 +422,9 @@ public:
   //readBlock  
   virtual void executeBlockQuery(SharedPtr<Access> access, SharedPtr<BlockQuery> query);
 
+  //executeBlockQueries (read only, the access gets the whole batch, see Access::readBlocks)
+  virtual void executeBlockQueries(SharedPtr<Access> access, std::vector< SharedPtr<BlockQuery> > queries);
+
   //executeBlockQueryAndWait
   bool executeBlockQueryAndWait(SharedPtr<Access> access, SharedPtr<BlockQuery> query) {
     executeBlockQuery(access, query);
@@ -414,6 +435,15 @@ public:
   //convertBlockQueryToRowMajor
   virtual bool convertBlockQueryToRowMajor(SharedPtr<BlockQuery> block_query);
 
+  //readBlockSummaries (metadata only, one for each block; invalid if the access has no summary for the block, see BlockSummary)
+  std::vector<BlockSummary> readBlockSummaries(SharedPtr<Access> access, Field field, double time);
+
+  //computeFieldSummary (metadata only, range/mean/histogram of the whole field; invalid if some block has no summary)
+  BlockSummary computeFieldSummary(SharedPtr<Access> access, Field field, double time, int nbins = 256);
+
+  //findBlocksInRange (metadata only, blocks that may contain a value of component C inside <range>, blocks with no summary are always included)
+  std::vector<BigInt> findBlocksInRange(SharedPtr<Access> access, Field field, double time, Range range, int C = 0);
+
   //createEquivalentBoxQuery
   virtual SharedPtr<BoxQuery> createEquivalentBoxQuery(int mode, SharedPtr<BlockQuery> block_query)
   {
@@ -453,6 +483,9 @@ public:
   //mergeBoxQueryWithBlockQuery
   virtual bool mergeBoxQueryWithBlockQuery(SharedPtr<BoxQuery> query, SharedPtr<BlockQuery> block_query);
 
+  //writeBlocksForBoxQuery (read/merge/encode in parallel, write in order and grouped by file)
+  virtual bool writeBlocksForBoxQuery(SharedPtr<Access> access, SharedPtr<BoxQuery> query, const std::vector<BigInt>& blocks);
+
   //setBoxQueryEndResolution
   virtual bool setBoxQueryEndResolution(SharedPtr<BoxQuery> query, int value);
 
@@ -528,12 +561,20 @@ public:
     LogicSamples Wsamples, Array Wbuffer,
     LogicSamples Rsamples, Array Rbuffer, Aborted aborted);
 
+  //reuseBoxQuerySamples (copy query->reuse samples into the query buffer, returns the box where all samples are known except query->reuse.failed_boxes)
+  virtual BoxNi reuseBoxQuerySamples(SharedPtr<BoxQuery> query);
+
   //getFilenames
   std::vector<String> getFilenames(int timestep = -1,String field="");
 
   //compressDataset
   virtual void compressDataset(std::vector<String> compression, Array data = Array());;
 
+#if !SWIG
+  //ingestDataset (out-of-core write of a new dataset: <readSlab> returns the samples of a slab along the last axis, only incomplete blocks stay in memory)
+  virtual bool ingestDataset(Field field, double time, std::function<Array(BoxNi)> readSlab, int slab_size = 0, SharedPtr<Access> access = SharedPtr<Access>());
+#endif
+
 public:
 
   //readDatasetFromArchive 
@@ -555,6 +596,9 @@ protected:
   bool                    missing_blocks = false;
   double                  default_accuracy = 0.0; //for idx2
 
+  //beginBlockQuery (checks the query before giving it to the access, false if it failed)
+  bool beginBlockQuery(SharedPtr<Access> access, SharedPtr<BlockQuery> query);
+
 };
 
 ////////////////////////////////////////////////////////////////
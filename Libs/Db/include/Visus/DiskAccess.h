@@ -43,10 +43,14 @@ For support : support@visus.net
 #include <Visus/Access.h>
 #include <Visus/Path.h>
 #include <Visus/IdxFile.h>
+#include <Visus/File.h>
+#include <Visus/ArcoShard.h>
+#include <Visus/CriticalSection.h>
 
 namespace Visus {
 
 class Dataset;
+class DiskCache;
 
 //////////////////////////////////////////////////////////////////////////////
 class VISUS_DB_API DiskAccess : public Access
@@ -68,6 +72,9 @@ public:
   //writeBlock
   virtual void writeBlock(SharedPtr<BlockQuery> query) override;
 
+  //encodeBlock
+  virtual void encodeBlock(SharedPtr<BlockQuery> query) override;
+
   //acquireWriteLock
   virtual void acquireWriteLock(SharedPtr<BlockQuery> query) override;
 
@@ -77,11 +84,35 @@ public:
   //getFilename
   virtual String getFilename(Field field,double time,BigInt blockid) const override;
 
+  //endIO
+  virtual void endIO() override;
+
+  //printStatistics
+  virtual void printStatistics() override;
+
 private:
 
   Dataset* dataset;
   IdxFile idxfile;
   String filename_template;
+  SharedPtr<DiskCache> disk_cache; //only when caching a remote dataset with a size budget
+
+  //blocks packed in container files (0 means one file for each block), see ArcoShard
+  int arco_shard = 0;
+  CriticalSection shards_lock;
+  std::map<String, SharedPtr<ArcoShard> > shards; //index of the containers read in the current IO session
+
+  //readShard
+  SharedPtr<ArcoShard> readShard(File& file);
+
+  //readShardedBlock
+  SharedPtr<HeapMemory> readShardedBlock(String filename, BigInt blockid, String& errormsg);
+
+  //writeShardedBlock
+  bool writeShardedBlock(String filename, BigInt blockid, SharedPtr<HeapMemory> encoded, String& errormsg);
+
+  //compactShard (rewrite the container without the unreferenced bytes)
+  bool compactShard(File& file, String filename, SharedPtr<ArcoShard> shard);
 
 }; 
 
@@ -0,0 +1,159 @@
+/*-----------------------------------------------------------------------------
+Copyright(c) 2010 - 2018 ViSUS L.L.C.,
+Scientific Computing and Imaging Institute of the University of Utah
+
+ViSUS L.L.C., 50 W.Broadway, Ste. 300, 84101 - 2044 Salt Lake City, UT
+University of Utah, 72 S Central Campus Dr, Room 3750, 84112 Salt Lake City, UT
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met :
+
+* Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED.IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+For additional information about this project contact : pascucci@acm.org
+For support : support@visus.net
+-----------------------------------------------------------------------------*/
+
+#ifndef __VISUS_DB_DISKCACHE_H
+#define __VISUS_DB_DISKCACHE_H
+
+#include <Visus/Db.h>
+#include <Visus/CriticalSection.h>
+
+#include <map>
+
+namespace Visus {
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//size-bounded accounting of the files of a local cache directory (see IdxDiskAccess/DiskAccess used for remote datasets)
+//eviction is at file granularity (i.e. a block for DiskAccess, a block file for IdxDiskAccess)
+//usage metadata is saved inside the cache directory so that it survives restarts; processes sharing the directory
+//merge their usage when saving (under a file lock), but each process evicts according to its own view
+class VISUS_DB_API DiskCache
+{
+public:
+
+  VISUS_NON_COPYABLE_CLASS(DiskCache)
+
+  //Statistics
+  class Statistics
+  {
+  public:
+    Int64 hits = 0;
+    Int64 misses = 0;
+    Int64 evictions = 0;
+    Int64 evicted_bytes = 0;
+    Int64 bytes_saved = 0; //decoded bytes served from the cache instead of the remote
+  };
+
+  //constructor
+  DiskCache(String directory, Int64 max_size, String policy = "lru");
+
+  //destructor
+  virtual ~DiskCache();
+
+  //getSingleton (one instance for each cache directory)
+  static SharedPtr<DiskCache> getSingleton(String directory, Int64 max_size, String policy = "lru");
+
+  //getDirectory
+  String getDirectory() const {
+    return directory;
+  }
+
+  //getMaxSize
+  Int64 getMaxSize() const {
+    return max_size;
+  }
+
+  //getUsedSize
+  Int64 getUsedSize();
+
+  //getStatistics
+  Statistics getStatistics();
+
+  //hit (a block has been read from <filename>)
+  void hit(String filename, Int64 nbytes);
+
+  //miss
+  void miss();
+
+  //written (<filename> changed on disk, can evict other files)
+  void written(String filename);
+
+  //pin (<filename> is open, do not evict it until unpin)
+  void pin(String filename);
+
+  //unpin
+  void unpin(String filename);
+
+  //flush
+  void flush();
+
+  //printStatistics
+  void printStatistics();
+
+private:
+
+  class Entry
+  {
+  public:
+    Int64 size = 0;
+    Int64 nhits = 0;
+    Int64 last_access = 0;
+  };
+
+  String                  directory;
+  String                  metadata_filename;
+  Int64                   max_size = 0;
+  String                  policy;        //"lru" or "lfu"
+  CriticalSection         lock;
+  std::map<String, Entry> entries;
+  std::map<String, int>   pinned; //open files, with a reference count
+  Int64                   used_size = 0;
+  Statistics              statistics;
+  bool                    bDirty = false;
+  Int64                   last_save = 0;
+
+  //load
+  void load();
+
+  //loadEntries (from the metadata file)
+  std::map<String, Entry> loadEntries();
+
+  //save
+  void save();
+
+  //saveIfNeeded
+  void saveIfNeeded(bool bForce);
+
+  //evictIfNeeded
+  void evictIfNeeded(const String& keep);
+
+};
+
+} //namespace Visus
+
+#endif //__VISUS_DB_DISKCACHE_H
+
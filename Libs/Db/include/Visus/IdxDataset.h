@@ -52,6 +52,9 @@ class VISUS_DB_API IdxDataset : public Dataset
 {
 public:
 
+  //merge hzorder blocks fully covered by the query with precomputed offset tables instead of the kd traversal
+  bool fast_hzorder_merge = true;
+
   //default constructor
   IdxDataset() {
   }
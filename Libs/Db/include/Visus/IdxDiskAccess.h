@@ -41,6 +41,7 @@ For support : support@visus.net
 
 #include <Visus/Db.h>
 #include <Visus/ThreadPool.h>
+#include <Visus/CriticalSection.h>
 #include <Visus/Access.h>
 #include <Visus/IdxFile.h>
 #include <Visus/File.h>
@@ -49,6 +50,7 @@ namespace Visus {
 
 //predeclaration
 class IdxDataset;
+class DiskCache;
 
 
 //////////////////////////////////////////////////////////////////////////////
@@ -86,9 +88,18 @@ public:
   //readBlock 
   virtual void readBlock(SharedPtr<BlockQuery> query) override;
 
+  //readBlocks
+  virtual void readBlocks(std::vector< SharedPtr<BlockQuery> > queries) override;
+
   //writeBlock
   virtual void writeBlock(SharedPtr<BlockQuery> query) override;
 
+  //encodeBlock
+  virtual void encodeBlock(SharedPtr<BlockQuery> query) override;
+
+  //readBlockSummary
+  virtual bool readBlockSummary(Field field, double time, BigInt blockid, BlockSummary& summary) override;
+
   //endIO
   virtual void endIO() override;
 
@@ -98,13 +109,36 @@ public:
   //releaseWriteLock
   virtual void releaseWriteLock(SharedPtr<BlockQuery> query) override;
 
+  //printStatistics
+  virtual void printStatistics() override;
+
+  //getDiskCache
+  SharedPtr<DiskCache> getDiskCache() const {
+    return disk_cache;
+  }
+
 private:
 
-  UniquePtr<Access>     sync, async;
-  SharedPtr<ThreadPool> async_tpool;
-  IdxFile               idxfile;
-  bool                  bSkipReading = false;
-  bool                  bSkipWriting = false;
+  UniquePtr<Access>                 sync;
+  std::vector< UniquePtr<Access> >  async; //one reader for each async worker (each one has its own File and headers)
+  std::vector<Access*>              async_free;
+  CriticalSection                   async_lock;
+  UniquePtr<Access>                 summary_reader;
+  CriticalSection                   summary_lock;
+  SharedPtr<ThreadPool>             async_tpool;
+  IdxFile                           idxfile;
+  bool                              bSkipReading = false;
+  bool                              bSkipWriting = false;
+  SharedPtr<DiskCache>              disk_cache; //only when caching a remote dataset with a size budget
+
+  //cacheReadDone
+  void cacheReadDone(SharedPtr<BlockQuery> query);
+
+  //acquireAsyncReader
+  Access* acquireAsyncReader();
+
+  //releaseAsyncReader
+  void releaseAsyncReader(Access* reader);
 
 }; 
 
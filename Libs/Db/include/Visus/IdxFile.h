@@ -97,6 +97,9 @@ public:
 
   // adding support for arco
   int arco = 0;
+
+  //number of arco blocks packed in the same container file (0 means one file for each block), see ArcoShard
+  int arco_shard = 0;
   
   //constructor
   IdxFile(int version_=0);
@@ -42,6 +42,12 @@ For support : support@visus.net
 #include <Visus/Db.h>
 #include <Visus/DatasetBitmask.h>
 
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
 namespace Visus {
 
 
@@ -87,6 +93,11 @@ public:
     return maxh;
   }
 
+  //getMaxSupportedResolution (62 for 64-bit BigInt, 126 for VISUS_BIGINT_128)
+  static int getMaxSupportedResolution() {
+    return (int)(8 * sizeof(BigInt)) - 2;
+  }
+
   //PointNd -> Zaddress
   /* EXAMPLE
                              01234
@@ -178,9 +189,7 @@ public:
   {
     BigInt last_bitmask=((BigInt)1)<<maxh; //a "1" enter in the left
     z |= last_bitmask;
-    BigInt one=1;
-    while ((one & z)==0) z>>=1; //until a "1" exit
-    z >>= 1;
+    z >>= countTrailingZeros(z)+1; //until a "1" exit
     return z;
   }
 
@@ -190,7 +199,7 @@ public:
     BigInt last_bitmask=((BigInt)1)<<maxh;
     hz <<= 1;
     hz  |= 1;
-    while ((last_bitmask & hz)==0) hz<<=1;
+    hz <<= maxh-(getBitLength(hz)-1);
     hz &= last_bitmask - 1;
     return hz;
   }
@@ -244,13 +253,207 @@ public:
   }
 
   //the right-most "1" set (the bit that will become the V in the right shift in a bitmask such as V010101...)
-  static int getAddressResolution(const DatasetBitmask& bitmask,BigInt hz)
+  static int getAddressResolution(const DatasetBitmask& bitmask,BigInt hz) {
+    return getBitLength(hz);
+  }
+
+  //countTrailingZeros (z must be !=0)
+  static int countTrailingZeros(BigInt z)
+  {
+    VisusAssert(z!=0);
+#if VISUS_BIGINT_128
+    Uint64 lo=(Uint64)z;
+    return lo? countTrailingZeros64(lo) : 64+countTrailingZeros64((Uint64)(z>>64));
+#else
+    return countTrailingZeros64((Uint64)z);
+#endif
+  }
+
+  //getBitLength (i.e. position of the left-most "1" plus one, 0 for z==0)
+  static int getBitLength(BigInt z)
+  {
+#if VISUS_BIGINT_128
+    Uint64 hi=(Uint64)(z>>64);
+    if (hi) return 64+getBitLength64(hi);
+#endif
+    return getBitLength64((Uint64)z);
+  }
+
+private:
+
+  //countTrailingZeros64
+  static int countTrailingZeros64(Uint64 v)
+  {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index,v);
+    return (int)index;
+#else
+    return __builtin_ctzll(v);
+#endif
+  }
+
+  //getBitLength64
+  static int getBitLength64(Uint64 v)
+  {
+    if (!v) return 0;
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse64(&index,v);
+    return (int)index+1;
+#else
+    return 64-__builtin_clzll(v);
+#endif
+  }
+
+};
+
+
+
+/* -------------------------------------------------------
+Specialized interleave/deinterleave generated from the bitmask.
+
+For each dimension D the bitmask tells which zaddress bits hold the bits of p[D] (in increasing order), so:
+  interleave(p)   = OR_D deposit(p[D], zmask[D])
+  deinterleave(z) = for each D extract(z, zmask[D])
+
+deposit/extract are done with PDEP/PEXT when the CPU supports BMI2 (runtime dispatch, x86_64 only),
+otherwise with lookup tables (8 bits at a time). Building the tables costs some KB, so keep one instance
+around (see Dataset::getFastHzOrder()) instead of creating it for each point.
+
+Env VISUS_HZORDER_BMI2=0 disables PDEP/PEXT (for example on old AMD CPUs where they are microcoded and slow).
+* ------------------------------------------------------- */
+
+class HzOrderBMI2;
+
+class VISUS_DB_API FastHzOrder
+{
+public:
+
+  VISUS_NON_COPYABLE_CLASS(FastHzOrder)
+
+  HzOrder hzorder;
+  int     pdim = 0;
+  int     maxh = 0;
+
+  //true to use PDEP/PEXT (can be set only if isBMI2Supported())
+  bool    use_bmi2 = false;
+
+  //constructor
+  FastHzOrder(const DatasetBitmask& bitmask, int maxh);
+
+  //constructor
+  FastHzOrder(const DatasetBitmask& bitmask) : FastHzOrder(bitmask, bitmask.getMaxResolution()) {
+  }
+
+  //destructor
+  ~FastHzOrder() {
+  }
+
+  //isBMI2Supported
+  static bool isBMI2Supported();
+
+#if !SWIG
+  //PointNd -> Zaddress
+  BigInt interleave(const Int64* p) const
+  {
+    if (use_bmi2)
+      return interleaveBMI2(p);
+
+    BigInt z = 0;
+    for (int D = 0; D < pdim; D++)
+    {
+      const BigInt* table = &interleave_table[D * nchunks * 256];
+      Uint64 x = (Uint64)p[D];
+      for (int C = 0; x && C < nchunks; C++, x >>= 8, table += 256)
+        z |= table[x & 0xff];
+    }
+    return z;
+  }
+
+  //Zaddress -> PointNd
+  void deinterleave(BigInt z, Int64* p) const
   {
-    int ret=0;
-    while (hz!=0) {ret++;hz>>=1;}
+    if (use_bmi2)
+      return deinterleaveBMI2(z, p);
+
+    for (int D = 0; D < pdim; D++)
+      p[D] = 0;
+
+    const Int64* table = &deinterleave_table[0];
+    for (Uint64 lo = (Uint64)z; lo; lo >>= 8, table += 256 * pdim)
+    {
+      if (auto v = lo & 0xff)
+      {
+        for (int D = 0; D < pdim; D++)
+          p[D] |= table[v * pdim + D];
+      }
+    }
+
+#if VISUS_BIGINT_128
+    if (Uint64 hi = (Uint64)(z >> 64))
+    {
+      table = &deinterleave_table[8 * 256 * pdim];
+      for (; hi; hi >>= 8, table += 256 * pdim)
+      {
+        if (auto v = hi & 0xff)
+        {
+          for (int D = 0; D < pdim; D++)
+            p[D] |= table[v * pdim + D];
+        }
+      }
+    }
+#endif
+  }
+
+  //PointNd -> HzAddress
+  BigInt getAddress(const Int64* p) const {
+    return hzorder.zAddressToHzAddress(interleave(p));
+  }
+#endif
+
+  //PointNd -> HzAddress
+  BigInt getAddress(const PointNi& p) const {
+    VisusAssert(p.getPointDim() == pdim);
+    return getAddress(&p[0]);
+  }
+
+  //HzAddress -> PointNd
+  PointNi getPoint(BigInt hz) const {
+    PointNi ret(pdim);
+    deinterleave(hzorder.hzAddressToZAddress(hz), &ret[0]);
     return ret;
   }
 
+#if !SWIG
+  //batch version of getAddress (points are stored as p0[0..pdim) p1[0..pdim)...)
+  void getAddress(const Int64* points, Int64 npoints, BigInt* ret) const;
+
+  //batch version of getPoint (points will be stored as p0[0..pdim) p1[0..pdim)...)
+  void getPoint(const BigInt* hz, Int64 npoints, Int64* points) const;
+#endif
+
+private:
+
+  //for each dimension, which zaddress bits belong to it
+  std::vector<BigInt> zmask;
+
+  //[D][chunk][256] zaddress bits for 8 bits of p[D]
+  int                 nchunks = 0;
+  std::vector<BigInt> interleave_table;
+
+  //[zbyte][256][D] coordinate bits for 8 bits of the zaddress 
+  std::vector<Int64>  deinterleave_table;
+
+  //PDEP/PEXT masks
+  SharedPtr<HzOrderBMI2> bmi2;
+
+  //interleaveBMI2
+  BigInt interleaveBMI2(const Int64* p) const;
+
+  //deinterleaveBMI2
+  void deinterleaveBMI2(BigInt z, Int64* p) const;
+
 };
 
 
@@ -42,6 +42,7 @@ For support : support@visus.net
 #include <Visus/Db.h>
 #include <Visus/IdxDataset.h>
 #include <Visus/Color.h>
+#include <Visus/IdxMultipleExpression.h>
 
 namespace Visus {
 
@@ -61,6 +62,9 @@ public:
 
   int debug_mode = 0;
 
+  //evaluate the common field algebra in C++ (see IdxMultipleExpression), otherwise always use computeOuput
+  bool native_expressions = true;
+
   //this is needed for midx
   std::map<String, SharedPtr<Dataset> > down_datasets;
 
@@ -128,6 +132,9 @@ public:
     return Array();
   }
 
+  //executeCode (native evaluation if possible, otherwise computeOuput)
+  Array executeCode(BoxQuery* QUERY, SharedPtr<Access> ACCESS, Aborted aborted, String CODE) const;
+
 public:
 
   //readDatasetFromArchive 
@@ -135,6 +142,9 @@ public:
 
 private:
 
+  mutable CriticalSection                                       expressions_lock;
+  mutable std::map<String, SharedPtr<IdxMultipleExpression> >   expressions; //null means python only
+
   //removeAliases
   String removeAliases(String url);
 
@@ -0,0 +1,91 @@
+/*-----------------------------------------------------------------------------
+Copyright(c) 2010 - 2018 ViSUS L.L.C.,
+Scientific Computing and Imaging Institute of the University of Utah
+
+ViSUS L.L.C., 50 W.Broadway, Ste. 300, 84101 - 2044 Salt Lake City, UT
+University of Utah, 72 S Central Campus Dr, Room 3750, 84112 Salt Lake City, UT
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met :
+
+* Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED.IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+For additional information about this project contact : pascucci@acm.org
+For support : support@visus.net
+-----------------------------------------------------------------------------*/
+
+
+#ifndef __VISUS_IDX_MULTIPLE_EXPRESSION_H
+#define __VISUS_IDX_MULTIPLE_EXPRESSION_H
+
+#include <Visus/Db.h>
+#include <Visus/Array.h>
+#include <Visus/BoxQuery.h>
+#include <Visus/Access.h>
+
+namespace Visus {
+
+class IdxMultipleDataset;
+
+//////////////////////////////////////////////////////////////////////
+/*
+Native evaluation of the common midx field algebra, i.e. the python subset:
+
+  f0=input.A.temperature
+  f1=input['B']['temperature']
+  output=ArrayUtils.average([f0,f1])*0.5 + ArrayUtils.cast(f0[0], DType.fromString("float32"))
+
+Supported: assignments, + - * / on arrays and numbers, component selection, ArrayUtils.(add|sub|mul|div|min|max|average|standardDeviation|median|cast|sqrt), 
+voronoi()/noBlend()/averageBlend(). Results are the same as the python/ArrayUtils ones, but pointwise operations are fused in a single 
+multi-threaded pass without full size temporaries. Anything else (python statements, numpy, nested midx, 64 bit integer inputs or casts since samples are evaluated 
+as double...) is not compiled and the caller falls back to IdxMultipleDataset::computeOuput.
+*/
+class VISUS_DB_API IdxMultipleExpression
+{
+public:
+
+  VISUS_NON_COPYABLE_CLASS(IdxMultipleExpression)
+
+  class Node;
+
+  //constructor
+  IdxMultipleExpression(SharedPtr<Node> output_) : output(output_) {
+  }
+
+  //compile (return null if the code needs the python engine)
+  static SharedPtr<IdxMultipleExpression> compile(const IdxMultipleDataset* DATASET, String code);
+
+  //evaluate (QUERY==nullptr means that only the output dtype is needed)
+  Array evaluate(const IdxMultipleDataset* DATASET, BoxQuery* QUERY, SharedPtr<Access> ACCESS, Aborted aborted) const;
+
+private:
+
+  SharedPtr<Node> output;
+
+};
+
+} //namespace Visus
+
+#endif //__VISUS_IDX_MULTIPLE_EXPRESSION_H
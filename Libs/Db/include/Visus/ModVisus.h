@@ -58,6 +58,29 @@ public:
   //default_public
   bool default_public = true;
 
+  //long-lived read-only accesses shared by all requests of a dataset (see Configuration/ModVisus/AccessPool)
+  class AccessPoolConfig
+  {
+  public:
+    int max_accesses   = 16; //max number of idle accesses kept for each dataset
+    int max_open_files = 16; //max number of idx files kept open by each access
+  };
+
+  AccessPoolConfig access_pool;
+
+  //bounded cache of already encoded box/block query responses (see Configuration/ModVisus/ResponseCache)
+  class ResponseCacheConfig
+  {
+  public:
+    Int64  max_bytes       = 0;                  //0 means disabled
+    Int64  max_item_bytes  = 16 * 1024 * 1024;   //bigger responses are never cached
+    String spill_directory;                      //(optional) responses evicted from memory are moved here
+    Int64  max_spill_bytes = 1024 * 1024 * 1024; //limit for the spill directory
+    int    ttl             = 60;                 //seconds, then the response is computed again (datasets can change without a reload)
+  };
+
+  ResponseCacheConfig response_cache;
+
   //constructor
   ModVisus();
 
@@ -78,8 +101,10 @@ public:
 private:
 
   class PublicDatasets;
+  class ResponseCache;
 
   SharedPtr<PublicDatasets>  m_datasets;
+  SharedPtr<ResponseCache>   m_response_cache;
 
   String                     config_filename;
 
@@ -105,6 +130,7 @@ private:
   NetResponse handleBlockQuery       (const NetRequest& request);
   NetResponse handleBoxQuery         (const NetRequest& request);
   NetResponse handlePointQuery       (const NetRequest& request);
+  NetResponse handleBlockSummary     (const NetRequest& request);
 
   //deprecated, use dynamic 
   NetResponse handleDynamicReload(const NetRequest& request);
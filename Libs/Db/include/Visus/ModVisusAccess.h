@@ -92,12 +92,31 @@ private:
 
   Batch batch;
 
+  SharedPtr<CoalescedReads> coalesced_reads;
+
   //num_queries_per_request
   int num_queries_per_request=1;
 
+  //binary framed responses (see NetResponse::appendFrame)
+  bool framing = false;
+
+  class FramedBatch;
+
+  //addToBatch
+  void addToBatch(SharedPtr<BlockQuery> query);
+
   //flushBatch
   void flushBatch();
 
+  //sendBatch (thread safe)
+  void sendBatch(Batch batch);
+
+  //readFrames
+  void readFrames(SharedPtr<FramedBatch> framed, const NetResponse& RESPONSE);
+
+  //setBlockResponse
+  void setBlockResponse(SharedPtr<BlockQuery> query, NetResponse response);
+
 };
 
 } //namespace Visus
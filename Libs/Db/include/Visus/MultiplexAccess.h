@@ -44,6 +44,8 @@ For support : support@visus.net
 #include <Visus/ThreadPool.h>
 #include <Visus/CriticalSection.h>
 
+#include <condition_variable>
+
 namespace Visus {
 
 //predeclaration
@@ -72,7 +74,11 @@ public:
 
   //readBlock 
   virtual void readBlock(SharedPtr<BlockQuery> up_query) override {
-    scheduleOp('r', 0, up_query);
+    //NOTE: scheduleOp is thread safe
+    if (coalesced_reads)
+      coalesced_reads->readBlock(this, up_query, [this](SharedPtr<BlockQuery> query) { scheduleOp('r', 0, query); });
+    else
+      scheduleOp('r', 0, up_query);
   }
 
   //writeBlock
@@ -100,6 +106,10 @@ private:
   Semaphore            something_happened;
   bool                 bExit = false;
 
+  //caching writes still running (protected by lock)
+  int                     nwriting = 0;
+  std::condition_variable writing_done;
+
   class Filter
   {
   public:
@@ -108,6 +118,8 @@ private:
 
   std::vector<Filter> dw_filter;
 
+  SharedPtr<CoalescedReads> coalesced_reads;
+
   SharedPtr<std::thread> thread;
 
   //isGoodIndex
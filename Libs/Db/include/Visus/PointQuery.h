@@ -43,6 +43,8 @@ For support : support@visus.net
 #include <Visus/Query.h>
 #include <Visus/Frustum.h>
 
+#include <algorithm>
+
 namespace Visus {
 
 //predeclaration
@@ -66,9 +68,38 @@ public:
   int                   end_resolution = -1;
   std::vector<int>      end_resolutions;
 
-  //blockid -> (point-cloud-offset, block-offset)*
-  typedef std::vector< std::pair<BigInt, BigInt> > Offsets;
-  std::map< BigInt, SharedPtr< Offsets > > offsets;
+#if !SWIG
+  //flat (blockid, block-offset, point-offset) table sorted by blockid
+  class VISUS_DB_API Offsets
+  {
+  public:
+
+    std::vector<BigInt> blocks;       //sorted
+    std::vector<Int64>  first;        //blocks[I] uses the items in [first[I], first[I+1])
+    std::vector<Int64>  block_offset; //sample inside the row major block
+    std::vector<Int64>  point_offset; //sample inside the query buffer
+
+    //clear
+    void clear() {
+      blocks.clear(); first.clear(); block_offset.clear(); point_offset.clear();
+    }
+
+    //find
+    bool find(BigInt blockid, Int64& from, Int64& to) const
+    {
+      auto it = std::lower_bound(blocks.begin(), blocks.end(), blockid);
+      if (it == blocks.end() || *it != blockid)
+        return false;
+      auto I = it - blocks.begin();
+      from = first[I];
+      to   = first[I + 1];
+      return true;
+    }
+
+  };
+
+  Offsets               offsets;
+#endif
 
   //constructor
   PointQuery() {
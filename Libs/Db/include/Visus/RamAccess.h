@@ -47,6 +47,7 @@ namespace Visus {
 class Dataset;
 
 //////////////////////////////////////////////////////////////////////////////////////////
+//NOTE: block buffers are shared (not cloned) between the cache and the queries, clone before modifying them in place
 class VISUS_DB_API RamAccess : public Access
 {
 public:
@@ -79,6 +80,10 @@ private:
   class Shared;
   SharedPtr<Shared> shared;
 
+  int     nshards = 16;
+  String  policy = "lru";      //"lru" or "level" (evict finer resolution levels first)
+  int     admit_max_level = -1; //do not cache blocks above this resolution level (-1 means all)
+
 };
 
 
@@ -39,11 +39,369 @@ For support : support@visus.net
 #include <Visus/Access.h>
 #include <Visus/IdxHzOrder.h>
 #include <Visus/Dataset.h>
+#include <Visus/Thread.h>
+
+#include <condition_variable>
+#include <algorithm>
 
 namespace Visus {
 const String Access::DefaultChMod = "rw";
 
 
+///////////////////////////////////////////////////////////////////////////////////////
+//all the CoalescedReads instances, and the thread failing their aborted waiters
+//NOTE: the thread runs only while some instance exists, and polls only while somebody is waiting
+class CoalescedReadsGlobals
+{
+public:
+
+  CriticalSection                                   lock;
+  std::condition_variable                           wakeup;
+  std::map<String, std::weak_ptr<CoalescedReads> >  instances;
+  std::atomic<Int64>                                nwaiting;
+  SharedPtr<std::thread>                            watcher;
+  Int64                                             watcher_id = 0; //changed to stop the current watcher
+
+  //constructor
+  CoalescedReadsGlobals() : nwaiting(0) {
+  }
+
+  //get
+  static CoalescedReadsGlobals* get() {
+    static CoalescedReadsGlobals* ret = new CoalescedReadsGlobals();
+    return ret;
+  }
+
+  //addWaiting
+  void addWaiting(Int64 value)
+  {
+    if (!value)
+      return;
+
+    if ((nwaiting += value) == value)
+    {
+      ScopedLock lock(this->lock);
+      wakeup.notify_all();
+    }
+  }
+
+  //removeInstance (called by the CoalescedReads destructor)
+  void removeInstance(String source)
+  {
+    SharedPtr<std::thread> thread;
+    {
+      ScopedLock lock(this->lock);
+      auto it = instances.find(source);
+      if (it != instances.end() && it->second.expired())
+        instances.erase(it);
+
+      if (!instances.empty() || !watcher)
+        return;
+
+      thread = watcher;
+      watcher.reset();
+      ++watcher_id;
+      wakeup.notify_all();
+    }
+
+    //the last reference can be released by the watcher itself
+    if (thread->get_id() == std::this_thread::get_id())
+      thread->detach();
+    else
+      Thread::join(thread);
+  }
+
+  //watchAborted
+  void watchAborted(Int64 id)
+  {
+    std::unique_lock<CriticalSection> lock(this->lock);
+    while (id == watcher_id)
+    {
+      if (!nwaiting)
+      {
+        wakeup.wait(lock);
+        continue;
+      }
+
+      std::vector< SharedPtr<CoalescedReads> > alive;
+      for (auto it : instances)
+      {
+        if (auto instance = it.second.lock())
+          alive.push_back(instance);
+      }
+
+      lock.unlock();
+      for (auto instance : alive)
+        instance->failAborted();
+      alive.clear();
+      lock.lock();
+
+      if (id == watcher_id && nwaiting)
+        wakeup.wait_for(lock, std::chrono::milliseconds(10));
+    }
+  }
+
+};
+
+///////////////////////////////////////////////////////////////////////////////////////
+SharedPtr<CoalescedReads> CoalescedReads::getSingleton(String source)
+{
+  auto globals = CoalescedReadsGlobals::get();
+
+  ScopedLock lock(globals->lock);
+
+  auto ret = globals->instances[source].lock();
+  if (!ret)
+  {
+    ret = std::make_shared<CoalescedReads>();
+    ret->source = source;
+    globals->instances[source] = ret;
+  }
+
+  if (!globals->watcher)
+  {
+    auto id = globals->watcher_id;
+    globals->watcher = Thread::start("CoalescedReads Watcher", [globals, id]() {globals->watchAborted(id); });
+  }
+
+  return ret;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+CoalescedReads::~CoalescedReads()
+{
+  CoalescedReadsGlobals::get()->removeInstance(source);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+void CoalescedReads::readBlock(Access* access, SharedPtr<BlockQuery> query, Fetch fetch, Fetch refetch)
+{
+  Reader reader;
+  reader.query = query;
+  reader.refetch = refetch ? refetch : fetch;
+
+  auto key = cstring(query->field.name, query->time, query->blockid);
+  {
+    ScopedLock lock(this->lock);
+
+    auto& owner = owners[access];
+    if (!owner)
+    {
+      owner = std::make_shared<Owner>();
+      owner->access = access;
+    }
+    reader.owner = owner;
+
+    auto it = inflight.find(key);
+    if (it != inflight.end())
+    {
+      it->second.waiters.push_back(reader);
+      ++access->statistics.rcoalesced;
+      CoalescedReadsGlobals::get()->addWaiting(+1);
+      return;
+    }
+    inflight[key].leader = reader;
+  }
+
+  startRead(key, reader, fetch);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+void CoalescedReads::detach(Access* access)
+{
+  SharedPtr<Owner> owner;
+  std::vector<Reader> waiters;
+  std::vector< std::pair<String, SharedPtr<BlockQuery> > > orphans;
+  {
+    ScopedLock lock(this->lock);
+    auto it = owners.find(access);
+    if (it == owners.end())
+      return;
+
+    owner = it->second;
+    owners.erase(it);
+
+    for (auto& it : inflight)
+    {
+      if (it.second.leader.owner == owner)
+        orphans.push_back(std::make_pair(it.first, it.second.leader.query));
+    }
+
+    waiters = takeWaiters([owner](const Reader& reader) {return reader.owner == owner; });
+  }
+
+  //wait for any callback still running, after this point the access is never used
+  {
+    std::lock_guard<std::recursive_mutex> lock(owner->lock);
+    for (auto waiter : waiters)
+      access->readFailed(waiter.query, "access destroyed");
+    owner->access = nullptr;
+  }
+
+  //the reads of the access may never complete, let another waiter do the job
+  for (auto it : orphans)
+    restartRead(it.first, it.second);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+void CoalescedReads::failAborted()
+{
+  std::vector<Reader> aborted;
+  {
+    ScopedLock lock(this->lock);
+    aborted = takeWaiters([](const Reader& reader) {return reader.query->aborted(); });
+  }
+
+  for (auto waiter : aborted)
+    notify(waiter, SharedPtr<BlockQuery>(), "aborted");
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+std::vector<CoalescedReads::Reader> CoalescedReads::takeWaiters(std::function<bool(const Reader&)> pred)
+{
+  std::vector<Reader> ret;
+  for (auto& it : inflight)
+  {
+    auto& waiters = it.second.waiters;
+    auto last = std::stable_partition(waiters.begin(), waiters.end(), [&pred](const Reader& reader) {return !pred(reader); });
+    ret.insert(ret.end(), last, waiters.end());
+    waiters.erase(last, waiters.end());
+  }
+  CoalescedReadsGlobals::get()->addWaiting(-(Int64)ret.size());
+  return ret;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+void CoalescedReads::startRead(String key, Reader leader, Fetch fetch)
+{
+  //NOTE: the callback can be executed inline if the fetch is synchronous
+  leader.query->done.when_ready([this, key, leader](Void) {
+    readDone(key, leader);
+  });
+
+  fetch(leader.query);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+void CoalescedReads::restartRead(String key, SharedPtr<BlockQuery> old_leader)
+{
+  Reader leader;
+  std::vector<Reader> aborted;
+  {
+    ScopedLock lock(this->lock);
+    auto it = inflight.find(key);
+
+    //somebody else already took care of it
+    if (it == inflight.end() || it->second.leader.query != old_leader)
+      return;
+
+    auto& waiters = it->second.waiters;
+    while (!waiters.empty() && !leader.query)
+    {
+      auto waiter = waiters.front();
+      waiters.erase(waiters.begin());
+      if (waiter.query->aborted())
+        aborted.push_back(waiter);
+      else
+        leader = waiter;
+    }
+
+    if (leader.query)
+      it->second.leader = leader;
+    else
+      inflight.erase(it);
+  }
+
+  CoalescedReadsGlobals::get()->addWaiting(-(Int64)(aborted.size() + (leader.query ? 1 : 0)));
+
+  for (auto waiter : aborted)
+    notify(waiter, SharedPtr<BlockQuery>(), "aborted");
+
+  if (!leader.query)
+    return;
+
+  std::lock_guard<std::recursive_mutex> lock(leader.owner->lock);
+
+  //NOTE: if its access has been destroyed in the meantime, the detach is going to restart the read again
+  if (leader.owner->access)
+    startRead(key, leader, leader.refetch);
+  else
+    leader.query->setFailed("access destroyed");
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+void CoalescedReads::readDone(String key, Reader leader)
+{
+  std::vector<Reader> waiters;
+  bool bRestart = false;
+  {
+    ScopedLock lock(this->lock);
+    auto it = inflight.find(key);
+
+    //not the leader anymore (i.e. the read has been restarted since its access has been destroyed)
+    if (it == inflight.end() || it->second.leader.query != leader.query)
+      return;
+
+    //the leader has been aborted, but some waiters still need the block
+    if (leader.query->failed() && leader.query->aborted())
+    {
+      for (auto& waiter : it->second.waiters)
+        bRestart = bRestart || !waiter.query->aborted();
+    }
+
+    if (!bRestart)
+    {
+      waiters = it->second.waiters;
+      inflight.erase(it);
+    }
+  }
+
+  if (bRestart)
+    return restartRead(key, leader.query);
+
+  CoalescedReadsGlobals::get()->addWaiting(-(Int64)waiters.size());
+
+  for (auto waiter : waiters)
+  {
+    if (waiter.query->aborted())
+      notify(waiter, SharedPtr<BlockQuery>(), "aborted");
+    else
+      notify(waiter, leader.query, leader.query->errormsg);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+void CoalescedReads::notify(Reader reader, SharedPtr<BlockQuery> from, String errormsg)
+{
+  //the lock guarantees the access is not destroyed in the meantime (see detach)
+  std::lock_guard<std::recursive_mutex> lock(reader.owner->lock);
+  auto access = reader.owner->access;
+  auto query = reader.query;
+
+  if (from && from->ok())
+  {
+    //each waiter gets its own copy, since readOk and the caller can modify the samples in place
+    query->buffer = from->buffer.clone();
+    if (query->bKeepEncoded)
+    {
+      query->encoded = from->encoded ? from->encoded->clone() : from->encoded;
+      query->compression = from->compression;
+    }
+
+    if (access)
+      access->readOk(query);
+    else
+      query->setOk();
+  }
+  else
+  {
+    if (access)
+      access->readFailed(query, errormsg);
+    else
+      query->setFailed(errormsg);
+  }
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////
 String Access::getBlockFilename(Dataset* dataset, int bitsperblock, String filename_template, Field field, double time, String compression, BigInt blockid, bool reverse_filename) 
 {
@@ -60,7 +418,11 @@ String Access::getBlockFilename(Dataset* dataset, int bitsperblock, String filen
   {
     //auto s_blockid = StringUtils::formatNumber("%016x", blockid); WRONG for int64 (!)
     std::ostringstream out;
-    out << std::setw(16) << std::hex << std::setfill('0') << blockid;
+#if VISUS_BIGINT_128
+    if (Uint64 high = (Uint64)(blockid >> 64))
+      out << std::hex << high;
+#endif
+    out << std::setw(16) << std::hex << std::setfill('0') << (Uint64)blockid;
     auto s_blockid = out.str();
 
     ret = StringUtils::replaceFirst(ret, "$(block:%016x)", s_blockid);
@@ -0,0 +1,96 @@
+/*-----------------------------------------------------------------------------
+Copyright(c) 2010 - 2018 ViSUS L.L.C.,
+Scientific Computing and Imaging Institute of the University of Utah
+
+ViSUS L.L.C., 50 W.Broadway, Ste. 300, 84101 - 2044 Salt Lake City, UT
+University of Utah, 72 S Central Campus Dr, Room 3750, 84112 Salt Lake City, UT
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met :
+
+* Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED.IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+For additional information about this project contact : pascucci@acm.org
+For support : support@visus.net
+-----------------------------------------------------------------------------*/
+
+#include <Visus/ArcoShard.h>
+#include <Visus/ByteOrder.h>
+
+namespace Visus {
+
+//////////////////////////////////////////////////////////////////////////////
+template <typename T>
+static inline T ToNetworkByteOrder(T value) {
+  return ByteOrder::isNetworkByteOrder() ? value : ByteOrder::swapByteOrder(value);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+SharedPtr<HeapMemory> ArcoShard::encodeHeader() const
+{
+  int nblocks = getNumberOfBlocks();
+
+  auto ret = std::make_shared<HeapMemory>();
+  if (!ret->resize(getHeaderSize(nblocks), __FILE__, __LINE__))
+    return SharedPtr<HeapMemory>();
+
+  auto p32 = (Int32*)ret->c_ptr();
+  p32[0] = ToNetworkByteOrder(Magic);
+  p32[1] = ToNetworkByteOrder(Version);
+
+  auto p64 = (Int64*)(ret->c_ptr() + 8);
+  p64[0] = ToNetworkByteOrder((Int64)nblocks);
+  for (int I = 0; I < nblocks; I++)
+  {
+    p64[1 + 2 * I + 0] = ToNetworkByteOrder(entries[I].offset);
+    p64[1 + 2 * I + 1] = ToNetworkByteOrder(entries[I].size);
+  }
+
+  return ret;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+bool ArcoShard::decodeHeader(SharedPtr<HeapMemory> header, int nblocks)
+{
+  if (!header || header->c_size() < getHeaderSize(nblocks))
+    return false;
+
+  auto p32 = (const Int32*)header->c_ptr();
+  auto p64 = (const Int64*)(header->c_ptr() + 8);
+  if (ToNetworkByteOrder(p32[0]) != Magic || ToNetworkByteOrder(p32[1]) != Version || ToNetworkByteOrder(p64[0]) != (Int64)nblocks)
+    return false;
+
+  this->entries.resize(nblocks);
+  for (int I = 0; I < nblocks; I++)
+  {
+    entries[I].offset = ToNetworkByteOrder(p64[1 + 2 * I + 0]);
+    entries[I].size   = ToNetworkByteOrder(p64[1 + 2 * I + 1]);
+  }
+
+  return true;
+}
+
+} //namespace Visus
+
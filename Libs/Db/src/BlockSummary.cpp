@@ -0,0 +1,384 @@
+/*-----------------------------------------------------------------------------
+Copyright(c) 2010 - 2018 ViSUS L.L.C.,
+Scientific Computing and Imaging Institute of the University of Utah
+
+ViSUS L.L.C., 50 W.Broadway, Ste. 300, 84101 - 2044 Salt Lake City, UT
+University of Utah, 72 S Central Campus Dr, Room 3750, 84112 Salt Lake City, UT
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met :
+
+* Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED.IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+For additional information about this project contact : pascucci@acm.org
+For support : support@visus.net
+-----------------------------------------------------------------------------*/
+
+#include <Visus/BlockSummary.h>
+#include <Visus/ByteOrder.h>
+#include <Visus/NumericLimits.h>
+
+#include <cmath>
+
+namespace Visus {
+
+///////////////////////////////////////////////////////////////////////////////////////
+struct ComputeBlockSummaryOp
+{
+  template <class CppType>
+  bool execute(BlockSummary& ret, Array buffer, const Uint8* mask, int nbins)
+  {
+    int ncomponents = buffer.dtype.ncomponents();
+    Int64 tot = buffer.getTotalNumberOfSamples();
+    auto ptr = (const CppType*)buffer.c_ptr();
+
+    ret.components.resize(ncomponents);
+
+    for (int C = 0; C < ncomponents; C++)
+    {
+      auto& component = ret.components[C];
+      component.bins.assign(nbins, 0);
+
+      //first pass: min, max and mean (NaN are not part of the summary)
+      double m = NumericLimits<double>::highest(), M = NumericLimits<double>::lowest(), sum = 0;
+      Int64 N = 0;
+      for (Int64 I = 0; I < tot; I++)
+      {
+        if (mask && !mask[I]) continue;
+        double value = (double)ptr[I * ncomponents + C];
+        if (value != value) continue;
+        if (value < m) m = value;
+        if (value > M) M = value;
+        sum += value;
+        N++;
+      }
+
+      if (!N)
+        continue;
+
+      component.min = m;
+      component.max = M;
+      component.mean = sum / N;
+
+      //second pass: histogram
+      if (m == M)
+      {
+        component.bins[0] = N;
+        continue;
+      }
+
+      double scale = nbins / (M - m);
+      for (Int64 I = 0; I < tot; I++)
+      {
+        if (mask && !mask[I]) continue;
+        double value = (double)ptr[I * ncomponents + C];
+        if (value != value) continue;
+        int bin = (int)((value - m) * scale);
+        component.bins[bin < nbins ? bin : nbins - 1]++;
+      }
+    }
+
+    return true;
+  }
+};
+
+////////////////////////////////////////////////////////////////////
+static void RebinComponent(const BlockSummary::Component& src, BlockSummary::Component& dst)
+{
+  int nsrc = (int)src.bins.size();
+  int ndst = (int)dst.bins.size();
+  for (int I = 0; I < nsrc; I++)
+  {
+    if (!src.bins[I])
+      continue;
+
+    //the position inside the source bin is not known, use its center
+    double value = src.max == src.min ? src.min : src.min + (I + 0.5) * (src.max - src.min) / nsrc;
+    int bin = dst.max == dst.min ? 0 : (int)((value - dst.min) * ndst / (dst.max - dst.min));
+    dst.bins[Utils::clamp(bin, 0, ndst - 1)] += src.bins[I];
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+BlockSummary BlockSummary::missing()
+{
+  BlockSummary ret;
+  ret.bValid = true;
+  ret.bMissing = true;
+  return ret;
+}
+
+////////////////////////////////////////////////////////////////////
+bool BlockSummary::isConstant() const
+{
+  for (auto& it : components)
+  {
+    if (it.min != it.max)
+      return false;
+  }
+  return bValid;
+}
+
+////////////////////////////////////////////////////////////////////
+bool BlockSummary::isNull() const
+{
+  if (!bValid)
+    return false;
+
+  if (bMissing || !nsamples)
+    return true;
+
+  for (auto& it : components)
+  {
+    if (it.min != 0 || it.max != 0)
+      return false;
+  }
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////
+BlockSummary BlockSummary::compute(Array buffer, const Uint8* mask, int nbins)
+{
+  BlockSummary ret;
+  if (!buffer.valid() || nbins <= 0)
+    return ret;
+
+  ComputeBlockSummaryOp op;
+  if (!ExecuteOnCppSamples(op, buffer.dtype, ret, buffer, mask, nbins))
+    return BlockSummary();
+
+  Int64 tot = buffer.getTotalNumberOfSamples();
+  ret.nsamples = tot;
+  if (mask)
+  {
+    ret.nsamples = 0;
+    for (Int64 I = 0; I < tot; I++)
+      ret.nsamples += mask[I] ? 1 : 0;
+  }
+
+  ret.bValid = true;
+  return ret;
+}
+
+////////////////////////////////////////////////////////////////////
+bool BlockSummary::mayContain(Range range, int C) const
+{
+  //no information
+  if (!bValid)
+    return true;
+
+  if (bMissing || !nsamples)
+    return false;
+
+  if (C < 0 || C >= (int)components.size())
+    return true;
+
+  const auto& component = components[C];
+  if (range.to < component.min || range.from > component.max)
+    return false;
+
+  int nbins = (int)component.bins.size();
+  if (!nbins || component.min == component.max)
+    return true;
+
+  //check the bins overlapping the range (one more bin on each side to be safe with rounding)
+  double scale = nbins / (component.max - component.min);
+  int A = Utils::clamp((int)std::floor((range.from - component.min) * scale) - 1, 0, nbins - 1);
+  int B = Utils::clamp((int)std::floor((range.to   - component.min) * scale) + 1, 0, nbins - 1);
+  for (int I = A; I <= B; I++)
+  {
+    if (component.bins[I])
+      return true;
+  }
+  return false;
+}
+
+////////////////////////////////////////////////////////////////////
+BlockSummary BlockSummary::merge(const std::vector<BlockSummary>& summaries, int nbins)
+{
+  BlockSummary ret;
+  ret.bMissing = true;
+
+  //cannot say anything if one of the summaries is not known
+  int ncomponents = 0;
+  for (auto& it : summaries)
+  {
+    if (!it.valid())
+      return BlockSummary();
+
+    ret.bMissing = ret.bMissing && it.bMissing;
+    ncomponents = std::max(ncomponents, (int)it.components.size());
+  }
+
+  ret.bValid = true;
+  ret.components.resize(ncomponents);
+  for (int C = 0; C < ncomponents; C++)
+  {
+    auto& dst = ret.components[C];
+    dst.bins.assign(nbins, 0);
+
+    //first the range, so that the bins of each summary are redistributed only once
+    Int64 N = 0;
+    double sum = 0;
+    for (auto& it : summaries)
+    {
+      if (!it.nsamples || C >= (int)it.components.size())
+        continue;
+
+      const auto& src = it.components[C];
+      dst.min = N ? std::min(dst.min, src.min) : src.min;
+      dst.max = N ? std::max(dst.max, src.max) : src.max;
+      sum += src.mean * it.nsamples;
+      N += it.nsamples;
+    }
+
+    if (!N)
+      continue;
+
+    dst.mean = sum / N;
+
+    for (auto& it : summaries)
+    {
+      if (it.nsamples && C < (int)it.components.size())
+        RebinComponent(it.components[C], dst);
+    }
+  }
+
+  for (auto& it : summaries)
+    ret.nsamples += it.nsamples;
+
+  return ret;
+}
+
+////////////////////////////////////////////////////////////////////
+Histogram BlockSummary::getHistogram(int C) const
+{
+  if (!bValid || C < 0 || C >= (int)components.size())
+    return Histogram();
+
+  const auto& component = components[C];
+  Histogram ret(component.getRange(), (int)component.bins.size());
+  for (int I = 0; I < (int)component.bins.size(); I++)
+    ret.bins[I] = (Uint64)component.bins[I];
+  return ret;
+}
+
+////////////////////////////////////////////////////////////////////
+int BlockSummary::getRecordSize(DType dtype)
+{
+  //flags, nsamples, then for each component min, max, mean and bins
+  return 2 * sizeof(Uint32) + dtype.ncomponents() * (3 * sizeof(Float64) + NumBins * sizeof(Uint32));
+}
+
+////////////////////////////////////////////////////////////////////
+template <typename T>
+static inline void WriteNetworkOrder(Uint8*& dst, T value)
+{
+  if (!ByteOrder::isNetworkByteOrder())
+    value = ByteOrder::swapByteOrder(value);
+  memcpy(dst, &value, sizeof(T));
+  dst += sizeof(T);
+}
+
+template <typename T>
+static inline T ReadNetworkOrder(const Uint8*& src)
+{
+  T value;
+  memcpy(&value, src, sizeof(T));
+  src += sizeof(T);
+  return ByteOrder::isNetworkByteOrder() ? value : ByteOrder::swapByteOrder(value);
+}
+
+////////////////////////////////////////////////////////////////////
+void BlockSummary::writeRecord(Uint8* dst, DType dtype) const
+{
+  memset(dst, 0, getRecordSize(dtype));
+  if (!bValid || bMissing)
+    return;
+
+  WriteNetworkOrder<Uint32>(dst, 1);
+  WriteNetworkOrder<Uint32>(dst, (Uint32)nsamples);
+  for (int C = 0; C < dtype.ncomponents(); C++)
+  {
+    Component component = C < (int)components.size() ? components[C] : Component();
+    component.bins.resize(NumBins, 0);
+    WriteNetworkOrder<Float64>(dst, component.min);
+    WriteNetworkOrder<Float64>(dst, component.max);
+    WriteNetworkOrder<Float64>(dst, component.mean);
+    for (int I = 0; I < NumBins; I++)
+      WriteNetworkOrder<Uint32>(dst, (Uint32)component.bins[I]);
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+BlockSummary BlockSummary::readRecord(const Uint8* src, DType dtype)
+{
+  BlockSummary ret;
+  if (!(ReadNetworkOrder<Uint32>(src) & 1))
+    return ret;
+
+  ret.bValid = true;
+  ret.nsamples = ReadNetworkOrder<Uint32>(src);
+  ret.components.resize(dtype.ncomponents());
+  for (auto& component : ret.components)
+  {
+    component.min  = ReadNetworkOrder<Float64>(src);
+    component.max  = ReadNetworkOrder<Float64>(src);
+    component.mean = ReadNetworkOrder<Float64>(src);
+    component.bins.resize(NumBins);
+    for (int I = 0; I < NumBins; I++)
+      component.bins[I] = ReadNetworkOrder<Uint32>(src);
+  }
+  return ret;
+}
+
+////////////////////////////////////////////////////////////////////
+void BlockSummary::write(Archive& ar) const
+{
+  ar.write("valid", bValid);
+  if (!bValid)
+    return;
+
+  ar.write("missing", bMissing);
+  ar.write("nsamples", nsamples);
+  ar.write("constant", isConstant());
+  ar.write("null", isNull());
+
+  for (auto& component : components)
+  {
+    std::vector<String> bins;
+    for (auto it : component.bins)
+      bins.push_back(cstring(it));
+
+    auto child = ar.addChild("component");
+    child->write("min", component.min);
+    child->write("max", component.max);
+    child->write("mean", component.mean);
+    child->write("bins", StringUtils::join(bins));
+  }
+}
+
+} //namespace Visus
+
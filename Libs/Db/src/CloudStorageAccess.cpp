@@ -40,6 +40,7 @@ For support : support@visus.net
 #include <Visus/Dataset.h>
 #include <Visus/Encoder.h>
 #include <Visus/File.h>
+#include <Visus/Time.h>
 
 namespace Visus {
 
@@ -67,7 +68,7 @@ CloudStorageAccess::CloudStorageAccess(Dataset* dataset,StringTree config_)
   int nconnections = disable_async ? 0 : config.readInt("nconnections", cint(this->url.getParam("nconnections", cstring(64))));
 
   if (nconnections)
-    this->netservice = std::make_shared<NetService>(nconnections);
+    this->netservice = std::make_shared<NetService>(nconnections, config);
 
   this->cloud_storage=CloudStorage::createInstance(url);
 
@@ -87,12 +88,22 @@ CloudStorageAccess::CloudStorageAccess(Dataset* dataset,StringTree config_)
 
   VisusReleaseAssert(!this->filename_template.empty());
 
-  PrintInfo("Created CloudStorageAccess", "url", url, "filename_template", filename_template, "compression", this->compression, "nconnections", nconnections);
+  //sharded layout: one range read for the container index, one for each block
+  this->arco_shard = config.readInt("arco_shard", dataset->idxfile.arco_shard);
+  this->shard_ttl = config.readInt("shard_ttl", cint(this->url.getParam("shard_ttl", cstring(this->shard_ttl))));
+
+  //concurrent reads of the same block share one download
+  if (config.readBool("coalesce_reads", true))
+    this->coalesced_reads = CoalescedReads::getSingleton(cstring("CloudStorageAccess", url, filename_template, compression, layout, bitsperblock));
+
+  PrintInfo("Created CloudStorageAccess", "url", url, "filename_template", filename_template, "compression", this->compression, "nconnections", nconnections, "arco_shard", arco_shard);
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////
 CloudStorageAccess::~CloudStorageAccess()
 {
+  if (coalesced_reads)
+    coalesced_reads->detach(this);
 }
 
 
@@ -101,6 +112,10 @@ CloudStorageAccess::~CloudStorageAccess()
 String CloudStorageAccess::getFilename(Field field, double time, BigInt blockid) const
 {    
   auto compression = getCompression();
+
+  if (arco_shard && blockid >= 0)
+    blockid = ArcoShard::getFirstBlock(blockid, arco_shard);
+
   auto ret = getBlockFilename(this->dataset, this->bitsperblock, this->filename_template, field, time, compression, blockid, reverse_filename);
 
   //s3://bucket/... -> /bucket/...
@@ -112,48 +127,136 @@ String CloudStorageAccess::getFilename(Field field, double time, BigInt blockid)
 
 ///////////////////////////////////////////////////////////////////////////////////////
 void CloudStorageAccess::readBlock(SharedPtr<BlockQuery> query)
+{
+  if (coalesced_reads)
+    coalesced_reads->readBlock(this, query, [this](SharedPtr<BlockQuery> query) { fetchBlock(query); });
+  else
+    fetchBlock(query);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+void CloudStorageAccess::fetchBlock(SharedPtr<BlockQuery> query)
 {
   //relaxing conditions for VISUS_IDX2 (until I get the layout)
   //VisusAssert((int)query->getNumberOfSamples().innerProduct() == (1 << bitsperblock));
 
   auto blob_name = getFilename(query->field, query->time, query->blockid);
 
-  cloud_storage->getBlob(netservice, blob_name, /*head*/false, /*range*/{0,0}, query->aborted).when_ready([this, query](SharedPtr<CloudStorageItem> blob) {
+  if (!arco_shard)
+  {
+    cloud_storage->getBlob(netservice, blob_name, /*head*/false, /*range*/{ 0,0 }, query->aborted).when_ready([this, query](SharedPtr<CloudStorageItem> blob) {
+      blobReady(query, blob);
+    });
+    return;
+  }
 
-    if (!blob || !blob->valid())
-      return readFailed(query, query->aborted()? "query aborted" : "blob not valid");
+  fetchShard(blob_name).when_ready([this, query, blob_name](SharedPtr<ArcoShard> shard) {
 
-    auto compression = getCompression();
+    if (!shard)
+      return readFailed(query, query->aborted() ? "query aborted" : "shard index not valid");
 
-    //special case for idx2 where I just want to data as it is
-    if (!query->getNumberOfSamples().innerProduct())
-    {
-      blob->metadata.setValue("visus-compression", compression);
-      blob->metadata.setValue("visus-dtype", DTypes::UINT8.toString());
-      blob->metadata.setValue("visus-nsamples", cstring(blob->body->c_size()));
-      blob->metadata.setValue("visus-layout", this->layout);
-    }
-    else
+    auto entry = shard->getEntry(query->blockid);
+    if (!entry.offset || !entry.size)
+      return readFailed(query, "block not stored in shard");
+
+    cloud_storage->getBlob(netservice, blob_name, /*head*/false, /*range*/{ entry.offset, entry.offset + entry.size }, query->aborted).when_ready([this, query, blob_name, entry](SharedPtr<CloudStorageItem> blob) {
+
+      //the blob may have been rewritten since the index was downloaded
+      if (!query->aborted() && (!blob || !blob->valid()))
+        invalidateShard(blob_name);
+
+      //a server ignoring the Range header sends the whole container
+      if (blob && blob->body && blob->body->c_size() != entry.size)
+        return readFailed(query, "range request not supported by the server");
+
+      blobReady(query, blob);
+    });
+  });
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+Future< SharedPtr<ArcoShard> > CloudStorageAccess::fetchShard(String blob_name)
+{
+  Promise< SharedPtr<ArcoShard> > promise;
+  {
+    ScopedLock lock(shards_lock);
+    auto now = Time::getTimeStamp();
+    auto it = shards.find(blob_name);
+    if (it != shards.end() && (!shard_ttl || now - it->second.timestamp <= shard_ttl * (Int64)1000))
+      return it->second.index;
+
+    auto& cached = shards[blob_name];
+    cached.index = promise.get_future();
+    cached.timestamp = now;
+  }
+
+  auto header_size = ArcoShard::getHeaderSize(arco_shard);
+
+  //NOTE: not using the query <aborted>, since the index is shared by all the blocks of the container
+  cloud_storage->getBlob(netservice, blob_name, /*head*/false, /*range*/{ 0, header_size }).when_ready([this, blob_name, promise](SharedPtr<CloudStorageItem> blob) mutable {
+
+    auto shard = std::make_shared<ArcoShard>();
+    if (!blob || !blob->valid() || !shard->decodeHeader(blob->body, arco_shard))
     {
-      VisusAssert((int)query->getNumberOfSamples().innerProduct() == (1 << bitsperblock));
-      blob->metadata.setValue("visus-compression", compression);
-      blob->metadata.setValue("visus-dtype", query->field.dtype.toString());
-      blob->metadata.setValue("visus-nsamples", query->getNumberOfSamples().toString());
-      blob->metadata.setValue("visus-layout", this->layout);
+      //try again next time
+      invalidateShard(blob_name);
+      shard.reset();
     }
 
-    auto decoded = ArrayUtils::decodeArray(blob->metadata, blob->body);
-    if (!decoded.valid())
-      return readFailed(query, "cannot decode array");
+    promise.set_value(shard);
+  });
 
-    //relaxing a little for VISUS_IDX2 (until I get the layout)
-    //VisusAssert(decoded.dims == query->getNumberOfSamples());
-    //VisusAssert(decoded.dtype == query->field.dtype);
-    query->buffer = decoded;
+  return promise.get_future();
+}
 
-    return readOk(query);
-  });
+///////////////////////////////////////////////////////////////////////////////////////
+void CloudStorageAccess::invalidateShard(String blob_name)
+{
+  ScopedLock lock(shards_lock);
+  shards.erase(blob_name);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+void CloudStorageAccess::blobReady(SharedPtr<BlockQuery> query, SharedPtr<CloudStorageItem> blob)
+{
+  if (!blob || !blob->valid())
+    return readFailed(query, query->aborted()? "query aborted" : "blob not valid");
+
+  auto compression = getCompression();
+
+  //special case for idx2 where I just want to data as it is
+  if (!query->getNumberOfSamples().innerProduct())
+  {
+    blob->metadata.setValue("visus-compression", compression);
+    blob->metadata.setValue("visus-dtype", DTypes::UINT8.toString());
+    blob->metadata.setValue("visus-nsamples", cstring(blob->body->c_size()));
+    blob->metadata.setValue("visus-layout", this->layout);
+  }
+  else
+  {
+    VisusAssert((int)query->getNumberOfSamples().innerProduct() == (1 << bitsperblock));
+    blob->metadata.setValue("visus-compression", compression);
+    blob->metadata.setValue("visus-dtype", query->field.dtype.toString());
+    blob->metadata.setValue("visus-nsamples", query->getNumberOfSamples().toString());
+    blob->metadata.setValue("visus-layout", this->layout);
+  }
+
+  auto decoded = ArrayUtils::decodeArray(blob->metadata, blob->body);
+  if (!decoded.valid())
+    return readFailed(query, "cannot decode array");
+
+  //relaxing a little for VISUS_IDX2 (until I get the layout)
+  //VisusAssert(decoded.dims == query->getNumberOfSamples());
+  //VisusAssert(decoded.dtype == query->field.dtype);
+  query->buffer = decoded;
+
+  if (query->bKeepEncoded && decoded.dims == query->getNumberOfSamples())
+  {
+    query->encoded = blob->body;
+    query->compression = compression;
+  }
 
+  return readOk(query);
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////
@@ -74,19 +74,24 @@ public:
     //only row major supported
     VisusReleaseAssert(block_query->buffer.layout.empty());
 
+    Int64 from, to;
+    if (!query->offsets.find(block_query->blockid, from, to))
+      return true;
+
+    auto query_samples = GetSamples<Sample>(query->buffer);
+    auto block_samples = GetSamples<Sample>(block_query->buffer);
+    auto point_offset = &query->offsets.point_offset[0];
+    auto block_offset = &query->offsets.block_offset[0];
+
     if (block_query->mode == 'r')
     {
-      auto query_samples = GetSamples<Sample>(query->buffer);
-      auto block_samples = GetSamples<Sample>(block_query->buffer);
-      for (auto it : *query->offsets[block_query->blockid])
-        query_samples[it.first] = block_samples[it.second];
+      for (auto I = from; I < to; I++)
+        query_samples[point_offset[I]] = block_samples[block_offset[I]];
     }
     else
     {
-      auto block_samples = GetSamples<Sample>(block_query->buffer);
-      auto query_samples = GetSamples<Sample>(query->buffer);
-      for (auto it : *query->offsets[block_query->blockid])
-        block_samples[it.second] = query_samples[it.first];
+      for (auto I = from; I < to; I++)
+        block_samples[block_offset[I]] = query_samples[point_offset[I]];
     }
 
     return true;
@@ -239,6 +244,10 @@ void EnableCachingIfNeeded(String& url, Archive& ar)
   //compression, but default I set zip
   auto cache_compression = parsed.getParam("cache_compression", "zip");
 
+  //(optional) size budget of the cache directory (e.g. cache_max_size=20gb) and eviction policy (lru|lfu)
+  auto cache_max_size = parsed.getParam("cache_max_size", ar.readString("cache_max_size"));
+  auto cache_policy = parsed.getParam("cache_policy", ar.readString("cache_policy"));
+
   //if the url contains the string mod_visus I think the origin is an OpenVisus server, otherwise is an S3 cloud dataset
   //PROBLEM HERE: what is the S3 path contains the string mod_visus? I am not handling this case so please don't use this substring in S3
   String remote_access_type = StringUtils::contains(url, "mod_visus") ? "ModVisusAccess" : "CloudStorageAccess";
@@ -247,6 +256,8 @@ void EnableCachingIfNeeded(String& url, Archive& ar)
   parsed.params.eraseValue("cached");
   parsed.params.eraseValue("cache_dir");
   parsed.params.eraseValue("cache_compression");
+  parsed.params.eraseValue("cache_max_size");
+  parsed.params.eraseValue("cache_policy");
   url = parsed.toString();
 
   std::ostringstream out;
@@ -256,6 +267,10 @@ void EnableCachingIfNeeded(String& url, Archive& ar)
     out << "<access type='" << cache_access_type << "'  chmod='rw' compression='" << cache_compression << "' ";
     if (!cache_dir.empty())
       out << "cache_dir=\"" << cache_dir << "\" ";
+    if (!cache_max_size.empty())
+      out << "cache_max_size=\"" << cache_max_size << "\" ";
+    if (!cache_policy.empty())
+      out << "cache_policy=\"" << cache_policy << "\" ";
     out << "/>" << std::endl;
 
     //remote
@@ -573,7 +588,7 @@ std::vector<String> Dataset::getFilenames(int user_timestep,String user_field)
 ///////////////////////////////////////////////////////////////////////////////////
 void Dataset::compressDataset(std::vector<String> compression, Array data)
 {
-  PrintWarning("NOTE: Dataset::compressDataset is deprecated, use python version");
+  PrintWarning("NOTE: Dataset::compressDataset is deprecated, use `visus recompress` (or python recompressDataset)");
 
   // for future version: here I'm making the assumption that a file contains multiple fields
   if (idxfile.version != 6)
@@ -759,6 +774,192 @@ void Dataset::compressDataset(std::vector<String> compression, Array data)
   }
 }
 
+///////////////////////////////////////////////////////////////////////////////////
+bool Dataset::ingestDataset(Field field, double time, std::function<Array(BoxNi)> readSlab, int slab_size, SharedPtr<Access> access)
+{
+  auto logic_box = getLogicBox();
+  int axis = getPointDim() - 1;
+  auto slice_nsamples = logic_box.size().innerProduct() / logic_box.size()[axis];
+
+  //by default slabs of about 64MB
+  if (slab_size <= 0)
+    slab_size = (int)std::max((Int64)1, (Int64)(64 * 1024 * 1024) / std::max((Int64)1, field.dtype.getByteSize(slice_nsamples)));
+
+  int nthreads = this->write_nthreads;
+  if (nthreads <= 0)
+  {
+    auto env = getenv("VISUS_WRITE_NTHREADS");
+    nthreads = env ? cint(env) : ThreadPool::getShared()->getNumWorkers();
+  }
+
+  //merge and encode run on the shared pool; reads of the next slab overlap with the current one; writes stay in this thread
+  auto tpool  = nthreads > 1 ? ThreadPool::getShared() : SharedPtr<ThreadPool>();
+  auto reader = std::make_shared<ThreadPool>("Ingest Reader", 1);
+
+  if (!access)
+    access = createAccessForBlockQuery();
+
+  if (!access)
+    return false;
+
+  //one single writer and each block is written exactly once
+  access->disableWriteLocks();
+  access->beginWrite();
+
+  auto getSlabBox = [&](Int64 z1) {
+    auto ret = logic_box;
+    ret.p1[axis] = z1;
+    ret.p2[axis] = std::min(z1 + slab_size, logic_box.p2[axis]);
+    return ret;
+  };
+
+  std::deque< Future<Array> > slabs;
+  auto readAhead = [&](Int64 z1) {
+    Promise<Array> promise;
+    slabs.push_back(promise.get_future());
+    auto slab_box = getSlabBox(z1);
+    ThreadPool::push(reader, [readSlab, slab_box, promise]() mutable {
+      promise.set_value(readSlab(slab_box));
+    });
+  };
+
+  //blocks still waiting for samples (i.e. the only part of the volume in memory)
+  class Pending
+  {
+  public:
+    SharedPtr<BlockQuery> block;
+    Int64                 last = 0; //last sample of the block along the slab axis
+  };
+  std::map<BigInt, Pending> pending;
+
+  Int64 pending_bytes = 0, peak_bytes = 0, tot_bytes = 0, nblocks = 0, nslabs = 0;
+  bool bFailed = false;
+  auto t1 = Time::now();
+
+  readAhead(logic_box.p1[axis]);
+  for (Int64 z1 = logic_box.p1[axis]; !bFailed && z1 < logic_box.p2[axis]; z1 += slab_size)
+  {
+    auto slab_box = getSlabBox(z1);
+    auto slab = slabs.front().get();
+    slabs.pop_front();
+
+    if (slab_box.p2[axis] < logic_box.p2[axis])
+      readAhead(slab_box.p2[axis]);
+
+    auto query = createBoxQuery(slab_box, field, time, 'w');
+    beginBoxQuery(query);
+    if (!query->isRunning() || !slab.valid() || slab.dtype != field.dtype || slab.dims.innerProduct() != query->getNumberOfSamples().innerProduct())
+    {
+      PrintWarning("ingestDataset cannot read slab", slab_box.toString(), query->errormsg);
+      bFailed = true;
+      break;
+    }
+
+    query->buffer = slab;
+    query->buffer.dims = query->getNumberOfSamples();
+    tot_bytes += slab.c_size();
+    nslabs++;
+
+    std::vector< SharedPtr<BlockQuery> > touched;
+    for (auto blockid : createBlockQueriesForBoxQuery(query))
+    {
+      auto it = pending.find(blockid);
+      if (it == pending.end())
+      {
+        Pending item;
+        item.block = createBlockQuery(blockid, field, time, 'w');
+        if (!item.block->allocateBufferIfNeeded())
+        {
+          bFailed = true;
+          break;
+        }
+        auto& samples = item.block->logic_samples;
+        item.last = std::min(samples.logic_box.p2[axis] - samples.delta[axis], logic_box.p2[axis] - 1);
+        pending_bytes += item.block->buffer.c_size();
+        it = pending.insert(std::make_pair(blockid, item)).first;
+      }
+      touched.push_back(it->second.block);
+    }
+    peak_bytes = std::max(peak_bytes, pending_bytes + slab.c_size());
+
+    //each block is merged by one task only
+    {
+      ThreadPool::TaskGroup group(tpool, nthreads);
+      for (auto block : touched)
+      {
+        group.push([this, query, block]() {
+          mergeBoxQueryWithBlockQuery(query, block);
+        });
+      }
+    }
+
+    query->buffer = Array();
+    slab = Array();
+
+    //blocks without samples still to come: encode in parallel, write in blockid order (i.e. file by file) as soon as they are ready
+    std::vector< SharedPtr<BlockQuery> > completed;
+    for (auto it = pending.begin(); it != pending.end(); )
+    {
+      if (it->second.last < slab_box.p2[axis])
+      {
+        completed.push_back(it->second.block);
+        it = pending.erase(it);
+      }
+      else
+      {
+        ++it;
+      }
+    }
+
+    std::vector< SharedPtr<ThreadPool::TaskGroup> > encoded;
+    for (auto block : completed)
+    {
+      auto group = std::make_shared<ThreadPool::TaskGroup>(tpool);
+      group->push([access, block]() {
+        access->encodeBlock(block);
+      });
+      encoded.push_back(group);
+    }
+
+    for (int I = 0; I < (int)completed.size(); I++)
+    {
+      auto block = completed[I];
+      encoded[I]->wait();
+      pending_bytes -= block->buffer.c_size();
+
+      if (bFailed)
+        continue;
+
+      executeBlockQueryAndWait(access, block);
+      if (block->failed())
+      {
+        PrintWarning("ingestDataset cannot write block", block->blockid, block->errormsg);
+        bFailed = true;
+      }
+      nblocks++;
+    }
+  }
+
+  //wait for any read ahead
+  while (!slabs.empty())
+  {
+    slabs.front().get();
+    slabs.pop_front();
+  }
+
+  access->endWrite();
+
+  VisusAssert(bFailed || pending.empty());
+  auto sec = t1.elapsedSec();
+  PrintInfo("ingestDataset", bFailed ? "FAILED" : "ok",
+    "nslabs", nslabs, "slab_size", slab_size, "nblocks", nblocks, "nthreads", nthreads,
+    "size", StringUtils::getStringFromByteSize(tot_bytes),
+    "peak-pending", StringUtils::getStringFromByteSize(peak_bytes),
+    "sec", sec, "MB/sec", sec ? (tot_bytes / (1024.0 * 1024.0)) / sec : 0.0);
+
+  return !bFailed;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////
 bool Dataset::insertSamples(LogicSamples Wsamples, Array Wbuffer, LogicSamples Rsamples, Array Rbuffer, Aborted aborted)
 {
@@ -861,7 +1062,7 @@ SharedPtr<BlockQuery> Dataset::createBlockQuery(BigInt blockid, Field field, dou
 }
 
 ////////////////////////////////////////////////
-void Dataset::executeBlockQuery(SharedPtr<Access> access,SharedPtr<BlockQuery> query)
+bool Dataset::beginBlockQuery(SharedPtr<Access> access, SharedPtr<BlockQuery> query)
 {
   VisusAssert(access->isReading() || access->isWriting());
 
@@ -876,7 +1077,7 @@ void Dataset::executeBlockQuery(SharedPtr<Access> access,SharedPtr<BlockQuery> q
     if (!reason.empty())
       PrintInfo("executeBlockQUery failed", reason);
 
-    return;
+    return false;
   };
 
   if (!access)
@@ -906,8 +1107,16 @@ void Dataset::executeBlockQuery(SharedPtr<Access> access,SharedPtr<BlockQuery> q
     query->time = cdouble(query->field.getParam("time"));
 
   query->setRunning();
+  return true;
+}
+
+////////////////////////////////////////////////
+void Dataset::executeBlockQuery(SharedPtr<Access> access,SharedPtr<BlockQuery> query)
+{
+  if (!beginBlockQuery(access, query))
+    return;
 
-  if (mode == 'r')
+  if (query->mode == 'r')
   {
     access->readBlock(query);
     BlockQuery::readBlockEvent();
@@ -917,36 +1126,101 @@ void Dataset::executeBlockQuery(SharedPtr<Access> access,SharedPtr<BlockQuery> q
     access->writeBlock(query);
     BlockQuery::writeBlockEvent();
   }
+}
+
+////////////////////////////////////////////////
+void Dataset::executeBlockQueries(SharedPtr<Access> access, std::vector< SharedPtr<BlockQuery> > queries)
+{
+  VisusAssert(access && access->isReading());
+
+  std::vector< SharedPtr<BlockQuery> > reads;
+  for (auto query : queries)
+  {
+    VisusAssert(query->mode == 'r');
+    if (beginBlockQuery(access, query))
+      reads.push_back(query);
+  }
+
+  if (reads.empty())
+    return;
+
+  access->readBlocks(reads);
 
-  return;
+  for (int I = 0; I < (int)reads.size(); I++)
+    BlockQuery::readBlockEvent();
+}
+
+////////////////////////////////////////////////////////////////////
+std::vector<BlockSummary> Dataset::readBlockSummaries(SharedPtr<Access> access, Field field, double time)
+{
+  bool bEndIO = false;
+  if (!access->isReading())
+  {
+    bEndIO = true;
+    access->beginRead();
+  }
+
+  std::vector<BlockSummary> ret;
+  for (BigInt blockid = 0, nblocks = getTotalNumberOfBlocks(); blockid < nblocks; blockid++)
+  {
+    BlockSummary summary;
+    access->readBlockSummary(field, time, blockid, summary);
+    ret.push_back(summary);
+  }
+
+  if (bEndIO)
+    access->endRead();
+
+  return ret;
+}
+
+////////////////////////////////////////////////////////////////////
+BlockSummary Dataset::computeFieldSummary(SharedPtr<Access> access, Field field, double time, int nbins)
+{
+  return BlockSummary::merge(readBlockSummaries(access, field, time), nbins);
+}
+
+////////////////////////////////////////////////////////////////////
+std::vector<BigInt> Dataset::findBlocksInRange(SharedPtr<Access> access, Field field, double time, Range range, int C)
+{
+  auto summaries = readBlockSummaries(access, field, time);
+
+  std::vector<BigInt> ret;
+  for (int I = 0; I < (int)summaries.size(); I++)
+  {
+    if (summaries[I].mayContain(range, C))
+      ret.push_back(I);
+  }
+  return ret;
 }
 
 ////////////////////////////////////////////////////////////////////
 LogicSamples Dataset::getBlockQuerySamples(BigInt blockid, int& H)
 {
-  auto bitmask = getBitmask();
+  const auto& bitmask = getBitmask();
   auto bitsperblock = getDefaultBitsPerBlock();
   auto samplesperblock = 1 << bitsperblock;
 
   PointNi p0, delta;
   if (blocksFullRes())
   {
-    H = blockid == 0 ? bitsperblock : bitsperblock + 0 + Utils::getLog2(1 + blockid);
+    //NOTE: getAddressResolution(x)-1 is log2(x) for BigInt too
+    H = blockid == 0 ? bitsperblock : bitsperblock + 0 + HzOrder::getAddressResolution(bitmask, 1 + blockid) - 1;
     delta = block_samples[H].delta;
-    Int64 first_block_in_level = (((Int64)1) << (H - bitsperblock)) - 1;
+    BigInt first_block_in_level = (((BigInt)1) << (H - bitsperblock)) - 1;
     auto coord = bitmask.deinterleave(blockid - first_block_in_level, H - bitsperblock);
     p0 = coord.innerMultiply(block_samples[H].logic_box.size());
   }
   else
   {
-    H = blockid == 0 ? bitsperblock : bitsperblock + 1 + Utils::getLog2(0 + blockid);
+    H = blockid == 0 ? bitsperblock : bitsperblock + 1 + HzOrder::getAddressResolution(bitmask, 0 + blockid) - 1;
     delta = block_samples[H].delta;
 
     //for first block I get twice the samples sice the blocking '1' can be '0' considering all previous levels 
     if (blockid == 0)
       delta[bitmask[H]] >>= 1;
 
-    p0 = HzOrder(bitmask).getPoint(blockid * samplesperblock);
+    p0 = fast_hzorder ? fast_hzorder->getPoint(blockid * samplesperblock) : HzOrder(bitmask).getPoint(blockid * samplesperblock);
   }
 
   auto ret = LogicSamples(block_samples[H].logic_box.translate(p0), delta);
@@ -1092,7 +1366,7 @@ bool Dataset::executeBoxQuery(SharedPtr<Access> access, SharedPtr<BoxQuery> quer
   if (auto filter = query->filter.dataset_filter)
     return executeBlockQuerWithFilters(access, query, filter);
 
-  int nread = 0, nwrite = 0;
+  int nread = 0;
 
   //example, say each block is 32kb -> 512*32kb==16MB
   WaitAsync< Future<Void> > wait_async(/*max_running*/512);
@@ -1102,6 +1376,32 @@ bool Dataset::executeBoxQuery(SharedPtr<Access> access, SharedPtr<BoxQuery> quer
   if (query->aborted())
     return false;
 
+  //samples of a previous query do not need to be read again
+  BoxNi reused_box = query->mode == 'r' ? reuseBoxQuerySamples(query) : BoxNi();
+
+  //each sample of the query has one hz address, so blocks write disjoint samples and can be merged in parallel
+  //NOTE: not for datasets with full-res blocks (overlapping) or sub-byte samples (two blocks could write the same byte)
+  //NOTE: small queries (i.e. most of the progressive steps) are not worth the hand-off, they are merged in this thread
+  const Int64 MinParallelMergeSize = 4 * 1024 * 1024;
+
+  SharedPtr<ThreadPool> merge_tpool;
+  int max_merging = 1;
+  if (query->mode == 'r' && !blocksFullRes() && Utils::isByteAligned(query->field.dtype.getBitSize()) && blocks.size() > 1 && query->getByteSize() >= MinParallelMergeSize)
+  {
+    max_merging = this->merge_nthreads;
+    if (max_merging <= 0)
+    {
+      auto env = getenv("VISUS_MERGE_NTHREADS");
+      max_merging = env ? cint(env) : ThreadPool::getShared()->getNumWorkers();
+    }
+
+    if (max_merging > 1)
+      merge_tpool = ThreadPool::getShared();
+  }
+
+  //bounded, so that blocks read but not merged yet are limited too (see wait_async max_running)
+  ThreadPool::TaskGroup merge_group(merge_tpool, max_merging);
+
   //rehentrant call...(just to not close the file too soon)
   bool bEndIO = false;
 	if (query->mode == 'w')
@@ -1121,63 +1421,89 @@ bool Dataset::executeBoxQuery(SharedPtr<Access> access, SharedPtr<BoxQuery> quer
     }
 	}
 
-  for (auto blockid : blocks)
+  if (query->mode == 'w')
   {
-    if (query->aborted())
-      break;
+    bool bOk = writeBlocksForBoxQuery(access, query, blocks);
 
-    nread++;
+    if (bEndIO)
+      access->endIO();
 
-    auto read_block = createBlockQuery(blockid, query->field, query->time, 'r', query->aborted);
+    if (!bOk)
+      return false;
+  }
+  else
+  {
+    //reads are submitted in batches, so the access can sort and merge them (see Access::readBlocks)
+    std::vector< SharedPtr<BlockQuery> > batch;
+    auto flushBatch = [&]() {
+      executeBlockQueries(access, batch);
+      for (auto read_block : batch)
+      {
+        wait_async.pushRunning(read_block->done, [this, query, read_block, &merge_group](Void) {
+          if (query->aborted())
+            return;
 
-		if (query->mode == 'r')
+          //I don't care if the read fails, but its samples cannot be reused by the next query
+          if (!read_block->ok())
+          {
+            if (read_block->logic_samples.valid())
+              query->failed_boxes.push_back(read_block->logic_samples.logic_box);
+            return;
+          }
+
+          //block 0 has all the levels up to bitsperblock (read-modify-write of whole levels), it's always merged in this thread
+          if (read_block->blockid == 0)
+          {
+            mergeBoxQueryWithBlockQuery(query, read_block);
+            return;
+          }
+
+          merge_group.push([this, query, read_block]() {
+            if (!query->aborted())
+              mergeBoxQueryWithBlockQuery(query, read_block);
+          });
+        });
+      }
+      batch.clear();
+    };
+
+    for (auto blockid : blocks)
     {
-      executeBlockQuery(access, read_block);
-      wait_async.pushRunning(read_block->done, [this, query, read_block](Void) {
-        //I don't care if the read fails...
-        if (!query->aborted() && read_block->ok())
-          mergeBoxQueryWithBlockQuery(query, read_block);
+      if (query->aborted())
+        break;
+
+      auto read_block = createBlockQuery(blockid, query->field, query->time, 'r', query->aborted);
+
+      //all the samples of the block I need are already there (and valid)
+      if (reused_box.isFullDim() && read_block->logic_samples.valid() && reused_box.containsBox(read_block->logic_samples.logic_box.getIntersection(query->logic_samples.logic_box)))
+      {
+        auto logic_box = read_block->logic_samples.logic_box;
+        bool bFailed = std::any_of(query->reuse.failed_boxes.begin(), query->reuse.failed_boxes.end(), [&](const BoxNi& failed_box) {
+          return failed_box.getIntersection(logic_box).isFullDim();
         });
+
+        if (!bFailed)
+        {
+          query->reuse.nskipped++;
+          continue;
+        }
+      }
+
+      nread++;
+      batch.push_back(read_block);
+      if (batch.size() == 256)
+        flushBatch();
     }
-    else
-    {
-      //need a lease... so that I can read/merge/write like in a transaction mode
-      access->acquireWriteLock(read_block);
-
-      //need to read and wait the block
-      executeBlockQueryAndWait(access, read_block);
-
-      auto write_block = createBlockQuery(read_block->blockid, query->field, query->time, 'w', query->aborted);
 
-      //read ok
-      if (read_block->ok())
-        write_block->buffer = read_block->buffer;
-      //I don't care if it fails... maybe does not exist
-      else
-        write_block->allocateBufferIfNeeded();
-
-      //here a change in the layout (hzorder) can happen
-      mergeBoxQueryWithBlockQuery(query, write_block);
-
-      //need to write and wait for the block
-      executeBlockQueryAndWait(access, write_block);
-      nwrite++;
-
-      //important! all writings are with a lease!
-      access->releaseWriteLock(read_block);
+    if (!batch.empty())
+      flushBatch();
 
-      if (query->aborted() || write_block->failed()) {
-        if (bEndIO) 
-          access->endIO();
-        return false;
-      }
-    }
+    if (bEndIO)
+      access->endIO();
   }
 
-  if (bEndIO) 
-    access->endIO();
-
   wait_async.waitAllDone();
+  merge_group.wait();
 
   //PrintInfo("aysnc read",concatenate(nread, "/", block_queries.size()),"...");
   //PrintInfo("Query finished", "nread", nread, "nwrite", nwrite);
@@ -1192,6 +1518,157 @@ bool Dataset::executeBoxQuery(SharedPtr<Access> access, SharedPtr<BoxQuery> quer
 
 }
 
+//////////////////////////////////////////////////////////////
+BoxNi Dataset::reuseBoxQuerySamples(SharedPtr<BoxQuery> query)
+{
+  auto Rbuffer = query->reuse.buffer;
+  auto Rsamples = query->reuse.logic_samples;
+  auto Wsamples = query->logic_samples;
+
+  if (!Rbuffer.valid() || !Rsamples.valid() || !Wsamples.valid() || Rbuffer.dtype != query->field.dtype || Rbuffer.dims != Rsamples.nsamples)
+    return BoxNi();
+
+  //failed samples are read again in the first step, copying them again would overwrite the new values
+  if (!query->reuse.failed_boxes.empty() && query->getCurrentResolution() >= query->start_resolution)
+    return BoxNi();
+
+  //each sample of the query must exist in the previous result (i.e. same or finer resolution, same alignment)
+  int pdim = Wsamples.logic_box.getPointDim();
+  for (int D = 0; D < pdim; D++)
+  {
+    if ((Wsamples.delta[D] % Rsamples.delta[D]) != 0 || !Utils::isAligned(Wsamples.logic_box.p1[D], Rsamples.logic_box.p1[D], Rsamples.delta[D]))
+      return BoxNi();
+  }
+
+  auto ret = Wsamples.logic_box.getIntersection(Rsamples.logic_box);
+  if (!ret.isFullDim())
+    return BoxNi();
+
+  if (!query->allocateBufferIfNeeded() || !insertSamples(Wsamples, query->buffer, Rsamples, Rbuffer, query->aborted))
+    return BoxNi();
+
+  return ret;
+}
+
+//////////////////////////////////////////////////////////////
+bool Dataset::writeBlocksForBoxQuery(SharedPtr<Access> access, SharedPtr<BoxQuery> query, const std::vector<BigInt>& blocks)
+{
+  VisusAssert(query->mode == 'w' && access->isWriting());
+
+  //group blocks by file, so that each file is opened (and locked) only once
+  std::vector< std::vector<BigInt> > groups;
+  {
+    std::map<String, int> group_index;
+    for (auto blockid : blocks)
+    {
+      auto filename = access->getFilename(query->field, query->time, blockid);
+      auto it = group_index.find(filename);
+      if (it == group_index.end())
+      {
+        it = group_index.insert(std::make_pair(filename, (int)groups.size())).first;
+        groups.push_back(std::vector<BigInt>());
+      }
+      groups[it->second].push_back(blockid);
+    }
+  }
+
+  int nthreads = this->write_nthreads;
+  if (nthreads <= 0)
+  {
+    auto env = getenv("VISUS_WRITE_NTHREADS");
+    nthreads = env ? cint(env) : ThreadPool::getShared()->getNumWorkers();
+  }
+
+  //merge and encode are CPU bound and run on the shared pool; reads and writes stay in this thread since accesses are not thread safe
+  auto tpool = (nthreads > 1 && blocks.size() > 1) ? ThreadPool::getShared() : SharedPtr<ThreadPool>();
+
+  //limit the number of blocks in memory
+  const int max_pending = 4 * std::max(1, nthreads);
+
+  class Pending
+  {
+  public:
+    SharedPtr<BlockQuery>            read_block;
+    SharedPtr<BlockQuery>            write_block;
+    SharedPtr<ThreadPool::TaskGroup> merged;
+  };
+
+  bool bFailed = false;
+  std::deque<Pending> pending;
+
+  auto writePending = [&]() {
+    auto item = pending.front();
+    pending.pop_front();
+    item.merged->wait();
+
+    if (bFailed || query->aborted())
+      return;
+
+    executeBlockQueryAndWait(access, item.write_block);
+    if (item.write_block->failed())
+      bFailed = true;
+  };
+
+  for (auto& group : groups)
+  {
+    if (bFailed || query->aborted())
+      break;
+
+    //need a lease... so that I can read/merge/write like in a transaction mode
+    auto lease = createBlockQuery(group[0], query->field, query->time, 'r', query->aborted);
+    access->acquireWriteLock(lease);
+
+    for (auto blockid : group)
+    {
+      if (bFailed || query->aborted())
+        break;
+
+      //need to read and wait the block
+      auto read_block = createBlockQuery(blockid, query->field, query->time, 'r', query->aborted);
+      executeBlockQueryAndWait(access, read_block);
+
+      Pending item;
+      item.read_block = read_block;
+      item.write_block = createBlockQuery(blockid, query->field, query->time, 'w', query->aborted);
+      item.merged = std::make_shared<ThreadPool::TaskGroup>(tpool);
+      pending.push_back(item);
+
+      auto write_block = item.write_block;
+      item.merged->push([this, access, query, read_block, write_block]()
+      {
+        //read ok (copy on write: the buffer can be shared with a cache, see RamAccess)
+        if (read_block->ok())
+        {
+          write_block->buffer = read_block->buffer;
+          read_block->buffer = Array();
+          if (write_block->buffer.heap.use_count() > 1)
+            write_block->buffer = write_block->buffer.clone();
+        }
+        //I don't care if it fails... maybe does not exist
+        else
+          write_block->allocateBufferIfNeeded();
+
+        //here a change in the layout (hzorder) can happen
+        mergeBoxQueryWithBlockQuery(query, write_block);
+
+        access->encodeBlock(write_block);
+      });
+
+      while ((int)pending.size() >= max_pending)
+        writePending();
+    }
+
+    //write all blocks of the current file before moving to the next one
+    while (!pending.empty())
+      writePending();
+
+    //important! all writings are with a lease!
+    access->releaseWriteLock(lease);
+  }
+
+  return !bFailed && !query->aborted();
+}
+
 //////////////////////////////////////////////////////////////
 void Dataset::nextBoxQuery(SharedPtr<BoxQuery> query)
 {
@@ -1663,9 +2140,6 @@ void Dataset::beginPointQuery(SharedPtr<PointQuery> query)
   //if you want to set a buffer for 'w' queries, please do it after begin
   VisusAssert(!query->buffer.valid());
 
-  if (getPointDim() != 3)
-    return query->setFailed("pointquery supported only in 3d so far");
-
   if (!query->field.valid())
     return query->setFailed("field not valid");
 
@@ -1998,7 +2472,7 @@ NetRequest Dataset::createPointQueryRequest(SharedPtr<PointQuery> query)
   request.url.setParam("toh", cstring(query->end_resolution));
   request.url.setParam("maxh", cstring(getMaxResolution())); //backward compatible
   request.url.setParam("matrix", query->logic_position.getTransformation().toString());
-  request.url.setParam("box", query->logic_position.getBoxNd().toBox3().toString(/*bInterleave*/false));
+  request.url.setParam("box", query->logic_position.getBoxNd().withPointDim(std::max(3, getPointDim())).toString(/*bInterleave*/false));
   request.url.setParam("nsamples", query->getNumberOfPoints().toString());
 
   request.aborted = query->aborted;
@@ -2241,6 +2715,21 @@ bool Dataset::executeBlockQuerWithFilters(SharedPtr<Access> access, SharedPtr<Bo
 
   int cur_resolution = query->getCurrentResolution();
   int end_resolution = query->end_resolution;
+  int bitsperblock = getDefaultBitsPerBlock();
+
+  //rehentrant call...(one read session for all the levels)
+  bool bEndIO = false;
+  if (!access->isReading())
+  {
+    bEndIO = true;
+    access->beginRead();
+  }
+
+  auto failed = [&]() {
+    if (bEndIO)
+      access->endIO();
+    return false;
+  };
 
   //need to go level by level to rebuild the original data (top-down)
   for (int H = cur_resolution + 1; H <= end_resolution; H++)
@@ -2265,26 +2754,58 @@ bool Dataset::executeBlockQuerWithFilters(SharedPtr<Access> access, SharedPtr<Bo
     if (auto Rquery = query->filter.query)
     {
       if (!Wquery->allocateBufferIfNeeded())
-        return false;
+        return failed();
 
       //interpolate samples seems to be wrong here, produces a lot of artifacts (see david_wavelets)! 
       //could be that I'm inserting wrong coefficients?
       //for now insertSamples seems to work just fine, "interpolating" missing blocks/samples
       if (!insertSamples(Wquery->logic_samples, Wquery->buffer, Rquery->logic_samples, Rquery->buffer, Wquery->aborted))
-        return false;
+        return failed();
 
       //note: start_resolution/end_resolution do not change
       Wquery->setCurrentResolution(Rquery->getCurrentResolution());
     }
 
-    if (!this->executeBoxQuery(access, Wquery))
-      return false;
+    //all the samples of levels [0,bitsperblock] are in block 0: read it only once and merge only the new levels
+    //(the merge never touches levels <=cur_resolution, that already have the inverse filter applied)
+    if (H <= bitsperblock && incremental_filter_query)
+    {
+      auto block0 = query->filter.block0;
+      if (!block0)
+      {
+        block0 = createBlockQuery(0, query->field, query->time, 'r', query->aborted);
+        executeBlockQueryAndWait(access, block0);
+
+        //a failed or aborted read is not kept, so the next query tries again
+        if (block0->ok())
+          query->filter.block0 = block0;
+      }
+
+      if (!Wquery->allocateBufferIfNeeded())
+        return failed();
+
+      //I don't care if the read fails... (see executeBoxQuery)
+      if (block0->ok())
+        mergeBoxQueryWithBlockQuery(Wquery, block0);
+
+      if (Wquery->aborted())
+        return failed();
+
+      Wquery->setCurrentResolution(Wquery->end_resolution);
+    }
+    else if (!this->executeBoxQuery(access, Wquery))
+    {
+      return failed();
+    }
 
     filter->internalComputeFilter(Wquery.get(), /*bInverse*/true);
 
     query->filter.query = Wquery;
   }
 
+  if (bEndIO)
+    access->endIO();
+
   //cannot get samples yet... returning failed as a query without filters...
   if (!query->filter.query)
   {
@@ -2343,6 +2864,7 @@ void Dataset::readDatasetFromArchive(Archive& ar)
     int pdim = bitmask.getPointDim();
     auto MaxH = bitmask.getMaxResolution();
 
+    fast_hzorder = std::make_shared<FastHzOrder>(bitmask);
     level_samples.clear(); level_samples.push_back(LogicSamples(bitmask.getPow2Box(), bitmask.getPow2Dims()));
     block_samples.clear(); block_samples.push_back(LogicSamples(bitmask.getPow2Box(), bitmask.getPow2Dims()));
 
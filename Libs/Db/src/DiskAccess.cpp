@@ -37,6 +37,7 @@ For support : support@visus.net
 -----------------------------------------------------------------------------*/
 
 #include <Visus/DiskAccess.h>
+#include <Visus/DiskCache.h>
 #include <Visus/Dataset.h>
 #include <Visus/File.h>
 #include <Visus/Encoder.h>
@@ -71,10 +72,17 @@ DiskAccess::DiskAccess(Dataset* dataset,StringTree config)
     if (this->compression.empty())
       this->compression = "raw";
 
+    auto cache_dir = config.readString("cache_dir", GetVisusCache());
+
+    //managed cache with a size budget (eviction is per block)
+    auto cache_max_size = StringUtils::getByteSizeFromString(config.readString("cache_max_size", Utils::getEnv("VISUS_CACHE_MAX_SIZE", "0")));
+    if (cache_max_size > 0)
+      this->disk_cache = DiskCache::getSingleton(cache_dir, cache_max_size, config.readString("cache_policy", Utils::getEnv("VISUS_CACHE_POLICY", "lru")));
+
     //automatic guess local *.idx filename for caching
     std::ostringstream out;
     out
-      << config.readString("cache_dir", GetVisusCache()) << "/"
+      << cache_dir << "/"
       << "DiskAccess" << "/"
       << url.getHostname() << "/"
       << url.getPort() << "/"
@@ -99,6 +107,7 @@ DiskAccess::DiskAccess(Dataset* dataset,StringTree config)
     auto  tmp = this->idxfile;
     tmp.version = 0;                                                              //need to fill put for the validate step
     tmp.blocksperfile = 1;                                                        //one file per block
+    tmp.arco_shard = 0;                                                           //the cache evicts files, so no containers here
     tmp.arco = std::max(tmp.arco, (1 << bitsperblock) * tmp.getMaxFieldSize());   //force arco
     tmp.setDefaultCompression(compression);                                       //"" will be equivalent to raw/uncompressed
 
@@ -126,6 +135,9 @@ DiskAccess::DiskAccess(Dataset* dataset,StringTree config)
   //     splitting by 4 means 2^16= 64K files inside a directory with max 64/16=4 levels of directories
   this->filename_template = config.readString("filename_template", Path(local_idx_filename).withoutExtension() + "/$(time)/$(field)/$(block:%016x:%04x)" + blob_extension);
 
+  //sharded layout: the filename is the one of the first block in the container
+  this->arco_shard = this->idxfile.arco_shard;
+
   //0 == no verbose
   //1 == read verbose, write verbose
   //2 ==               write verbose
@@ -133,7 +145,7 @@ DiskAccess::DiskAccess(Dataset* dataset,StringTree config)
 
   this->verbose = 1;
 
-  PrintInfo("Created DiskAccess", "local_idx_filename", local_idx_filename, "filename_template", filename_template, "compression", compression, "bDisableWriteLocks", bDisableWriteLocks);
+  PrintInfo("Created DiskAccess", "local_idx_filename", local_idx_filename, "filename_template", filename_template, "compression", compression, "arco_shard", arco_shard, "bDisableWriteLocks", bDisableWriteLocks);
 }
 
 
@@ -142,6 +154,10 @@ String DiskAccess::getFilename(Field field,double time,BigInt blockid) const
 {
   auto reverse_filename = false;
   auto compression = getCompression(field.default_compression);
+
+  if (arco_shard && blockid >= 0)
+    blockid = ArcoShard::getFirstBlock(blockid, arco_shard);
+
   return getBlockFilename(this->dataset, this->bitsperblock, filename_template, field, time, compression, blockid, reverse_filename);
 }
 
@@ -189,12 +205,16 @@ void DiskAccess::readBlock(SharedPtr<BlockQuery> query)
   auto FAILED = [&](String reason) {
     if (bVerbose)
       PrintInfo("DiskAccess::read blockid", query->blockid, "filename", filename, "failed ", reason);
+    if (disk_cache)
+      disk_cache->miss();
     return readFailed(query, "filename empty");
   };
 
   auto OK = [&]() {
     if (bVerbose)
       PrintInfo("DiskAccess::read blockid", query->blockid, "filename", filename, "OK");
+    if (disk_cache)
+      disk_cache->hit(filename, query->buffer.c_size());
     return readOk(query);
   };
 
@@ -204,16 +224,27 @@ void DiskAccess::readBlock(SharedPtr<BlockQuery> query)
   if (query->aborted())
     return FAILED("query aborted");
 
-  auto encoded=std::make_shared<HeapMemory>();
-  if (!encoded->resize(FileUtils::getFileSize(filename),__FILE__,__LINE__))
-    return FAILED("cannot create encoded buffer");
+  SharedPtr<HeapMemory> encoded;
+  if (arco_shard)
+  {
+    String errormsg;
+    encoded = readShardedBlock(filename, query->blockid, errormsg);
+    if (!encoded)
+      return FAILED(errormsg);
+  }
+  else
+  {
+    encoded = std::make_shared<HeapMemory>();
+    if (!encoded->resize(FileUtils::getFileSize(filename), __FILE__, __LINE__))
+      return FAILED("cannot create encoded buffer");
 
-  File file;
-  if (!file.open(filename,"r"))
-    return FAILED(cstring("cannot open file", filename));
+    File file;
+    if (!file.open(filename, "r"))
+      return FAILED(cstring("cannot open file", filename));
 
-  if (!file.read(0,encoded->c_size(), encoded->c_ptr()))
-    return FAILED("cannot read encoded data");
+    if (!file.read(0, encoded->c_size(), encoded->c_ptr()))
+      return FAILED("cannot read encoded data");
+  }
 
   auto nsamples = query->getNumberOfSamples();
   auto compression = getCompression(query->field.default_compression);
@@ -225,6 +256,12 @@ void DiskAccess::readBlock(SharedPtr<BlockQuery> query)
   decoded.layout= query->field.default_layout;
   query->buffer=decoded;
 
+  if (query->bKeepEncoded)
+  {
+    query->encoded = encoded;
+    query->compression = compression;
+  }
+
   return OK();
 }
 
@@ -244,6 +281,8 @@ void DiskAccess::writeBlock(SharedPtr<BlockQuery> query)
   auto OK = [&]() {
     if (bVerbose)
       PrintInfo("DiskAccess::writeBlock", query->blockid, "filename", filename, "OK");
+    if (disk_cache)
+      disk_cache->written(filename);
     return writeOk(query);
   };
 
@@ -265,6 +304,26 @@ void DiskAccess::writeBlock(SharedPtr<BlockQuery> query)
       return FAILED("only raw major format is supported");
 #endif
 
+  auto decoded=query->buffer;
+  auto compression = getCompression(query->field.default_compression);
+  auto encoded=(query->encoded && query->compression==compression)? query->encoded : ArrayUtils::encodeArray(compression,decoded);
+  if (!encoded)
+  {
+    PrintInfo("Failed to write block filename", filename, "encodeArray failed");
+    return FAILED("Failed to encode data");
+  }
+
+  if (arco_shard)
+  {
+    String errormsg;
+    if (!writeShardedBlock(filename, query->blockid, encoded, errormsg))
+    {
+      PrintInfo("Failed to write block filename", filename, errormsg);
+      return FAILED(errormsg);
+    }
+    return OK();
+  }
+
   FileUtils::removeFile(filename);
 
   File file;
@@ -274,24 +333,226 @@ void DiskAccess::writeBlock(SharedPtr<BlockQuery> query)
     return FAILED("cannot create file or directory");
   }
 
-  auto decoded=query->buffer;
-  auto compression = getCompression(query->field.default_compression);
-  auto encoded=ArrayUtils::encodeArray(compression,decoded);
-  if (!encoded)
-  {
-    PrintInfo("Failed to write block filename", filename, "encodeArray failed");
-    return FAILED("Failed to encode data");
-  }
-
   if (!file.write(0, encoded->c_size(), encoded->c_ptr()))
   {
     PrintInfo("Failed to write block filename", filename, "file.write failed");
     return FAILED("failed to write encoded data");
   }
 
+  file.close();
   return OK();
 }
 
+////////////////////////////////////////////////////////////////////
+SharedPtr<ArcoShard> DiskAccess::readShard(File& file)
+{
+  auto header = std::make_shared<HeapMemory>();
+  if (!header->resize(ArcoShard::getHeaderSize(arco_shard), __FILE__, __LINE__) || !file.read(0, header->c_size(), header->c_ptr()))
+    return SharedPtr<ArcoShard>();
+
+  auto ret = std::make_shared<ArcoShard>();
+  if (!ret->decodeHeader(header, arco_shard))
+    return SharedPtr<ArcoShard>();
+
+  return ret;
+}
+
+////////////////////////////////////////////////////////////////////
+SharedPtr<HeapMemory> DiskAccess::readShardedBlock(String filename, BigInt blockid, String& errormsg)
+{
+  File file;
+  if (!file.open(filename, "r"))
+  {
+    errormsg = cstring("cannot open file", filename);
+    return SharedPtr<HeapMemory>();
+  }
+
+  //the index is read only once for each container and IO session
+  SharedPtr<ArcoShard> shard;
+  {
+    ScopedLock lock(shards_lock);
+    shard = shards[filename];
+  }
+
+  if (!shard)
+  {
+    shard = readShard(file);
+    if (!shard)
+    {
+      errormsg = cstring("cannot read shard index", filename);
+      return SharedPtr<HeapMemory>();
+    }
+
+    ScopedLock lock(shards_lock);
+    shards[filename] = shard;
+  }
+
+  auto entry = shard->getEntry(blockid);
+  if (!entry.offset || !entry.size)
+  {
+    errormsg = "block not stored in shard";
+    return SharedPtr<HeapMemory>();
+  }
+
+  auto encoded = std::make_shared<HeapMemory>();
+  if (!encoded->resize(entry.size, __FILE__, __LINE__) || !file.read(entry.offset, entry.size, encoded->c_ptr()))
+  {
+    errormsg = "cannot read encoded data";
+    return SharedPtr<HeapMemory>();
+  }
+
+  return encoded;
+}
+
+////////////////////////////////////////////////////////////////////
+bool DiskAccess::writeShardedBlock(String filename, BigInt blockid, SharedPtr<HeapMemory> encoded, String& errormsg)
+{
+  //NOTE: the container is protected by the write lock (see acquireWriteLock)
+  File file;
+  SharedPtr<ArcoShard> shard;
+  if (file.open(filename, "rw"))
+  {
+    shard = readShard(file);
+    if (!shard)
+    {
+      errormsg = cstring("cannot read shard index", filename);
+      return false;
+    }
+  }
+  else
+  {
+    if (!file.createAndOpen(filename, "rw"))
+    {
+      errormsg = "cannot create file or directory";
+      return false;
+    }
+
+    shard = std::make_shared<ArcoShard>(arco_shard);
+    auto header = shard->encodeHeader();
+    if (!header || !file.write(0, header->c_size(), header->c_ptr()))
+    {
+      errormsg = "cannot write shard index";
+      return false;
+    }
+  }
+
+  //rewriting a block: reuse its space if the new data fits (or if it's the last one), otherwise append
+  auto old = shard->getEntry(blockid);
+  Int64 file_size = file.size();
+  Int64 offset = std::max(file_size, ArcoShard::getHeaderSize(arco_shard));
+  if (old.offset && (encoded->c_size() <= old.size || old.offset + old.size == file_size))
+    offset = old.offset;
+
+  if (!file.write(offset, encoded->c_size(), encoded->c_ptr()))
+  {
+    errormsg = "failed to write encoded data";
+    return false;
+  }
+
+  shard->setEntry(blockid, offset, encoded->c_size());
+
+  //only the entry of the block changes
+  auto header = shard->encodeHeader();
+  auto entry_offset = ArcoShard::getHeaderSize(ArcoShard::getBlockPosition(blockid, arco_shard));
+  if (!header || !file.write(entry_offset, 16, header->c_ptr() + entry_offset))
+  {
+    errormsg = "cannot write shard index";
+    return false;
+  }
+
+  {
+    ScopedLock lock(shards_lock);
+    shards.erase(filename);
+  }
+
+  //too many unreferenced bytes (i.e. blocks rewritten with bigger sizes)
+  Int64 used_size = ArcoShard::getHeaderSize(arco_shard);
+  for (auto entry : shard->entries)
+    used_size += entry.size;
+
+  if (file.size() - used_size > used_size)
+  {
+    if (!compactShard(file, filename, shard))
+    {
+      errormsg = cstring("cannot compact shard", filename);
+      return false;
+    }
+  }
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////
+bool DiskAccess::compactShard(File& file, String filename, SharedPtr<ArcoShard> shard)
+{
+  //NOTE: the container is protected by the write lock (see acquireWriteLock)
+  auto compacted = std::make_shared<ArcoShard>(*shard);
+  auto offset = ArcoShard::getHeaderSize(arco_shard);
+  for (auto& entry : compacted->entries)
+  {
+    if (!entry.offset || !entry.size) continue;
+    entry.offset = offset;
+    offset += entry.size;
+  }
+
+  HeapMemory data;
+  auto header = compacted->encodeHeader();
+  if (!header || !data.resize(offset, __FILE__, __LINE__))
+    return false;
+
+  memcpy(data.c_ptr(), header->c_ptr(), header->c_size());
+  for (int I = 0; I < shard->getNumberOfBlocks(); I++)
+  {
+    auto src = shard->entries[I];
+    auto dst = compacted->entries[I];
+    if (src.offset && src.size && !file.read(src.offset, src.size, data.c_ptr() + dst.offset))
+      return false;
+  }
+  file.close();
+
+  //mv filename.~compacted -> filename
+  String tmp_filename = filename + ".~compacted";
+  {
+    File tmp;
+    if (!tmp.createAndOpen(tmp_filename, "w") || !tmp.write(0, data.c_size(), data.c_ptr()))
+      return false;
+  }
+
+  FileUtils::removeFile(filename);
+  return FileUtils::moveFile(tmp_filename, filename);
+}
+
+////////////////////////////////////////////////////////////////////
+void DiskAccess::endIO()
+{
+  if (disk_cache && isWriting())
+    disk_cache->flush();
+
+  {
+    ScopedLock lock(shards_lock);
+    shards.clear();
+  }
+
+  Access::endIO();
+}
+
+////////////////////////////////////////////////////////////////////
+void DiskAccess::printStatistics()
+{
+  Access::printStatistics();
+
+  if (disk_cache)
+    disk_cache->printStatistics();
+}
+
+////////////////////////////////////////////////////////////////////
+void DiskAccess::encodeBlock(SharedPtr<BlockQuery> query)
+{
+  auto compression = getCompression(query->field.default_compression);
+  query->encoded = ArrayUtils::encodeArray(compression, query->buffer);
+  query->compression = compression;
+}
+
 } //namespace Visus
 
 
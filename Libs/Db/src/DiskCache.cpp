@@ -0,0 +1,341 @@
+/*-----------------------------------------------------------------------------
+Copyright(c) 2010 - 2018 ViSUS L.L.C.,
+Scientific Computing and Imaging Institute of the University of Utah
+
+ViSUS L.L.C., 50 W.Broadway, Ste. 300, 84101 - 2044 Salt Lake City, UT
+University of Utah, 72 S Central Campus Dr, Room 3750, 84112 Salt Lake City, UT
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met :
+
+* Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED.IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+For additional information about this project contact : pascucci@acm.org
+For support : support@visus.net
+-----------------------------------------------------------------------------*/
+
+#include <Visus/DiskCache.h>
+#include <Visus/File.h>
+#include <Visus/Path.h>
+#include <Visus/Utils.h>
+#include <Visus/Time.h>
+
+#include <sstream>
+#include <algorithm>
+
+namespace Visus {
+
+////////////////////////////////////////////////////////////////////
+DiskCache::DiskCache(String directory_, Int64 max_size_, String policy_)
+  : directory(directory_), max_size(max_size_), policy(policy_)
+{
+  this->metadata_filename = directory + "/visus-disk-cache.txt";
+  load();
+  PrintInfo("Created DiskCache", "directory", directory, "max_size", StringUtils::getStringFromByteSize(max_size), "used_size", StringUtils::getStringFromByteSize(used_size), "policy", policy);
+}
+
+////////////////////////////////////////////////////////////////////
+DiskCache::~DiskCache()
+{
+  ScopedLock lock(this->lock);
+  saveIfNeeded(true);
+}
+
+////////////////////////////////////////////////////////////////////
+SharedPtr<DiskCache> DiskCache::getSingleton(String directory, Int64 max_size, String policy)
+{
+  static CriticalSection lock;
+  static std::map<String, std::weak_ptr<DiskCache> > instances;
+
+  ScopedLock lock_instances(lock);
+  auto ret = instances[directory].lock();
+  if (!ret)
+  {
+    ret = std::make_shared<DiskCache>(directory, max_size, policy);
+    instances[directory] = ret;
+  }
+  else if (ret->max_size != max_size || ret->policy != policy)
+  {
+    //one instance for each directory, otherwise two instances would evict each other's files
+    PrintWarning("DiskCache", directory, "already in use with max_size", StringUtils::getStringFromByteSize(ret->max_size), "policy", ret->policy,
+      "ignoring max_size", StringUtils::getStringFromByteSize(max_size), "policy", policy);
+  }
+  return ret;
+}
+
+////////////////////////////////////////////////////////////////////
+Int64 DiskCache::getUsedSize()
+{
+  ScopedLock lock(this->lock);
+  return used_size;
+}
+
+////////////////////////////////////////////////////////////////////
+DiskCache::Statistics DiskCache::getStatistics()
+{
+  ScopedLock lock(this->lock);
+  return statistics;
+}
+
+////////////////////////////////////////////////////////////////////
+void DiskCache::hit(String filename, Int64 nbytes)
+{
+  ScopedLock lock(this->lock);
+  statistics.hits++;
+  statistics.bytes_saved += nbytes;
+
+  //file written before the cache was managed, start tracking it
+  auto it = entries.find(filename);
+  if (it == entries.end())
+  {
+    Entry entry;
+    entry.size = std::max((Int64)0, FileUtils::getFileSize(filename));
+    it = entries.insert(std::make_pair(filename, entry)).first;
+    used_size += entry.size;
+  }
+
+  it->second.nhits++;
+  it->second.last_access = Time::getTimeStamp();
+  bDirty = true;
+
+  evictIfNeeded(filename);
+  saveIfNeeded(false);
+}
+
+////////////////////////////////////////////////////////////////////
+void DiskCache::miss()
+{
+  ScopedLock lock(this->lock);
+  statistics.misses++;
+}
+
+////////////////////////////////////////////////////////////////////
+void DiskCache::written(String filename)
+{
+  ScopedLock lock(this->lock);
+
+  auto& entry = entries[filename];
+  auto size = std::max((Int64)0, FileUtils::getFileSize(filename));
+  used_size += size - entry.size;
+  entry.size = size;
+  entry.nhits++;
+  entry.last_access = Time::getTimeStamp();
+  bDirty = true;
+
+  evictIfNeeded(filename);
+  saveIfNeeded(false);
+}
+
+////////////////////////////////////////////////////////////////////
+void DiskCache::pin(String filename)
+{
+  ScopedLock lock(this->lock);
+  pinned[filename]++;
+}
+
+////////////////////////////////////////////////////////////////////
+void DiskCache::unpin(String filename)
+{
+  ScopedLock lock(this->lock);
+  auto it = pinned.find(filename);
+  if (it != pinned.end() && --it->second <= 0)
+    pinned.erase(it);
+}
+
+////////////////////////////////////////////////////////////////////
+void DiskCache::flush()
+{
+  ScopedLock lock(this->lock);
+  saveIfNeeded(true);
+}
+
+////////////////////////////////////////////////////////////////////
+void DiskCache::printStatistics()
+{
+  ScopedLock lock(this->lock);
+  PrintInfo("DiskCache", directory, "policy", policy, "used_size", StringUtils::getStringFromByteSize(used_size), "max_size", StringUtils::getStringFromByteSize(max_size), "nfiles", entries.size());
+  PrintInfo("hits", statistics.hits, "misses", statistics.misses, "evictions", statistics.evictions, "evicted", StringUtils::getStringFromByteSize(statistics.evicted_bytes), "saved", StringUtils::getStringFromByteSize(statistics.bytes_saved));
+}
+
+////////////////////////////////////////////////////////////////////
+void DiskCache::evictIfNeeded(const String& keep)
+{
+  if (max_size <= 0 || used_size <= max_size)
+    return;
+
+  //evict down to 90% of the budget so that eviction does not happen at every write
+  auto low_watermark = (max_size / 10) * 9;
+
+  std::vector< std::pair<Entry, String> > v;
+  v.reserve(entries.size());
+  for (auto& it : entries)
+  {
+    //never evict the file that is being accessed or a file kept open by some reader
+    if (it.first != keep && !pinned.count(it.first))
+      v.push_back(std::make_pair(it.second, it.first));
+  }
+
+  //least frequently used first (ties broken by the least recently used) or least recently used first
+  bool bLfu = policy == "lfu";
+  std::sort(v.begin(), v.end(), [bLfu](const std::pair<Entry, String>& a, const std::pair<Entry, String>& b) {
+    if (bLfu && a.first.nhits != b.first.nhits)
+      return a.first.nhits < b.first.nhits;
+    return a.first.last_access < b.first.last_access;
+  });
+
+  for (auto& it : v)
+  {
+    if (used_size <= low_watermark)
+      break;
+
+    auto filename = it.second;
+    auto size = it.first.size;
+
+    if (FileUtils::removeFile(filename))
+    {
+      statistics.evictions++;
+      statistics.evicted_bytes += size;
+    }
+    //still on disk (e.g. in use by another process), keep tracking it and try again later
+    else if (FileUtils::existsFile(filename))
+    {
+      PrintWarning("DiskCache cannot evict", filename);
+      continue;
+    }
+    //else removed by someone else, stop tracking it
+
+    used_size -= size;
+    entries.erase(filename);
+    bDirty = true;
+  }
+
+  saveIfNeeded(true);
+}
+
+////////////////////////////////////////////////////////////////////
+void DiskCache::load()
+{
+  entries = loadEntries();
+  used_size = 0;
+  for (auto& it : entries)
+    used_size += it.second.size;
+}
+
+////////////////////////////////////////////////////////////////////
+std::map<String, DiskCache::Entry> DiskCache::loadEntries()
+{
+  std::map<String, Entry> ret;
+  if (!FileUtils::existsFile(metadata_filename))
+    return ret;
+
+  //format: <size> <nhits> <last_access> <filename relative to directory>
+  std::istringstream in(Utils::loadTextDocument(metadata_filename));
+  String line;
+  while (std::getline(in, line))
+  {
+    if (line.empty() || line[0] == '#')
+      continue;
+
+    std::istringstream parse(line);
+    Entry entry;
+    String filename;
+    parse >> entry.size >> entry.nhits >> entry.last_access;
+    std::getline(parse, filename);
+    filename = StringUtils::trim(filename);
+    if (!parse && filename.empty())
+      continue;
+
+    ret[directory + "/" + filename] = entry;
+  }
+  return ret;
+}
+
+////////////////////////////////////////////////////////////////////
+void DiskCache::save()
+{
+  //other processes can share the directory: merge their usage, and do not overwrite each other's changes
+  ScopedFileLock file_lock(metadata_filename);
+
+  for (auto& it : loadEntries())
+  {
+    auto found = entries.find(it.first);
+    if (found == entries.end())
+    {
+      //written by another process (if not evicted in the meantime)
+      if (!FileUtils::existsFile(it.first))
+        continue;
+      entries[it.first] = it.second;
+      used_size += it.second.size;
+    }
+    else
+    {
+      found->second.nhits = std::max(found->second.nhits, it.second.nhits);
+      found->second.last_access = std::max(found->second.last_access, it.second.last_access);
+    }
+  }
+
+  std::ostringstream out;
+  out << "#visus disk cache usage (size nhits last_access filename)" << std::endl;
+  for (auto& it : entries)
+  {
+    auto filename = it.first;
+    if (StringUtils::startsWith(filename, directory + "/"))
+      filename = filename.substr(directory.size() + 1);
+    out << it.second.size << " " << it.second.nhits << " " << it.second.last_access << " " << filename << std::endl;
+  }
+
+  //write and rename, so that a crash cannot leave a truncated file
+  auto tmp_filename = metadata_filename + ".tmp";
+  try
+  {
+    Utils::saveTextDocument(tmp_filename, out.str());
+    FileUtils::removeFile(metadata_filename);
+    if (!FileUtils::moveFile(tmp_filename, metadata_filename))
+      PrintWarning("DiskCache cannot save", metadata_filename);
+  }
+  catch (std::exception& ex)
+  {
+    PrintWarning("DiskCache cannot save", metadata_filename, ex.what());
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+void DiskCache::saveIfNeeded(bool bForce)
+{
+  if (!bDirty)
+    return;
+
+  //throttle (hits only change access times)
+  auto now = Time::getTimeStamp();
+  if (!bForce && now - last_save < 5000)
+    return;
+
+  save();
+  bDirty = false;
+  last_save = now;
+}
+
+} //namespace Visus
+
@@ -38,6 +38,7 @@ For support : support@visus.net
 
 #include <Visus/IdxDataset.h>
 #include <Visus/IdxHzOrder.h>
+#include <Visus/ThreadPool.h>
 
 namespace Visus {
 
@@ -46,6 +47,86 @@ class ConvertHzOrderSamples
 {
 public:
 
+  /*
+  Copy all the samples of level H stored in the block at hz [hz0,hz0+n) without the kd traversal.
+
+  Since hz0 is aligned to n, the zaddress of hz0+I is zaddress(hz0) | (I << (maxh-H+1)) with disjoint bits, so:
+    P(hz0+I) = P(hz0) + deinterleave(I << (maxh-H+1))
+  and splitting I=(Ihi,Ilo) the query offset is separable:
+    offset(hz0+I) = offset(P(hz0)) + Thi[Ihi] + Tlo[Ilo]
+
+  Returns false (i.e. use the kd traversal) if the query does not cover all the samples or its grid is not aligned to level H.
+  */
+  template <class Sample>
+  bool copyFullLevel(const FastHzOrder& fast_hzorder, int H, BigInt hz0, Int64 n, Int64 block_offset,
+    const LogicSamples& qsamples, const PointNi& stride, GetSamples<Sample>& Wbox, GetSamples<Sample>& Rbox, bool bInvertOrder)
+  {
+    int pdim = fast_hzorder.pdim;
+    int zshift = fast_hzorder.maxh - H + 1;
+    int nbits = HzOrder::getBitLength(n) - 1; VisusAssert(((Int64)1 << nbits) == n);
+    int lo_bits = nbits / 2;
+
+    const auto& qp1 = qsamples.logic_box.p1;
+    const auto& qp2 = qsamples.logic_box.p2;
+    const auto& qshift = qsamples.shift;
+
+    //all samples must be inside the query (note: deinterleave of all "1" is the max offset)
+    auto P0 = fast_hzorder.getPoint(hz0);
+    PointNi dmax(pdim);
+    fast_hzorder.deinterleave(((BigInt)(n - 1)) << zshift, &dmax[0]);
+    for (int D = 0; D < pdim; D++)
+    {
+      if (P0[D] < qp1[D] || P0[D] + dmax[D] >= qp2[D])
+        return false;
+    }
+
+    //offset tables (all samples must be aligned to the query grid)
+    PointNi d(pdim);
+    auto computeTable = [&](std::vector<Int64>& T, int shift) {
+      for (Int64 I = 0; I < (Int64)T.size(); I++)
+      {
+        fast_hzorder.deinterleave(((BigInt)I) << shift, &d[0]);
+        d += P0 - qp1;
+        Int64 offset = 0;
+        for (int D = 0; D < pdim; D++)
+        {
+          if (d[D] & ((((Int64)1) << qshift[D]) - 1))
+            return false;
+          offset += stride[D] * (d[D] >> qshift[D]);
+        }
+        T[I] = offset;
+      }
+      return true;
+    };
+
+    std::vector<Int64> Tlo((Int64)1 << lo_bits), Thi(n >> lo_bits);
+    if (!computeTable(Tlo, zshift) || !computeTable(Thi, zshift + lo_bits))
+      return false;
+
+    //both tables include the offset of P0, keep it only in Tlo
+    Int64 base = stride.dotProduct((P0 - qp1).rightShift(qshift));
+    for (auto& it : Thi)
+      it -= base;
+
+    Int64 nlo = (Int64)Tlo.size();
+    const Int64* tlo = &Tlo[0];
+    Int64 B = block_offset;
+    if (!bInvertOrder)
+    {
+      for (auto Q : Thi)
+        for (Int64 I = 0; I < nlo; I++)
+          Wbox[Q + tlo[I]] = Rbox[B++];
+    }
+    else
+    {
+      for (auto Q : Thi)
+        for (Int64 I = 0; I < nlo; I++)
+          Wbox[B++] = Rbox[Q + tlo[I]];
+    }
+
+    return true;
+  }
+
   //execute
   template <class Sample>
   bool execute(IdxDataset* vf, BoxQuery* query, BlockQuery* block_query)
@@ -101,11 +182,22 @@ public:
     for (int H = 0; H <= max_resolution; H++)
       deltas[H] = H ? (vf->level_samples[H].delta[bitmask[H]] >> 1) : 0;
 
+    auto fast_hzorder = vf->fast_hzorder_merge ? vf->getFastHzOrder() : SharedPtr<FastHzOrder>();
+
     for (int H = hstart; H <= hend; H++)
     {
       if (aborted())
         return false;
 
+      //all the samples of level H inside the block
+      if (fast_hzorder)
+      {
+        BigInt hz0 = HzFrom ? HzFrom : (H ? ((BigInt)1) << (H - 1) : 0);
+        Int64  n = HzFrom ? samplesperblock : (H ? ((Int64)1) << (H - 1) : 1);
+        if (copyFullLevel(*fast_hzorder, H, hz0, n, cint64(hz0 - HzFrom), query->logic_samples, stride, Wbox, Rbox, bInvertOrder))
+          continue;
+      }
+
       LogicSamples Lsamples = vf->level_samples[H];
       PointNi  lshift = Lsamples.shift;
 
@@ -281,66 +373,138 @@ std::vector<BigInt> IdxDataset::createBlockQueriesForPointQuery(SharedPtr<PointQ
   if (blocksFullRes())
     return Dataset::createBlockQueriesForPointQuery(query);
 
-  std::vector<BigInt> ret;
-
-  query->offsets.clear();
+  auto& offsets = query->offsets;
+  offsets.clear();
 
-  auto pdim = getPointDim(); VisusReleaseAssert(pdim==3);
+  auto pdim = getPointDim();
   auto bounds = this->getLogicBox();
-  auto last_bitmask = ((BigInt)1) << (getMaxResolution());
-  auto hzorder = HzOrder(idxfile.bitmask);
-  auto depth_mask = hzorder.getLevelP2Included(query->end_resolution);
+  auto fast_hzorder = getFastHzOrder(); VisusReleaseAssert(fast_hzorder);
+  auto depth_mask = fast_hzorder->hzorder.getLevelP2Included(query->end_resolution);
   auto bitsperblock = getDefaultBitsPerBlock();
-  auto samplesperblock = 1 << bitsperblock;
+  auto SRC = (const Int64*)query->points->c_ptr();
+  auto npoints = query->getNumberOfPoints().innerProduct();
 
-  BigInt blockid, block_offset;
-  int    H;
-  PointNi p(pdim),stride;
-  auto SRC = (Int64*)query->points->c_ptr();
-  BigInt hzaddress;
-  LogicSamples block_samples;
+  //for each point (blockid, block offset), blockid==-1 means outside the dataset
+  std::vector<BigInt> blockids(npoints);
+  std::vector<Int64>  block_offsets(npoints);
 
-  for (int N = 0, Tot = (int)query->getNumberOfPoints().innerProduct(); N < Tot; N++, SRC += pdim)
+  //consecutive points are usually in the same block, so cache the last block samples
+  auto computeBlockOffsets = [&](Int64 from, Int64 to)
   {
-    if (query->aborted()) {
-      query->setFailed("query aborted");
-      return {};
-    }
+    PointNi p(pdim), stride;
+    BigInt last_blockid = -1;
+    LogicSamples block_samples;
+    int H;
 
-    p[0] = SRC[0] & depth_mask[0];
-    p[1] = SRC[1] & depth_mask[1];
-    p[2] = SRC[2] & depth_mask[2];
+    for (Int64 N = from; N < to; N++)
+    {
+      if ((N & 0xffff) == 0 && query->aborted())
+        return;
 
-    if (!(
-      p[0] >= bounds.p1[0] && p[0] < bounds.p2[0] &&
-      p[1] >= bounds.p1[1] && p[1] < bounds.p2[1] &&
-      p[2] >= bounds.p1[2] && p[2] < bounds.p2[2]))
+      auto P = SRC + N * pdim;
+      bool inside = true;
+      for (int D = 0; D < pdim; D++)
+      {
+        p[D] = P[D] & depth_mask[D];
+        inside = inside && p[D] >= bounds.p1[D] && p[D] < bounds.p2[D];
+      }
+
+      if (!inside)
+      {
+        blockids[N] = -1;
+        continue;
+      }
+
+      auto blockid = fast_hzorder->getAddress(&p[0]) >> bitsperblock;
+      if (blockid != last_blockid)
+      {
+        block_samples = getBlockQuerySamples(blockid, H);
+        stride = block_samples.nsamples.stride();
+        last_blockid = blockid;
+      }
+
+      blockids[N] = blockid;
+      block_offsets[N] = stride.dotProduct((p - block_samples.logic_box.p1).rightShift(block_samples.shift));
+    }
+  };
+
+  //split in chunks (running in parallel for big queries)
+  const Int64 chunk_size = 256 * 1024;
+  Int64 nchunks = (npoints + chunk_size - 1) / chunk_size;
+  {
+    auto tpool = nchunks > 1 ? ThreadPool::getShared() : SharedPtr<ThreadPool>();
+    ThreadPool::TaskGroup group(tpool);
+    for (Int64 C = 0; C < nchunks; C++)
     {
-      continue;
+      group.push([&, C]() {
+        computeBlockOffsets(C * chunk_size, std::min(npoints, (C + 1) * chunk_size));
+      });
     }
+    group.wait();
+  }
 
-    hzaddress = hzorder.getAddress(p);
+  if (query->aborted())
+  {
+    query->setFailed("query aborted");
+    return {};
+  }
 
-    blockid = hzaddress >> bitsperblock;
-    if (!query->offsets.count(blockid))
+  //sorted list of blocks
+  auto& blocks = offsets.blocks;
+  for (Int64 N = 0; N < npoints; N++)
+  {
+    if (blockids[N] >= 0 && (blocks.empty() || blocks.back() != blockids[N]))
+      blocks.push_back(blockids[N]);
+  }
+  std::sort(blocks.begin(), blocks.end());
+  blocks.erase(std::unique(blocks.begin(), blocks.end()), blocks.end());
+
+  //counting sort by block (stable, so inside a block points are still in query order)
+  std::vector<Int64> index(npoints);
+  offsets.first.assign(blocks.size() + 1, 0);
+  {
+    Int64 last_index = -1;
+    BigInt last_blockid = -1;
+    for (Int64 N = 0; N < npoints; N++)
     {
-      query->offsets[blockid]=std::make_shared<PointQuery::Offsets>();
-      ret.push_back(blockid);
+      auto blockid = blockids[N];
+      if (blockid < 0)
+      {
+        index[N] = -1;
+        continue;
+      }
+
+      if (blockid != last_blockid)
+      {
+        last_index = std::lower_bound(blocks.begin(), blocks.end(), blockid) - blocks.begin();
+        last_blockid = blockid;
+      }
+
+      index[N] = last_index;
+      offsets.first[last_index + 1]++;
     }
+  }
 
-    block_samples = getBlockQuerySamples(blockid, H);
-    stride = block_samples.nsamples.stride();
+  for (int I = 0; I < (int)blocks.size(); I++)
+    offsets.first[I + 1] += offsets.first[I];
 
-    //todo: is there a better way to get this?
-    block_offset =
-      stride[0] * ((p[0] - block_samples.logic_box.p1[0]) / block_samples.delta[0]) +
-      stride[1] * ((p[1] - block_samples.logic_box.p1[1]) / block_samples.delta[1]) +
-      stride[2] * ((p[2] - block_samples.logic_box.p1[2]) / block_samples.delta[2]);
+  auto tot = offsets.first.back();
+  offsets.block_offset.resize(tot);
+  offsets.point_offset.resize(tot);
+  {
+    auto next = offsets.first;
+    for (Int64 N = 0; N < npoints; N++)
+    {
+      if (index[N] < 0)
+        continue;
 
-    query->offsets[blockid]->push_back(std::make_pair(N, block_offset));
+      auto I = next[index[N]]++;
+      offsets.block_offset[I] = block_offsets[N];
+      offsets.point_offset[I] = N;
+    }
   }
 
-  return ret;
+  return blocks;
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -37,10 +37,12 @@ For support : support@visus.net
 -----------------------------------------------------------------------------*/
 
 #include <Visus/IdxDiskAccess.h>
+#include <Visus/DiskCache.h>
 #include <Visus/StringMap.h>
 #include <Visus/Path.h>
 #include <Visus/Url.h>
 #include <Visus/File.h>
+#include <Visus/Time.h>
 #include <Visus/BlockQuery.h>
 #include <Visus/Encoder.h>
 #include <Visus/IdxHzOrder.h>
@@ -409,10 +411,15 @@ public:
   VISUS_NON_COPYABLE_CLASS(IdxDiskAccessV6)
 
   bool bSkipDecode=false;
+  bool bWriteSummaries=false; //see BlockSummary
+
+  //readBlocks merges the blocks of one file separated by at most <coalesce_gap> bytes (-1 to disable) in reads of at most <coalesce_max> bytes
+  Int64 coalesce_gap = 64 * 1024;
+  Int64 coalesce_max = 8 * 1024 * 1024;
 
   //constructor
-    IdxDiskAccessV6(IdxDiskAccess* owner_, const IdxFile& idxfile_, String time_template_, String filename_template_, String compression, int verbose)
-    : owner(owner_), idxfile(idxfile_), time_template(time_template_), filename_template(filename_template_)
+    IdxDiskAccessV6(IdxDiskAccess* owner_, const IdxFile& idxfile_, String time_template_, String filename_template_, String compression, int verbose, int max_open_files_=0)
+    : owner(owner_), idxfile(idxfile_), time_template(time_template_), filename_template(filename_template_), max_open_files(max_open_files_)
   {
     this->compression = compression;
     this->verbose = verbose;
@@ -423,12 +430,20 @@ public:
 
     this->file = std::make_shared<File>();
 
+    //one fixed-size record for each field and block of the file
+    for (auto field : idxfile.fields)
+    {
+      this->summary_offsets.push_back(this->summaries_size);
+      this->summaries_size += idxfile.blocksperfile * BlockSummary::getRecordSize(field.dtype);
+    }
+
     if (auto env = getenv("VISUS_IDX_SKIP_DECODE"))
       this->bSkipDecode = cbool(String(env));
   }
 
   //destructor
   virtual ~IdxDiskAccessV6() {
+    closeOpenFiles();
     VisusReleaseAssert(!file->isOpen());
     file.reset();
   }
@@ -439,12 +454,69 @@ public:
     return GetFilenameV56(idxfile, time_template, filename_template, field, time, blockid);
   }
 
+  //beginIO
+  virtual void beginIO(int mode) override {
+    //read-only handles (and their headers) would become stale
+    if (mode == 'w')
+      closeOpenFiles();
+    Access::beginIO(mode);
+  }
+
   //endIO
   virtual void endIO() override {
     closeFile("endIO");
+    read_summaries_filename = "";
+    read_summaries.reset();
     Access::endIO();
   }
 
+  //closeOpenFiles
+  void closeOpenFiles()
+  {
+    for (auto it : open_files)
+      closeOpenFile(it->file);
+    open_files.clear();
+  }
+
+  //readBlockSummary
+  virtual bool readBlockSummary(Field field, double time, BigInt blockid, BlockSummary& summary) override
+  {
+    VisusAssert(isReading());
+
+    String filename = getFilename(field, time, blockid);
+    if (filename != read_summaries_filename)
+    {
+      read_summaries_filename = filename;
+      read_summaries = loadSummaries(filename);
+      read_summaries_exists = read_summaries || FileUtils::existsFile(filename);
+    }
+
+    //no block file, all its blocks are missing
+    if (!read_summaries_exists)
+    {
+      summary = BlockSummary::missing();
+      return true;
+    }
+
+    if (!read_summaries)
+      return false;
+
+    summary = BlockSummary::readRecord(getSummaryRecord(*read_summaries, field, blockid), field.dtype);
+    if (summary.valid())
+      return true;
+
+    //no record: either the block is missing or it has been written without summaries
+    if (!openFile(filename, "r"))
+      return false;
+
+    const BlockHeader& block_header = getBlockHeader(field, blockid);
+    if (block_header.getOffset() && block_header.getSize())
+      return false;
+
+    summary = BlockSummary::missing();
+    return true;
+  }
+
   //readBlock
   virtual void readBlock(SharedPtr<BlockQuery> query) override
   {
@@ -509,6 +581,121 @@ public:
     if (!file->read(block_offset, encoded->c_size(), encoded->c_ptr()))
       return FAILED("cannot read encoded buffer");
 
+    return decodeBlock(query, encoded);
+  }
+
+  //readBlocks
+  virtual void readBlocks(std::vector< SharedPtr<BlockQuery> > queries) override
+  {
+    if (coalesce_gap < 0 || queries.size() <= 1)
+      return Access::readBlocks(queries);
+
+    //group by file, in the order files are first needed
+    std::vector<String> filenames;
+    std::map<String, std::vector< SharedPtr<BlockQuery> > > groups;
+    for (auto query : queries)
+    {
+      auto filename = getFilename(query->field, query->time, query->blockid);
+      auto& group = groups[filename];
+      if (group.empty())
+        filenames.push_back(filename);
+      group.push_back(query);
+    }
+
+    for (auto filename : filenames)
+    {
+      const auto& group = groups[filename];
+
+      //missing files and single blocks go the usual way
+      if (group.size() == 1 || !openFile(filename, isWriting() ? "rw" : "r"))
+      {
+        for (auto query : group)
+          readBlock(query);
+        continue;
+      }
+
+      struct Range { Int64 offset; Int64 size; SharedPtr<BlockQuery> query; };
+      std::vector<Range> ranges;
+      for (auto query : group)
+      {
+        const BlockHeader& block_header = getBlockHeader(query->field, query->blockid);
+        if (query->aborted() || !block_header.getOffset() || !block_header.getSize())
+          readBlock(query);
+        else
+          ranges.push_back(Range{ block_header.getOffset(), block_header.getSize(), query });
+      }
+
+      std::sort(ranges.begin(), ranges.end(), [](const Range& a, const Range& b) {
+        return a.offset < b.offset;
+      });
+
+      for (int A = 0, B = 0; A < (int)ranges.size(); A = B)
+      {
+        Int64 begin = ranges[A].offset, end = begin + ranges[A].size;
+        for (B = A + 1; B < (int)ranges.size(); B++)
+        {
+          Int64 next_end = std::max(end, ranges[B].offset + ranges[B].size);
+          if (ranges[B].offset - end > coalesce_gap || next_end - begin > coalesce_max)
+            break;
+          end = next_end;
+        }
+
+        if (B - A == 1)
+        {
+          readBlock(ranges[A].query);
+          continue;
+        }
+
+        HeapMemory merged;
+        if (!merged.resize(end - begin, __FILE__, __LINE__) || !file->read(begin, merged.c_size(), merged.c_ptr()))
+        {
+          for (int I = A; I < B; I++)
+            readBlock(ranges[I].query);
+          continue;
+        }
+
+        for (int I = A; I < B; I++)
+        {
+          auto encoded = std::make_shared<HeapMemory>();
+          if (!encoded->resize(ranges[I].size, __FILE__, __LINE__))
+          {
+            owner->readFailed(ranges[I].query, cstring("cannot resize block block_size", ranges[I].size));
+            continue;
+          }
+          memcpy(encoded->c_ptr(), merged.c_ptr() + (ranges[I].offset - begin), ranges[I].size);
+          decodeBlock(ranges[I].query, encoded);
+        }
+      }
+    }
+  }
+
+  //decodeBlock (<encoded> is the block as stored in the current file)
+  void decodeBlock(SharedPtr<BlockQuery> query, SharedPtr<HeapMemory> encoded)
+  {
+    BigInt blockid = query->blockid;
+    auto& aborted = query->aborted;
+    bool bVerbose = (this->verbose & 1) ? true : false;
+
+    auto FAILED = [&](String reason) {
+      if (bVerbose && !aborted())
+        PrintInfo("IdxDiskAccess::read blockid", blockid, file->getFilename(), "failed ", reason);
+      return owner->readFailed(query, reason);
+    };
+
+    auto OK = [&]() {
+      if (bVerbose)
+        PrintInfo("IdxDiskAccess::read blockid", blockid, file->getFilename(), "OK");
+      return owner->readOk(query);
+    };
+
+    const BlockHeader& block_header = getBlockHeader(query->field, blockid);
+    String compression = block_header.getCompression();
+    String layout      = block_header.getLayout();
+
+    //see readBlock
+    if (compression == "zfp" && StringUtils::startsWith(query->field.default_compression, "zfp"))
+      compression = query->field.default_compression;
+
     if (bVerbose)
       PrintInfo("Decoding buffer");
 
@@ -534,6 +721,12 @@ public:
     VisusAssert(decoded.dims == query->getNumberOfSamples());
     query->buffer = decoded;
 
+    if (query->bKeepEncoded && !bSkipDecode)
+    {
+      query->encoded = encoded;
+      query->compression = compression;
+    }
+
     if (bVerbose)
       PrintInfo("Read block",blockid,"from file",file->getFilename(),"ok");
 
@@ -578,11 +771,11 @@ public:
       return FAILED("Failed to write block, input arguments are wrong");
     }
 
-    //encode the data
+    //encode the data (if not already done by encodeBlock)
     String compression = getCompression(query->field.default_compression);
 
     auto decoded = query->buffer;
-    auto encoded = ArrayUtils::encodeArray(compression, decoded);
+    auto encoded = (query->encoded && query->compression == compression) ? query->encoded : ArrayUtils::encodeArray(compression, decoded);
     if (!encoded)
     {
       VisusAssert(false);
@@ -627,9 +820,26 @@ public:
 
     getBlockHeader(query->field, blockid) = block_header;
 
+    if (write_summaries)
+    {
+      computeBlockSummary(query).writeRecord(getSummaryRecord(*write_summaries, query->field, blockid), query->field.dtype);
+      summaries_dirty = true;
+    }
+
     return OK();
   }
 
+  //encodeBlock
+  virtual void encodeBlock(SharedPtr<BlockQuery> query) override
+  {
+    if (idxfile.version < 6)
+      return;
+
+    String compression = getCompression(query->field.default_compression);
+    query->encoded = ArrayUtils::encodeArray(compression, query->buffer);
+    query->compression = compression;
+  }
+
   //acquireWriteLock
   virtual void acquireWriteLock(SharedPtr<BlockQuery> query) override
   {
@@ -797,6 +1007,42 @@ private:
 
   };
 
+  //___________________________________________
+  //size and modification time of a file, to check that a file kept open did not change on disk (written, replaced or removed by someone else)
+  class FileStamp
+  {
+  public:
+    Int64 size = 0;
+    Int64 mtime = 0;   //seconds
+    bool  trusted = false;
+
+    //get
+    static FileStamp get(String filename) 
+    {
+      //mtime has a resolution of one second: a change in the same second of the stat would go unnoticed
+      auto now = Time::getTimeStamp() / 1000;
+      FileStamp ret;
+      ret.mtime = FileUtils::getTimeLastModified(filename);
+      ret.size = FileUtils::getFileSize(filename);
+      ret.trusted = ret.mtime > 0 && now > ret.mtime;
+      return ret;
+    }
+
+    //operator==
+    bool operator==(const FileStamp& other) const {
+      return size == other.size && mtime == other.mtime;
+    }
+  };
+
+  //___________________________________________
+  class OpenFile
+  {
+  public:
+    SharedPtr<File>       file;
+    SharedPtr<HeapMemory> headers;
+    FileStamp             stamp;
+  };
+
   IdxDiskAccess*  owner;
   IdxFile         idxfile;
   String          time_template;
@@ -806,11 +1052,124 @@ private:
   BlockHeader*    block_headers = nullptr;
   SharedPtr<File> file;
 
+  //read-only files (with their decoded headers) kept open across endIO, most recently used first
+  int                               max_open_files = 0;
+  std::list< SharedPtr<OpenFile> >  open_files;
+  FileStamp                         file_stamp; //of the current file, taken before reading its headers
+
   //re-entrant file lock
   std::map<String, int> file_locks;
 
+  //per-block summaries (see BlockSummary) are stored in a <filename>.summary file next to the block file
+  Int64                 summaries_size = 0;
+  std::vector<Int64>    summary_offsets;        //one for each field
+  SharedPtr<HeapMemory> write_summaries;        //summaries of the file opened for writing (null if the file has none)
+  bool                  summaries_dirty = false;
+  String                read_summaries_filename;
+  SharedPtr<HeapMemory> read_summaries;
+  bool                  read_summaries_exists = false;
+
+  //getSummaryFilename
+  static String getSummaryFilename(String filename) {
+    return filename + ".summary";
+  }
+
+  //getSummaryRecord
+  Uint8* getSummaryRecord(HeapMemory& summaries, Field& field, BigInt blockid) {
+    return summaries.c_ptr() + summary_offsets[cint(field.index)] + idxfile.getBlockPositionInFile(blockid) * BlockSummary::getRecordSize(field.dtype);
+  }
+
+  //loadSummaries
+  SharedPtr<HeapMemory> loadSummaries(String filename)
+  {
+    File file;
+    if (!file.open(getSummaryFilename(filename), "r"))
+      return SharedPtr<HeapMemory>();
+
+    auto ret = std::make_shared<HeapMemory>();
+    if (file.size() != summaries_size || !ret->resize(summaries_size, __FILE__, __LINE__) || !file.read(0, summaries_size, ret->c_ptr()))
+    {
+      PrintWarning("Ignoring wrong block summaries", getSummaryFilename(filename));
+      return SharedPtr<HeapMemory>();
+    }
+
+    return ret;
+  }
+
+  //openSummaries (summaries are updated if enabled or if the file already has them)
+  void openSummaries(String filename, bool bNewFile)
+  {
+    summaries_dirty = false;
+    write_summaries.reset();
+
+    //a summary file left behind by a previous block file would be wrong
+    if (bNewFile)
+      FileUtils::removeFile(getSummaryFilename(filename));
+    else
+      write_summaries = loadSummaries(filename);
+
+    if (!write_summaries && bWriteSummaries)
+    {
+      write_summaries = std::make_shared<HeapMemory>();
+      write_summaries->resize(summaries_size, __FILE__, __LINE__);
+      write_summaries->fill(0);
+    }
+  }
+
+  //closeSummaries
+  void closeSummaries(String filename)
+  {
+    auto summaries = write_summaries;
+    write_summaries.reset();
+
+    if (!summaries || !summaries_dirty)
+      return;
+
+    File file;
+    String summary_filename = getSummaryFilename(filename);
+    if ((!file.open(summary_filename, "rw") && !file.createAndOpen(summary_filename, "rw")) || !file.write(0, summaries->c_size(), summaries->c_ptr()))
+      PrintWarning("cannot write block summaries", summary_filename);
+  }
+
+  //computeBlockSummary (samples outside the dataset logic box are not part of the summary)
+  BlockSummary computeBlockSummary(SharedPtr<BlockQuery> query)
+  {
+    auto buffer = query->buffer;
+    Int64 tot = buffer.getTotalNumberOfSamples();
+    const BoxNi& logic_box = idxfile.logic_box;
+    auto isInside = [&](const PointNi& p) {
+      return logic_box.p1 <= p && p < logic_box.p2;
+    };
+
+    std::vector<Uint8> mask;
+    if (buffer.layout == "hzorder")
+    {
+      if (logic_box != idxfile.bitmask.getPow2Box())
+      {
+        HzOrder hzorder(idxfile.bitmask);
+        BigInt hz0 = query->blockid << bitsperblock;
+        mask.resize(tot);
+        for (Int64 I = 0; I < tot; I++)
+          mask[I] = isInside(hzorder.getPoint(hz0 + I)) ? 1 : 0;
+      }
+    }
+    else
+    {
+      const auto& samples = query->logic_samples;
+      if (samples.valid() && !logic_box.containsBox(samples.logic_box))
+      {
+        mask.resize(tot);
+        Int64 I = 0;
+        for (auto P = ForEachPoint(samples.nsamples); !P.end(); P.next(), I++)
+          mask[I] = isInside(samples.pixelToLogic(P.pos)) ? 1 : 0;
+      }
+    }
+
+    return BlockSummary::compute(buffer, mask.empty() ? nullptr : &mask[0]);
+  }
+
   //getBlockHeader
-  BlockHeader& getBlockHeader(Field& field, Int64 blockid) {
+  BlockHeader& getBlockHeader(Field& field, BigInt blockid) {
     return block_headers[cint(field.index)*idxfile.blocksperfile + idxfile.getBlockPositionInFile(blockid)];
   }
 
@@ -828,6 +1187,31 @@ private:
     if (this->file->isOpen())
       closeFile("need to openFile");
 
+    //reuse a read-only file still open, no need to read the headers again (unless the file changed on disk in the meantime)
+    if (file_mode == "r" && max_open_files > 0)
+    {
+      this->file_stamp = FileStamp::get(filename);
+
+      for (auto it = open_files.begin(); it != open_files.end(); it++)
+      {
+        if ((*it)->file->getFilename() != filename)
+          continue;
+
+        auto open_file = *it;
+        open_files.erase(it);
+
+        if (!(open_file->stamp == this->file_stamp))
+        {
+          closeOpenFile(open_file->file);
+          break;
+        }
+
+        this->file = open_file->file;
+        memcpy(this->headers.c_ptr(), open_file->headers->c_ptr(), this->headers.c_size());
+        return true;
+      }
+    }
+
     if (file_mode == "r")
     {
       if (bVerbose)
@@ -843,6 +1227,8 @@ private:
     //already exist
     if (this->file->open(filename, file_mode))
     {
+      pinFile(filename);
+
       //read the headers
       if (!this->file->read(0, this->headers.c_size(), this->headers.c_ptr()))
       {
@@ -858,6 +1244,9 @@ private:
           ptr[I] = ByteOrder::swapByteOrder(ptr[I]);
       }
 
+      if (this->file->canWrite())
+        openSummaries(filename, /*bNewFile*/false);
+
       return true;
     }
 
@@ -878,6 +1267,8 @@ private:
       return false;
     }
 
+    pinFile(filename);
+
     //write an empty header
     this->headers.fill(0);
     if (!this->file->write(0, this->headers.c_size(), this->headers.c_ptr()))
@@ -889,6 +1280,7 @@ private:
       return false;
     }
 
+    openSummaries(filename, /*bNewFile*/true);
     return true;
   }
 
@@ -901,6 +1293,24 @@ private:
     auto file_mode = this->file->getFileMode();
     auto bVerbose = (file_mode == "rw" && this->verbose) || (file_mode == "r" && (this->verbose & 1));
 
+    //keep it open for later
+    if (file_mode == "r" && max_open_files > 0 && file_stamp.trusted)
+    {
+      auto open_file = std::make_shared<OpenFile>();
+      open_file->file = this->file;
+      open_file->headers = this->headers.clone();
+      open_file->stamp = this->file_stamp;
+      open_files.push_front(open_file);
+      this->file = std::make_shared<File>();
+
+      while ((int)open_files.size() > max_open_files)
+      {
+        closeOpenFile(open_files.back()->file);
+        open_files.pop_back();
+      }
+      return;
+    }
+
     if (file_mode == "r")
     {
       if (bVerbose)
@@ -928,9 +1338,26 @@ private:
         //if (bVerbose)
         PrintInfo("cannot write headers");
       }
+
+      closeSummaries(this->file->getFilename());
     }
 
-    this->file->close();
+    closeOpenFile(this->file);
+  }
+
+  //pinFile (the disk cache must not evict a file while it's open)
+  void pinFile(String filename)
+  {
+    if (auto disk_cache = owner->getDiskCache())
+      disk_cache->pin(filename);
+  }
+
+  //closeOpenFile
+  void closeOpenFile(SharedPtr<File> file)
+  {
+    if (auto disk_cache = owner->getDiskCache())
+      disk_cache->unpin(file->getFilename());
+    file->close();
   }
 
 };
@@ -960,10 +1387,17 @@ IdxDiskAccess::IdxDiskAccess(IdxDataset* dataset, StringTree config)
     if (this->compression.empty())
       this->compression = "raw";
 
+    auto cache_dir = config.readString("cache_dir", GetVisusCache());
+
+    //managed cache with a size budget (eviction is per block file)
+    auto cache_max_size = StringUtils::getByteSizeFromString(config.readString("cache_max_size", Utils::getEnv("VISUS_CACHE_MAX_SIZE", "0")));
+    if (cache_max_size > 0)
+      this->disk_cache = DiskCache::getSingleton(cache_dir, cache_max_size, config.readString("cache_policy", Utils::getEnv("VISUS_CACHE_POLICY", "lru")));
+
     //automatic guess local *.idx filename for caching
     std::ostringstream out;
     out 
-      << config.readString("cache_dir", GetVisusCache()) << "/"
+      << cache_dir << "/"
       << "IdxDiskAccess" << "/"
       << url.getHostname() << "/"
       << url.getPort() << "/"
@@ -1031,16 +1465,32 @@ IdxDiskAccess::IdxDiskAccess(IdxDataset* dataset, StringTree config)
     return value;
   };
   
+  //number of read-only files to keep open between IO sessions (useful for long-lived accesses, e.g. server side)
+  int max_open_files = config.readInt("max_open_files", 0);
+
+  //write per-block summaries (min, max, mean, histogram) next to the block files, see BlockSummary
+  bool bWriteSummaries = config.readBool("block_summary", cbool(Utils::getEnv("VISUS_IDX_BLOCK_SUMMARY", "0")));
+
+  //batched reads: blocks of the same file closer than <read_coalesce_gap> bytes are read together (-1 to disable)
+  Int64 coalesce_gap = cint64(config.readString("read_coalesce_gap", Utils::getEnv("VISUS_IDX_READ_COALESCE_GAP", "65536")));
+  Int64 coalesce_max = cint64(config.readString("read_coalesce_max", Utils::getEnv("VISUS_IDX_READ_COALESCE_MAX", "8388608")));
+
   //NOTE: time_template will go inside filename_template so there is no reason to resolve alias
   auto myCreateAccess = [&]()->Access*{
     if (idxfile.version < 6)
       return new IdxDiskAccessV5(this, idxfile, resoveAlias(idxfile.time_template), resoveAlias(idxfile.filename_template), compression, verbose);
-    else
-      return new IdxDiskAccessV6(this, idxfile, resoveAlias(idxfile.time_template), resoveAlias(idxfile.filename_template), compression, verbose);
+
+    auto ret = new IdxDiskAccessV6(this, idxfile, resoveAlias(idxfile.time_template), resoveAlias(idxfile.filename_template), compression, verbose, max_open_files);
+    ret->bWriteSummaries = bWriteSummaries;
+    ret->coalesce_gap = coalesce_gap;
+    ret->coalesce_max = coalesce_max;
+    return ret;
   };
 
-  this-> sync.reset(myCreateAccess());
-  this->async.reset(myCreateAccess());
+  this->sync.reset(myCreateAccess());
+
+  //summaries are read with a private reader, so they do not interfere with block reads
+  this->summary_reader.reset(myCreateAccess());
 
   //set this only if you know what you are doing (example visus convert with only one process)
   this->bDisableWriteLocks = 
@@ -1067,14 +1517,24 @@ IdxDiskAccess::IdxDiskAccess(IdxDataset* dataset, StringTree config)
   else
     disable_async = config.readBool("disable_async", dataset->isServerMode());
 
-  // important!number of threads must be <=1 
-  if (int nthreads = disable_async ? 0 : 1)
+  //each async worker owns a private reader (i.e. File and block headers) so reading/decoding of independent blocks can go in parallel
+  int nthreads = config.readInt("nthreads", cint(Utils::getEnv("VISUS_IDX_NTHREADS", "1")));
+
+  if (disable_async)
+    nthreads = 0;
+
+  if (nthreads > 0)
   {
+    for (int I = 0; I < nthreads; I++)
+    {
+      this->async.push_back(UniquePtr<Access>(myCreateAccess()));
+      this->async_free.push_back(this->async.back().get());
+    }
     async_tpool = std::make_shared<ThreadPool>("IdxDiskAccess Thread", nthreads);
   }
 #endif
 
-  PrintInfo("Created IdxDiskAccess", "local_idx_filename", local_idx_filename, "compression", compression, "bDisableWriteLocks", bDisableWriteLocks);
+  PrintInfo("Created IdxDiskAccess", "local_idx_filename", local_idx_filename, "compression", compression, "bDisableWriteLocks", bDisableWriteLocks, "nthreads", nthreads);
 }
 
 
@@ -1091,6 +1551,12 @@ IdxDiskAccess::~IdxDiskAccess()
     async_tpool.reset();
   }
 
+  //readers unpin their open files from disk_cache, which is a member declared later (i.e. destroyed before)
+  async_free.clear();
+  async.clear();
+  summary_reader.reset();
+  sync.reset();
+
   //scrgiorgio: I have a problem here, don't know why
   //VisusReleaseAssert(!isReading() && !isWriting());
 }
@@ -1102,6 +1568,24 @@ void IdxDiskAccess::disableAsync()
 }
 
 
+////////////////////////////////////////////////////////////////////
+Access* IdxDiskAccess::acquireAsyncReader()
+{
+  //NOTE: there are as many readers as workers, so there is always one free
+  ScopedLock lock(async_lock);
+  VisusReleaseAssert(!async_free.empty());
+  auto ret = async_free.back();
+  async_free.pop_back();
+  return ret;
+}
+
+////////////////////////////////////////////////////////////////////
+void IdxDiskAccess::releaseAsyncReader(Access* reader)
+{
+  ScopedLock lock(async_lock);
+  async_free.push_back(reader);
+}
+
 ////////////////////////////////////////////////////////////////////
 String IdxDiskAccess::getFilename(Field field,double time,BigInt blockid) const 
 {
@@ -1114,13 +1598,30 @@ void IdxDiskAccess::beginIO(int mode)
   if (async_tpool)
     async_tpool->waitAll();
 
+  //the files kept open by the readers would become stale (see max_open_files)
+  if (mode == 'w')
+  {
+    for (auto& reader : async)
+    {
+      if (auto v6 = dynamic_cast<IdxDiskAccessV6*>(reader.get()))
+        v6->closeOpenFiles();
+    }
+
+    ScopedLock lock(summary_lock);
+    if (auto v6 = dynamic_cast<IdxDiskAccessV6*>(summary_reader.get()))
+      v6->closeOpenFiles();
+  }
+
   Access::beginIO(mode);
 
+  if (!isWriting())
+    summary_reader->beginIO(mode);
+
+  //no job is running here, so I can safely touch the async readers
   if (!isWriting() && async_tpool)
   {
-    ThreadPool::push(async_tpool, [this, mode]() {
-      async->beginIO(mode);
-    });
+    for (auto& reader : async)
+      reader->beginIO(mode);
   }
   else
   {
@@ -1133,10 +1634,9 @@ void IdxDiskAccess::endIO()
 {
   if (!isWriting() && async_tpool)
   {
-    ThreadPool::push(async_tpool, [this]() {
-      async->endIO();
-    });
     async_tpool->waitAll();
+    for (auto& reader : async)
+      reader->endIO();
   }
   else
   {
@@ -1146,6 +1646,16 @@ void IdxDiskAccess::endIO()
   if (async_tpool)
     async_tpool->waitAll();
 
+  if (!isWriting())
+  {
+    ScopedLock lock(summary_lock);
+    summary_reader->endIO();
+  }
+
+  //save usage metadata at the end of a writing session
+  if (disk_cache && isWriting())
+    disk_cache->flush();
+
   Access::endIO();
 }
 
@@ -1179,15 +1689,103 @@ void IdxDiskAccess::readBlock(SharedPtr<BlockQuery> query)
   if (bool bAsync = !isWriting() && async_tpool)
   {
     ThreadPool::push(async_tpool, [this, query]() {
-      return async->readBlock(query);
+      auto reader = acquireAsyncReader();
+      reader->readBlock(query);
+      releaseAsyncReader(reader);
+      cacheReadDone(query);
     });
   }
   else
   {
-    return sync->readBlock(query);
+    sync->readBlock(query);
+    cacheReadDone(query);
   }
 }
 
+////////////////////////////////////////////////////////////////////
+void IdxDiskAccess::readBlocks(std::vector< SharedPtr<BlockQuery> > queries)
+{
+  VisusAssert(isReading() || isWriting());
+
+  if (bSkipReading || queries.size() <= 1)
+    return Access::readBlocks(queries);
+
+  //blocks of the same file go to the same reader, which sorts them by offset and merges the reads
+  std::vector<String> filenames;
+  std::map<String, std::vector< SharedPtr<BlockQuery> > > groups;
+  for (auto query : queries)
+  {
+    if (query->blockid < 0)
+    {
+      readBlock(query);
+      continue;
+    }
+
+    auto filename = getFilename(query->field, query->time, query->blockid);
+    auto& group = groups[filename];
+    if (group.empty())
+      filenames.push_back(filename);
+    group.push_back(query);
+  }
+
+  for (auto filename : filenames)
+  {
+    auto group = groups[filename];
+
+    //blocks are usually stored in blockid order, keep near blocks in the same chunk
+    std::sort(group.begin(), group.end(), [](const SharedPtr<BlockQuery>& a, const SharedPtr<BlockQuery>& b) {
+      return a->blockid < b->blockid;
+    });
+
+    if (!isWriting() && async_tpool)
+    {
+      //split big groups so that all workers have something to decode
+      int nworkers = (int)async.size();
+      int chunk = std::max(1, (int)((group.size() + nworkers - 1) / nworkers));
+      for (int A = 0; A < (int)group.size(); A += chunk)
+      {
+        std::vector< SharedPtr<BlockQuery> > sub(group.begin() + A, group.begin() + std::min(A + chunk, (int)group.size()));
+        ThreadPool::push(async_tpool, [this, sub]() {
+          auto reader = acquireAsyncReader();
+          reader->readBlocks(sub);
+          releaseAsyncReader(reader);
+          for (auto query : sub)
+            cacheReadDone(query);
+        });
+      }
+    }
+    else
+    {
+      sync->readBlocks(group);
+      for (auto query : group)
+        cacheReadDone(query);
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+bool IdxDiskAccess::readBlockSummary(Field field, double time, BigInt blockid, BlockSummary& summary)
+{
+  VisusAssert(isReading());
+  if (!isReading() || blockid < 0)
+    return false;
+
+  ScopedLock lock(summary_lock);
+  return summary_reader->readBlockSummary(field, time, blockid, summary);
+}
+
+////////////////////////////////////////////////////////////////////
+void IdxDiskAccess::cacheReadDone(SharedPtr<BlockQuery> query)
+{
+  if (!disk_cache)
+    return;
+
+  if (query->ok())
+    disk_cache->hit(Access::getFilename(query), query->buffer.c_size());
+  else
+    disk_cache->miss();
+}
+
 
 ////////////////////////////////////////////////////////////////////
 void IdxDiskAccess::writeBlock(SharedPtr<BlockQuery> query)
@@ -1213,9 +1811,21 @@ void IdxDiskAccess::writeBlock(SharedPtr<BlockQuery> query)
     sync->writeBlock(query);
     releaseWriteLock(query);
   }
+
+  if (disk_cache && query->ok())
+    disk_cache->written(Access::getFilename(query));
 }
 
 
+////////////////////////////////////////////////////////////////////
+void IdxDiskAccess::encodeBlock(SharedPtr<BlockQuery> query)
+{
+  if (bSkipWriting)
+    return;
+
+  sync->encodeBlock(query);
+}
+
 ///////////////////////////////////////////////////////
 void IdxDiskAccess::acquireWriteLock(SharedPtr<BlockQuery> query)
 {
@@ -1237,6 +1847,15 @@ void IdxDiskAccess::releaseWriteLock(SharedPtr<BlockQuery> query)
   sync->releaseWriteLock(query);
 }
 
+///////////////////////////////////////////////////////
+void IdxDiskAccess::printStatistics()
+{
+  Access::printStatistics();
+
+  if (disk_cache)
+    disk_cache->printStatistics();
+}
+
 } //namespace Visus
 
 
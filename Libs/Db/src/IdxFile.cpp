@@ -132,6 +132,14 @@ void IdxFile::validate(String url)
 
   auto pdim = bitmask.getPointDim();
 
+  //hz addresses need one extra bit (see HzOrder::zAddressToHzAddress) and BigInt is signed
+  if (bitmask.getMaxResolution() > HzOrder::getMaxSupportedResolution())
+  {
+    PrintWarning("bitmask max resolution", bitmask.getMaxResolution(), "not supported, max is", HzOrder::getMaxSupportedResolution(), "(see VISUS_BIGINT_128)");
+    this->version = -1;
+    return;
+  }
+
   if (!this->bounds.valid())
     this->bounds = this->logic_box;
 
@@ -187,7 +195,7 @@ void IdxFile::validate(String url)
     this->bitsperblock=bitmask.getMaxResolution();
   }
 
-  Int64 totblocks = ((Int64)1) << (bitmask.getMaxResolution() - bitsperblock);
+  BigInt totblocks = ((BigInt)1) << (bitmask.getMaxResolution() - bitsperblock);
 
   //one file per dataset
   if (blocksperfile == -1)
@@ -265,6 +273,9 @@ void IdxFile::validate(String url)
   }
 #endif
 
+  if (!this->arco || this->arco_shard < 0)
+    this->arco_shard = 0;
+
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -470,6 +481,9 @@ String IdxFile::writeToOldFormat() const
   out << "(missing_blocks)\n" << missing_blocks << "\n";
   out << "(arco)\n" << arco << "\n";
 
+  if (arco_shard)
+    out << "(arco_shard)\n" << arco_shard << "\n";
+
   //write other medatata
   for (auto it : this->metadata)
     out << "(" << it.first << ")\n" << it.second<< "\n"; 
@@ -607,6 +621,12 @@ void IdxFile::readFromOldFormat(const String& content)
   this->arco = cint(map.getValue("(arco)"));
   map.eraseValue("(arco)");
 
+  if (map.hasValue("(arco_shard)"))
+  {
+    this->arco_shard = cint(map.getValue("(arco_shard)"));
+    map.eraseValue("(arco_shard)");
+  }
+
   if (map.hasValue("(interleave)"))
   {
     this->block_interleaving = cint(map.getValue("(interleave)"));
@@ -698,6 +718,10 @@ void IdxFile::write(Archive& ar) const
   ar.addChild("filename_template")->write("value", filename_template);
   ar.addChild("missing_blocks")->write("value", missing_blocks);
   ar.addChild("arco")->write("value", arco);
+
+  if (arco_shard)
+    ar.addChild("arco_shard")->write("value", arco_shard);
+
   ar.addChild("time_template")->write("value", time_template);
 
   auto logic_to_physic = Position::computeTransformation(this->bounds, this->logic_box);
@@ -735,6 +759,10 @@ void IdxFile::read(Archive& ar)
   ar.getChild("filename_template")->read("value", filename_template);
   ar.getChild("missing_blocks")->read("value", missing_blocks);
   ar.getChild("arco")->read("value", arco);
+
+  if (auto child = ar.getChild("arco_shard"))
+    child->read("value", arco_shard);
+
   ar.getChild("time_template")->read("value", time_template);
 
   if (ar.hasAttribute("physic_box"))
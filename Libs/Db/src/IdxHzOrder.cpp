@@ -38,6 +38,236 @@ For support : support@visus.net
 
 #include <Visus/IdxHzOrder.h>
 
+#include <algorithm>
+#include <cstdlib>
+
+#if (defined(__x86_64__) || defined(_M_X64)) && !defined(SWIG)
+  #define VISUS_HZORDER_BMI2 1
+  #include <immintrin.h>
+  #if defined(_MSC_VER)
+    #define VISUS_TARGET_BMI2
+  #else
+    #define VISUS_TARGET_BMI2 __attribute__((target("bmi2")))
+  #endif
+#endif
+
 namespace Visus  {
+
+#if VISUS_HZORDER_BMI2
+
+//////////////////////////////////////////////////////////////////
+class HzOrderBMI2
+{
+public:
+
+  //the zaddress bits of each dimension, split in two 64 bit words
+  Uint64 lo[5] = { 0,0,0,0,0 };
+  Uint64 hi[5] = { 0,0,0,0,0 };
+  int    nlo[5] = { 0,0,0,0,0 };
+
+  //constructor
+  HzOrderBMI2(const std::vector<BigInt>& zmask)
+  {
+    for (int D = 0; D < (int)zmask.size(); D++)
+    {
+      lo[D] = (Uint64)zmask[D];
+#if VISUS_BIGINT_128
+      hi[D] = (Uint64)(zmask[D] >> 64);
+#endif
+      for (auto v = lo[D]; v; v &= v - 1)
+        nlo[D]++;
+    }
+  }
+
+  //interleave
+  VISUS_TARGET_BMI2 inline BigInt interleave(const Int64* p, int pdim) const
+  {
+    Uint64 zlo = 0;
+    for (int D = 0; D < pdim; D++)
+      zlo |= _pdep_u64((Uint64)p[D], lo[D]);
+#if VISUS_BIGINT_128
+    Uint64 zhi = 0;
+    for (int D = 0; D < pdim; D++)
+    {
+      if (hi[D] && nlo[D] < 64)
+        zhi |= _pdep_u64((Uint64)p[D] >> nlo[D], hi[D]);
+    }
+    return (((BigInt)zhi) << 64) | (BigInt)zlo;
+#else
+    return (BigInt)zlo;
+#endif
+  }
+
+  //deinterleave
+  VISUS_TARGET_BMI2 inline void deinterleave(BigInt z, Int64* p, int pdim) const
+  {
+    for (int D = 0; D < pdim; D++)
+      p[D] = (Int64)_pext_u64((Uint64)z, lo[D]);
+#if VISUS_BIGINT_128
+    Uint64 zhi = (Uint64)(z >> 64);
+    for (int D = 0; D < pdim; D++)
+    {
+      if (hi[D] && nlo[D] < 64)
+        p[D] |= (Int64)(_pext_u64(zhi, hi[D]) << nlo[D]);
+    }
+#endif
+  }
+
+};
+
+//////////////////////////////////////////////////////////////////
+VISUS_TARGET_BMI2 static void BatchGetAddressBMI2(const HzOrder& hzorder, const HzOrderBMI2& engine, const Int64* points, Int64 npoints, BigInt* ret)
+{
+  int pdim = hzorder.pdim;
+  for (Int64 I = 0; I < npoints; I++, points += pdim)
+    ret[I] = hzorder.zAddressToHzAddress(engine.interleave(points, pdim));
+}
+
+//////////////////////////////////////////////////////////////////
+VISUS_TARGET_BMI2 static void BatchGetPointBMI2(const HzOrder& hzorder, const HzOrderBMI2& engine, const BigInt* hz, Int64 npoints, Int64* points)
+{
+  int pdim = hzorder.pdim;
+  for (Int64 I = 0; I < npoints; I++, points += pdim)
+    engine.deinterleave(hzorder.hzAddressToZAddress(hz[I]), points, pdim);
+}
+
+#endif
+
+//////////////////////////////////////////////////////////////////
+FastHzOrder::FastHzOrder(const DatasetBitmask& bitmask, int maxh_) : hzorder(bitmask, maxh_), pdim(bitmask.getPointDim()), maxh(maxh_)
+{
+  VisusReleaseAssert(bitmask.valid());
+  VisusReleaseAssert(pdim >= 1 && pdim <= 5);
+  VisusReleaseAssert(maxh >= 0 && maxh <= HzOrder::getMaxSupportedResolution());
+
+  //zbits[D][K] is the position in the zaddress of the K-th bit of p[D] (see HzOrder::interleave)
+  std::vector< std::vector<int> > zbits(pdim);
+  for (int shift = 0; shift < maxh; shift++)
+    zbits[bitmask[maxh - shift]].push_back(shift);
+
+  zmask.assign(pdim, 0);
+  nchunks = 0;
+  for (int D = 0; D < pdim; D++)
+  {
+    VisusReleaseAssert(zbits[D].size() < 64);
+    for (auto shift : zbits[D])
+      zmask[D] |= ((BigInt)1) << shift;
+    nchunks = std::max(nchunks, ((int)zbits[D].size() + 7) / 8);
+  }
+
+  interleave_table.assign(pdim * nchunks * 256, 0);
+  for (int D = 0; D < pdim; D++)
+  {
+    for (int K = 0; K < (int)zbits[D].size(); K++)
+    {
+      int C = K / 8, bit = K % 8;
+      for (int V = 0; V < 256; V++)
+      {
+        if (V & (1 << bit))
+          interleave_table[(D * nchunks + C) * 256 + V] |= ((BigInt)1) << zbits[D][K];
+      }
+    }
+  }
+
+  int nzbytes = std::max(1, (maxh + 7) / 8);
+  deinterleave_table.assign(nzbytes * 256 * pdim, 0);
+  for (int D = 0; D < pdim; D++)
+  {
+    for (int K = 0; K < (int)zbits[D].size(); K++)
+    {
+      int zbyte = zbits[D][K] / 8, bit = zbits[D][K] % 8;
+      for (int V = 0; V < 256; V++)
+      {
+        if (V & (1 << bit))
+          deinterleave_table[(zbyte * 256 + V) * pdim + D] |= ((Int64)1) << K;
+      }
+    }
+  }
+
+#if VISUS_HZORDER_BMI2
+  if (isBMI2Supported())
+  {
+    auto env = getenv("VISUS_HZORDER_BMI2");
+    this->bmi2 = std::make_shared<HzOrderBMI2>(zmask);
+    this->use_bmi2 = !(env && String(env) == "0");
+  }
+#endif
+}
+
+//////////////////////////////////////////////////////////////////
+bool FastHzOrder::isBMI2Supported()
+{
+#if VISUS_HZORDER_BMI2
+  static bool ret = []() {
+  #if defined(_MSC_VER)
+    int info[4];
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 8)) != 0;
+  #else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("bmi2") != 0;
+  #endif
+  }();
+  return ret;
+#else
+  return false;
+#endif
+}
+
+#if VISUS_HZORDER_BMI2
+
+//////////////////////////////////////////////////////////////////
+VISUS_TARGET_BMI2 BigInt FastHzOrder::interleaveBMI2(const Int64* p) const
+{
+  VisusAssert(bmi2);
+  return bmi2->interleave(p, pdim);
+}
+
+//////////////////////////////////////////////////////////////////
+VISUS_TARGET_BMI2 void FastHzOrder::deinterleaveBMI2(BigInt z, Int64* p) const
+{
+  VisusAssert(bmi2);
+  bmi2->deinterleave(z, p, pdim);
+}
+
+#else
+
+//////////////////////////////////////////////////////////////////
+BigInt FastHzOrder::interleaveBMI2(const Int64* p) const {
+  ThrowException("internal error, BMI2 not supported");
+  return 0;
+}
+
+//////////////////////////////////////////////////////////////////
+void FastHzOrder::deinterleaveBMI2(BigInt z, Int64* p) const {
+  ThrowException("internal error, BMI2 not supported");
+}
+
+#endif
+
+//////////////////////////////////////////////////////////////////
+void FastHzOrder::getAddress(const Int64* points, Int64 npoints, BigInt* ret) const
+{
+#if VISUS_HZORDER_BMI2
+  if (use_bmi2)
+    return BatchGetAddressBMI2(hzorder, *bmi2, points, npoints, ret);
+#endif
+
+  for (Int64 I = 0; I < npoints; I++, points += pdim)
+    ret[I] = hzorder.zAddressToHzAddress(interleave(points));
+}
+
+//////////////////////////////////////////////////////////////////
+void FastHzOrder::getPoint(const BigInt* hz, Int64 npoints, Int64* points) const
+{
+#if VISUS_HZORDER_BMI2
+  if (use_bmi2)
+    return BatchGetPointBMI2(hzorder, *bmi2, hz, npoints, points);
+#endif
+
+  for (Int64 I = 0; I < npoints; I++, points += pdim)
+    deinterleave(hzorder.hzAddressToZAddress(hz[I]), points);
+}
+
 } //namespace Visus
 
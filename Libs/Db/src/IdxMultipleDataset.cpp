@@ -122,10 +122,29 @@ Field IdxMultipleDataset::getFieldEx(String FIELDNAME) const
   else
     CODE = FIELDNAME; //the fieldname itself is the expression
 
-  auto OUTPUT = computeOuput(/*QUERY*/nullptr, /*ACCESS*/SharedPtr<Access>(), Aborted(), CODE);
+  auto OUTPUT = executeCode(/*QUERY*/nullptr, /*ACCESS*/SharedPtr<Access>(), Aborted(), CODE);
   return Field(CODE, OUTPUT.dtype);
 }
 
+////////////////////////////////////////////////////////////////////////////////////
+Array IdxMultipleDataset::executeCode(BoxQuery* QUERY, SharedPtr<Access> ACCESS, Aborted aborted, String CODE) const
+{
+  SharedPtr<IdxMultipleExpression> expression;
+  if (native_expressions)
+  {
+    ScopedLock lock(expressions_lock);
+    auto it = expressions.find(CODE);
+    if (it == expressions.end())
+      it = expressions.insert(std::make_pair(CODE, IdxMultipleExpression::compile(this, CODE))).first;
+    expression = it->second;
+  }
+
+  if (expression)
+    return expression->evaluate(this, QUERY, ACCESS, aborted);
+
+  return computeOuput(QUERY, ACCESS, aborted, CODE);
+}
+
 ////////////////////////////////////////////////////////////////////////////////////
 String IdxMultipleDataset::getInputName(String dataset_name, String fieldname)
 {
@@ -360,7 +379,7 @@ bool IdxMultipleDataset::executeBoxQuery(SharedPtr<Access> ACCESS,SharedPtr<BoxQ
   Array  OUTPUT;
   try
   {
-    OUTPUT = computeOuput(QUERY.get(), ACCESS, QUERY->aborted, QUERY->field.name);
+    OUTPUT = executeCode(QUERY.get(), ACCESS, QUERY->aborted, QUERY->field.name);
   }
   catch (const std::exception& ex)
   {
@@ -646,6 +665,7 @@ void IdxMultipleDataset::readDatasetFromArchive(Archive& ar)
   //i need this because parseDatasets will call getUrl to remove aliases
   this->dataset_body = ar;
   this->kdquery_mode = KdQueryMode::fromString(ar.readString("kdquery"));
+  this->native_expressions = cbool(ar.readString("native_expressions", Utils::getEnv("VISUS_MIDX_NATIVE", "1")));
   
   for (auto& it : ar.getChilds())
     parseDatasets(*it, Matrix());
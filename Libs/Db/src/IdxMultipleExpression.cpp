@@ -0,0 +1,1216 @@
+/*-----------------------------------------------------------------------------
+Copyright(c) 2010 - 2018 ViSUS L.L.C.,
+Scientific Computing and Imaging Institute of the University of Utah
+
+ViSUS L.L.C., 50 W.Broadway, Ste. 300, 84101 - 2044 Salt Lake City, UT
+University of Utah, 72 S Central Campus Dr, Room 3750, 84112 Salt Lake City, UT
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met :
+
+* Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED.IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+For additional information about this project contact : pascucci@acm.org
+For support : support@visus.net
+-----------------------------------------------------------------------------*/
+
+
+#include <Visus/IdxMultipleExpression.h>
+#include <Visus/IdxMultipleDataset.h>
+#include <Visus/ArrayUtils.h>
+#include <Visus/ThreadPool.h>
+
+#include <cmath>
+#include <cctype>
+
+namespace Visus {
+
+////////////////////////////////////////////////////////////////////////////////////
+class IdxMultipleExpression::Node
+{
+public:
+
+  enum Kind
+  {
+    InputKind,
+    BlendKind,
+    ComponentKind,
+    CastKind,
+    OperationKind,
+    ScalarKind,
+    SqrtKind
+  };
+
+  enum ScalarOp
+  {
+    ScalarAdd,
+    ScalarSub,  //array-k
+    ScalarRSub, //k-array
+    ScalarMul,
+    ScalarRDiv  //k/array
+  };
+
+  Kind                           kind;
+  std::vector< SharedPtr<Node> > args;
+
+  String                dataset_name;   //InputKind
+  String                fieldname;      //InputKind
+  BlendBuffers::Type    blend_type = BlendBuffers::NoBlend; //BlendKind (no args means the default field of all datasets)
+  int                   component = 0;  //ComponentKind
+  DType                 dtype;          //CastKind
+  ArrayUtils::Operation op = ArrayUtils::InvalidOperation; //OperationKind
+  ScalarOp              scalar_op = ScalarAdd; //ScalarKind
+  double                k = 0;          //ScalarKind
+
+  //constructor
+  Node(Kind kind_, std::vector< SharedPtr<Node> > args_ = std::vector< SharedPtr<Node> >()) : kind(kind_), args(args_) {
+  }
+
+  //isPointwise
+  bool isPointwise() const {
+    return kind != InputKind && kind != BlendKind;
+  }
+
+};
+
+namespace IdxMultipleExpressionPrivate {
+
+typedef IdxMultipleExpression::Node Node;
+
+////////////////////////////////////////////////////////////////////////////////////
+class Token
+{
+public:
+
+  enum Type { End, Number, Str, Name, Op, Newline };
+
+  Type   type = End;
+  String s;
+  double number = 0;
+
+  //constructor
+  Token(Type type_ = End, String s_ = "", double number_ = 0) : type(type_), s(s_), number(number_) {
+  }
+
+  //is
+  bool is(Type type, String s) const {
+    return this->type == type && this->s == s;
+  }
+};
+
+//////////////////////////////////////////////////////////////////////////////////////
+static bool Tokenize(String code, std::vector<Token>& tokens)
+{
+  int N = (int)code.size();
+  for (int I = 0; I < N; )
+  {
+    char ch = code[I];
+
+    if (ch == '#')
+    {
+      while (I < N && code[I] != '\n') I++;
+    }
+    else if (ch == '\n')
+    {
+      tokens.push_back(Token(Token::Newline, "\n"));
+      I++;
+    }
+    else if (std::isspace(ch))
+    {
+      I++;
+    }
+    else if (std::isdigit(ch) || (ch == '.' && I + 1 < N && std::isdigit(code[I + 1])))
+    {
+      int J = I;
+      while (J < N && (std::isdigit(code[J]) || code[J] == '.')) J++;
+      if (J < N && (code[J] == 'e' || code[J] == 'E'))
+      {
+        J++;
+        if (J < N && (code[J] == '+' || code[J] == '-')) J++;
+        while (J < N && std::isdigit(code[J])) J++;
+      }
+      tokens.push_back(Token(Token::Number, code.substr(I, J - I), cdouble(code.substr(I, J - I))));
+      I = J;
+    }
+    else if (std::isalpha(ch) || ch == '_')
+    {
+      int J = I;
+      while (J < N && (std::isalnum(code[J]) || code[J] == '_')) J++;
+      tokens.push_back(Token(Token::Name, code.substr(I, J - I)));
+      I = J;
+    }
+    else if (ch == '\'' || ch == '"')
+    {
+      bool triple = I + 2 < N && code[I + 1] == ch && code[I + 2] == ch;
+      String quote = triple ? String(3, ch) : String(1, ch);
+      String value;
+      int J = I + (int)quote.size();
+      for (; J < N && code.compare(J, quote.size(), quote) != 0; J++)
+      {
+        if (code[J] == '\n' && !triple)
+          return false;
+
+        if (code[J] == '\\' && J + 1 < N)
+        {
+          char next = code[++J];
+          value.push_back(next == 'n' ? '\n' : (next == 't' ? '\t' : next));
+        }
+        else
+        {
+          value.push_back(code[J]);
+        }
+      }
+      if (J >= N)
+        return false;
+      tokens.push_back(Token(Token::Str, value));
+      I = J + (int)quote.size();
+    }
+    else if (String("=+-*/()[],.;").find(ch) != String::npos)
+    {
+      //not supported: ==, **, //, +=...
+      if (I + 1 < N && String("=+-*/").find(ch) != String::npos && (code[I + 1] == '=' || (code[I + 1] == ch && (ch == '*' || ch == '/'))))
+        return false;
+      tokens.push_back(Token(Token::Op, String(1, ch)));
+      I++;
+    }
+    else
+    {
+      return false;
+    }
+  }
+  tokens.push_back(Token(Token::End));
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+class Value
+{
+public:
+
+  enum Type { Invalid, Number, Str, DTypeValue, Expr, List, Input, InputDataset, Module, Function };
+
+  Type               type = Invalid;
+  double             number = 0;
+  String             s;
+  DType              dtype;
+  SharedPtr<Node>    node;
+  std::vector<Value> list;
+
+  //constructor
+  Value(Type type_ = Invalid, String s_ = "") : type(type_), s(s_) {
+  }
+
+  //valid
+  bool valid() const {
+    return type != Invalid;
+  }
+
+  //fromNumber
+  static Value fromNumber(double value) {
+    Value ret(Number);
+    ret.number = value;
+    return ret;
+  }
+
+  //fromNode
+  static Value fromNode(SharedPtr<Node> node) {
+    Value ret(Expr);
+    ret.node = node;
+    return ret;
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////////
+class Parser
+{
+public:
+
+  const IdxMultipleDataset* DATASET;
+  std::vector<Token>        tokens;
+  int                       pos = 0;
+  std::map<String, Value>   vars;
+
+  //constructor
+  Parser(const IdxMultipleDataset* DATASET_) : DATASET(DATASET_) {
+  }
+
+  //parseProgram
+  SharedPtr<Node> parseProgram(String code)
+  {
+    if (!Tokenize(code, tokens))
+      return SharedPtr<Node>();
+
+    for (;;)
+    {
+      while (tokens[pos].type == Token::Newline || tokens[pos].is(Token::Op, ";"))
+        pos++;
+
+      if (tokens[pos].type == Token::End)
+        break;
+
+      //only assignments
+      if (tokens[pos].type != Token::Name || !tokens[pos + 1].is(Token::Op, "="))
+        return SharedPtr<Node>();
+
+      auto name = tokens[pos].s;
+      pos += 2;
+
+      auto value = parseExpr();
+      if (!value.valid())
+        return SharedPtr<Node>();
+
+      vars[name] = value;
+
+      if (!(tokens[pos].type == Token::Newline || tokens[pos].type == Token::End || tokens[pos].is(Token::Op, ";")))
+        return SharedPtr<Node>();
+    }
+
+    auto it = vars.find("output");
+    return it != vars.end() && it->second.type == Value::Expr ? it->second.node : SharedPtr<Node>();
+  }
+
+private:
+
+  //accept
+  bool accept(String op) {
+    if (!tokens[pos].is(Token::Op, op)) return false;
+    pos++;
+    return true;
+  }
+
+  //parseExpr
+  Value parseExpr()
+  {
+    auto ret = parseTerm();
+    while (ret.valid() && (tokens[pos].is(Token::Op, "+") || tokens[pos].is(Token::Op, "-")))
+    {
+      auto op = tokens[pos++].s;
+      ret = binaryOp(op, ret, parseTerm());
+    }
+    return ret;
+  }
+
+  //parseTerm
+  Value parseTerm()
+  {
+    auto ret = parseUnary();
+    while (ret.valid() && (tokens[pos].is(Token::Op, "*") || tokens[pos].is(Token::Op, "/")))
+    {
+      auto op = tokens[pos++].s;
+      ret = binaryOp(op, ret, parseUnary());
+    }
+    return ret;
+  }
+
+  //parseUnary
+  Value parseUnary()
+  {
+    if (accept("+"))
+      return parseUnary();
+
+    if (accept("-"))
+      return binaryOp("-", Value::fromNumber(0), parseUnary());
+
+    return parsePostfix();
+  }
+
+  //parsePostfix
+  Value parsePostfix()
+  {
+    auto ret = parsePrimary();
+    while (ret.valid())
+    {
+      if (accept("."))
+      {
+        if (tokens[pos].type != Token::Name)
+          return Value();
+        ret = getAttr(ret, tokens[pos++].s);
+      }
+      else if (accept("["))
+      {
+        auto index = parseExpr();
+        if (!accept("]"))
+          return Value();
+        ret = getItem(ret, index);
+      }
+      else if (accept("("))
+      {
+        std::vector<Value> args;
+        while (!accept(")"))
+        {
+          if (!args.empty() && !accept(","))
+            return Value();
+          args.push_back(parseExpr());
+          if (!args.back().valid())
+            return Value();
+        }
+        ret = callFunction(ret, args);
+      }
+      else
+      {
+        break;
+      }
+    }
+    return ret;
+  }
+
+  //parsePrimary
+  Value parsePrimary()
+  {
+    auto token = tokens[pos++];
+
+    if (token.type == Token::Number)
+      return Value::fromNumber(token.number);
+
+    if (token.type == Token::Str)
+      return Value(Value::Str, token.s);
+
+    if (token.type == Token::Name)
+    {
+      auto it = vars.find(token.s);
+      if (it != vars.end())
+        return it->second;
+
+      if (token.s == "input")
+        return Value(Value::Input);
+
+      if (token.s == "ArrayUtils" || token.s == "DType")
+        return Value(Value::Module, token.s);
+
+      if (token.s == "voronoi" || token.s == "noBlend" || token.s == "averageBlend")
+        return Value(Value::Function, token.s);
+
+      return Value();
+    }
+
+    if (token.is(Token::Op, "("))
+    {
+      auto ret = parseExpr();
+      return accept(")") ? ret : Value();
+    }
+
+    if (token.is(Token::Op, "["))
+    {
+      Value ret(Value::List);
+      while (!accept("]"))
+      {
+        if (!ret.list.empty() && !accept(","))
+          return Value();
+        ret.list.push_back(parseExpr());
+        if (!ret.list.back().valid())
+          return Value();
+      }
+      return ret;
+    }
+
+    return Value();
+  }
+
+  //is64BitInteger (samples are evaluated as double, exact only up to 2^53)
+  static bool is64BitInteger(DType dtype) {
+    return dtype.isVectorOf(DTypes::INT64) || dtype.isVectorOf(DTypes::UINT64);
+  }
+
+  //newInput
+  Value newInput(String dataset_name, String fieldname)
+  {
+    auto dataset = DATASET->getChild(dataset_name);
+    if (!dataset)
+      return Value();
+
+    //midx of midx (input.A.B.field) goes to python
+    if (auto midx = std::dynamic_pointer_cast<IdxMultipleDataset>(dataset))
+    {
+      if (midx->getChild(fieldname))
+        return Value();
+    }
+
+    //64 bit integers go to python
+    auto field = dataset->getField(fieldname);
+    if (!field.valid() || is64BitInteger(field.dtype))
+      return Value();
+
+    auto node = std::make_shared<Node>(Node::InputKind);
+    node->dataset_name = dataset_name;
+    node->fieldname = fieldname;
+    return Value::fromNode(node);
+  }
+
+  //getAttr
+  Value getAttr(Value obj, String name)
+  {
+    if (obj.type == Value::Input)
+      return DATASET->getChild(name) ? Value(Value::InputDataset, name) : Value();
+
+    if (obj.type == Value::InputDataset)
+      return newInput(obj.s, name);
+
+    if (obj.type == Value::Module && obj.s == "DType")
+      return name == "fromString" ? Value(Value::Function, "DType.fromString") : Value();
+
+    if (obj.type == Value::Module && obj.s == "ArrayUtils")
+    {
+      static const std::set<String> supported = { "add", "sub", "mul", "div", "min", "max", "average", "standardDeviation", "median", "cast", "sqrt" };
+      return supported.count(name) ? Value(Value::Function, "ArrayUtils." + name) : Value();
+    }
+
+    return Value();
+  }
+
+  //getItem
+  Value getItem(Value obj, Value index)
+  {
+    if ((obj.type == Value::Input || obj.type == Value::InputDataset) && index.type == Value::Str)
+      return getAttr(obj, index.s);
+
+    if (obj.type == Value::Expr && index.type == Value::Number && index.number >= 0 && index.number == (int)index.number)
+    {
+      auto node = std::make_shared<Node>(Node::ComponentKind, std::vector< SharedPtr<Node> >({ obj.node }));
+      node->component = (int)index.number;
+      return Value::fromNode(node);
+    }
+
+    if (obj.type == Value::List && index.type == Value::Number && index.number >= 0 && index.number < obj.list.size() && index.number == (int)index.number)
+      return obj.list[(int)index.number];
+
+    return Value();
+  }
+
+  //newScalar
+  static Value newScalar(Node::ScalarOp op, Value a, double k)
+  {
+    auto node = std::make_shared<Node>(Node::ScalarKind, std::vector< SharedPtr<Node> >({ a.node }));
+    node->scalar_op = op;
+    node->k = k;
+    return Value::fromNode(node);
+  }
+
+  //newOperation
+  static Value newOperation(ArrayUtils::Operation op, std::vector<Value> args)
+  {
+    auto node = std::make_shared<Node>(Node::OperationKind);
+    node->op = op;
+    for (auto arg : args)
+    {
+      if (arg.type != Value::Expr)
+        return Value();
+      node->args.push_back(arg.node);
+    }
+    return node->args.empty() ? Value() : Value::fromNode(node);
+  }
+
+  //binaryOp
+  Value binaryOp(String op, Value a, Value b)
+  {
+    if (!a.valid() || !b.valid())
+      return Value();
+
+    if (a.type == Value::Number && b.type == Value::Number)
+    {
+      if (op == "+") return Value::fromNumber(a.number + b.number);
+      if (op == "-") return Value::fromNumber(a.number - b.number);
+      if (op == "*") return Value::fromNumber(a.number * b.number);
+      if (op == "/") return b.number ? Value::fromNumber(a.number / b.number) : Value();
+    }
+
+    if (a.type == Value::Expr && b.type == Value::Expr)
+    {
+      if (op == "+") return newOperation(ArrayUtils::AddOperation, { a,b });
+      if (op == "-") return newOperation(ArrayUtils::SubOperation, { a,b });
+      if (op == "*") return newOperation(ArrayUtils::MulOperation, { a,b });
+      if (op == "/") return newOperation(ArrayUtils::DivOperation, { a,b });
+    }
+
+    //same as ArrayUtils::(add|sub|mul|div)(Array,double); note that div(a,k) is mul(a,1/k)
+    if (a.type == Value::Expr && b.type == Value::Number)
+    {
+      if (op == "+") return newScalar(Node::ScalarAdd, a, b.number);
+      if (op == "-") return newScalar(Node::ScalarSub, a, b.number);
+      if (op == "*") return newScalar(Node::ScalarMul, a, b.number);
+      if (op == "/") return newScalar(Node::ScalarMul, a, 1.0 / b.number);
+    }
+
+    if (a.type == Value::Number && b.type == Value::Expr)
+    {
+      if (op == "+") return newScalar(Node::ScalarAdd, b, a.number);
+      if (op == "-") return newScalar(Node::ScalarRSub, b, a.number);
+      if (op == "*") return newScalar(Node::ScalarMul, b, a.number);
+      if (op == "/") return newScalar(Node::ScalarRDiv, b, a.number);
+    }
+
+    return Value();
+  }
+
+  //callFunction
+  Value callFunction(Value fn, std::vector<Value> args)
+  {
+    if (fn.type != Value::Function)
+      return Value();
+
+    auto name = fn.s;
+
+    if (name == "DType.fromString")
+    {
+      if (args.size() != 1 || args[0].type != Value::Str)
+        return Value();
+      Value ret(Value::DTypeValue);
+      ret.dtype = DType::fromString(args[0].s);
+      return ret.dtype.valid() ? ret : Value();
+    }
+
+    if (name == "voronoi" || name == "noBlend" || name == "averageBlend")
+    {
+      auto node = std::make_shared<Node>(Node::BlendKind);
+      node->blend_type = name == "voronoi" ? BlendBuffers::VororoiBlend : (name == "averageBlend" ? BlendBuffers::AverageBlend : BlendBuffers::NoBlend);
+      if (args.size() > 1 || (args.size() == 1 && args[0].type != Value::List))
+        return Value();
+      if (args.empty())
+      {
+        for (auto it : DATASET->down_datasets)
+        {
+          if (is64BitInteger(it.second->getField().dtype))
+            return Value();
+        }
+      }
+      for (auto arg : args.empty() ? std::vector<Value>() : args[0].list)
+      {
+        if (arg.type != Value::Expr)
+          return Value();
+        node->args.push_back(arg.node);
+      }
+      return Value::fromNode(node);
+    }
+
+    if (name == "ArrayUtils.cast")
+    {
+      if (args.size() != 2 || args[0].type != Value::Expr)
+        return Value();
+
+      auto dtype = args[1].type == Value::DTypeValue ? args[1].dtype : (args[1].type == Value::Str ? DType::fromString(args[1].s) : DType());
+      if (!dtype.valid() || is64BitInteger(dtype))
+        return Value();
+
+      auto node = std::make_shared<Node>(Node::CastKind, std::vector< SharedPtr<Node> >({ args[0].node }));
+      node->dtype = dtype;
+      return Value::fromNode(node);
+    }
+
+    if (name == "ArrayUtils.sqrt")
+    {
+      if (args.size() != 1 || args[0].type != Value::Expr)
+        return Value();
+      return Value::fromNode(std::make_shared<Node>(Node::SqrtKind, std::vector< SharedPtr<Node> >({ args[0].node })));
+    }
+
+    //overloads with (Array,double) or (double,Array)
+    if (args.size() == 2 && (args[0].type == Value::Number) != (args[1].type == Value::Number))
+    {
+      if (name == "ArrayUtils.add") return binaryOp("+", args[0], args[1]);
+      if (name == "ArrayUtils.sub") return binaryOp("-", args[0], args[1]);
+      if (name == "ArrayUtils.mul") return binaryOp("*", args[0], args[1]);
+      if (name == "ArrayUtils.div") return binaryOp("/", args[0], args[1]);
+      return Value();
+    }
+
+    static const std::map<String, ArrayUtils::Operation> operations = {
+      {"ArrayUtils.add"              , ArrayUtils::AddOperation},
+      {"ArrayUtils.sub"              , ArrayUtils::SubOperation},
+      {"ArrayUtils.mul"              , ArrayUtils::MulOperation},
+      {"ArrayUtils.div"              , ArrayUtils::DivOperation},
+      {"ArrayUtils.min"              , ArrayUtils::MinOperation},
+      {"ArrayUtils.max"              , ArrayUtils::MaxOperation},
+      {"ArrayUtils.average"          , ArrayUtils::AverageOperation},
+      {"ArrayUtils.standardDeviation", ArrayUtils::StandardDeviationOperation},
+      {"ArrayUtils.median"           , ArrayUtils::MedianOperation}
+    };
+
+    auto it = operations.find(name);
+    if (it == operations.end())
+      return Value();
+
+    //op([a,b,c...]) or op(a,b)
+    if (args.size() == 1 && args[0].type == Value::List)
+      return newOperation(it->second, args[0].list);
+
+    if (args.size() == 2)
+      return newOperation(it->second, args);
+
+    return Value();
+  }
+
+};
+
+////////////////////////////////////////////////////////////////////////////////////
+enum Atomic { Int8T, Uint8T, Int16T, Uint16T, Int32T, Uint32T, Int64T, Uint64T, Float32T, Float64T };
+
+static int GetAtomic(DType dtype)
+{
+  if (!dtype.valid())
+    return -1;
+
+  static const std::vector<DType> atomics = {
+    DTypes::INT8, DTypes::UINT8, DTypes::INT16, DTypes::UINT16, DTypes::INT32,
+    DTypes::UINT32, DTypes::INT64, DTypes::UINT64, DTypes::FLOAT32, DTypes::FLOAT64 };
+
+  for (int I = 0; I < (int)atomics.size(); I++)
+  {
+    if (dtype.isVectorOf(atomics[I]))
+      return I;
+  }
+  return -1;
+}
+
+//the C++ conversion of a double to Type (integers wrap around like the ArrayUtils casts)
+template <typename Type> inline Type ToType(double value) { return (Type)(Int64)value; }
+template <> inline Uint64  ToType<Uint64 >(double value) { return value < 0 ? (Uint64)(Int64)value : (Uint64)value; }
+template <> inline Float32 ToType<Float32>(double value) { return (Float32)value; }
+template <> inline Float64 ToType<Float64>(double value) { return value; }
+
+template <typename Type>
+static void RoundChunk(double* p, int n) {
+  for (int I = 0; I < n; I++) p[I] = (double)ToType<Type>(p[I]);
+}
+
+template <typename Type>
+static void ReadChunk(const Uint8* src, int stride, double* dst, int n) {
+  for (int I = 0; I < n; I++, src += stride) dst[I] = (double)(*(const Type*)src);
+}
+
+template <typename Type>
+static void WriteChunk(Uint8* dst, int stride, const double* src, int n) {
+  for (int I = 0; I < n; I++, dst += stride) *(Type*)dst = ToType<Type>(src[I]);
+}
+
+#define DISPATCH_ATOMIC(atomic, fn, ...) \
+  switch (atomic) { \
+    case Int8T   : fn<Int8   >(__VA_ARGS__); break; \
+    case Uint8T  : fn<Uint8  >(__VA_ARGS__); break; \
+    case Int16T  : fn<Int16  >(__VA_ARGS__); break; \
+    case Uint16T : fn<Uint16 >(__VA_ARGS__); break; \
+    case Int32T  : fn<Int32  >(__VA_ARGS__); break; \
+    case Uint32T : fn<Uint32 >(__VA_ARGS__); break; \
+    case Int64T  : fn<Int64  >(__VA_ARGS__); break; \
+    case Uint64T : fn<Uint64 >(__VA_ARGS__); break; \
+    case Float32T: fn<Float32>(__VA_ARGS__); break; \
+    case Float64T: fn<Float64>(__VA_ARGS__); break; \
+    default: VisusAssert(false); break; \
+  }
+
+////////////////////////////////////////////////////////////////////////////////////
+class Evaluator
+{
+public:
+
+  //a pointwise node bound to the actual arguments, executed chunk by chunk
+  class Instr
+  {
+  public:
+    SharedPtr<Node>  node;
+    DType            dtype;
+    int              atomic = -1;
+    int              ncomponents = 0;
+    std::vector<int> args;
+    Array            leaf;   //materialized input or blend
+    Array            source; //where to take properties from (see Array::shareProperties)
+    int              offset = 0; //in the scratch memory (in chunks)
+  };
+
+  static const int ChunkSize = 1024;
+
+  const IdxMultipleDataset* DATASET;
+  BoxQuery*                 QUERY;
+  SharedPtr<Access>         ACCESS;
+  Aborted                   aborted;
+
+  std::map<String, Array>   inputs;
+  std::map<Node*, Array>    arrays;
+
+  //constructor
+  Evaluator(const IdxMultipleDataset* DATASET_, BoxQuery* QUERY_, SharedPtr<Access> ACCESS_, Aborted aborted_)
+    : DATASET(DATASET_), QUERY(QUERY_), ACCESS(ACCESS_), aborted(aborted_) {
+  }
+
+  //getInput
+  Array getInput(String dataset_name, String fieldname)
+  {
+    auto key = dataset_name + "/" + fieldname;
+    auto it = inputs.find(key);
+    if (it != inputs.end())
+      return it->second;
+
+    Array ret;
+    if (QUERY)
+      ret = const_cast<IdxMultipleDataset*>(DATASET)->executeDownQuery(QUERY, ACCESS, dataset_name, fieldname);
+    else
+      ret = Array(PointNi(DATASET->getPointDim()), DATASET->getChild(dataset_name)->getField(fieldname).dtype); //only getting dtype
+
+    inputs[key] = ret;
+    return ret;
+  }
+
+  //evalArray
+  Array evalArray(SharedPtr<Node> node)
+  {
+    auto it = arrays.find(node.get());
+    if (it != arrays.end())
+      return it->second;
+
+    Array ret;
+    if (node->kind == Node::InputKind)
+    {
+      ret = getInput(node->dataset_name, node->fieldname);
+    }
+    else if (node->kind == Node::BlendKind)
+    {
+      BlendBuffers blend(node->blend_type, aborted);
+
+      std::vector<Array> buffers;
+      if (node->args.empty())
+      {
+        for (auto it : DATASET->down_datasets)
+          buffers.push_back(getInput(it.first, it.second->getField().name));
+      }
+      else
+      {
+        for (auto arg : node->args)
+          buffers.push_back(evalArray(arg));
+      }
+
+      for (auto buffer : buffers)
+      {
+        if (!buffer.valid() || (QUERY && QUERY->aborted()))
+          continue;
+        blend.addBlendArg(buffer);
+      }
+      ret = blend.result;
+    }
+    else
+    {
+      ret = evalPointwise(node);
+    }
+
+    arrays[node.get()] = ret;
+    return ret;
+  }
+
+private:
+
+  std::vector<Instr>  program;
+  std::map<Node*,int> slots;
+  int                 scratch_size = 0; //in chunks
+
+  //guessDType (see ArrayUtils::executeOperation)
+  static DType guessDType(const std::vector<DType>& args)
+  {
+    bool all_unsigned = true;
+    int ncomponents = args[0].ncomponents();
+    for (auto dtype : args)
+    {
+      if (!dtype.valid() || dtype.get(0).ncomponents() != 1 || dtype.ncomponents() != ncomponents)
+        return DType();
+      all_unsigned = all_unsigned && dtype.isUnsigned();
+    }
+
+    for (auto it : args) { if (it.isVectorOf(DTypes::FLOAT64)) return it; }
+    for (auto it : args) { if (it.isVectorOf(DTypes::FLOAT32)) return it; }
+    for (auto it : args) { if (it.isVectorOf(DTypes::INT64) || it.isVectorOf(DTypes::UINT64)) return DType(ncomponents, all_unsigned ? DTypes::UINT64 : DTypes::INT64); }
+    for (auto it : args) { if (it.isVectorOf(DTypes::INT32) || it.isVectorOf(DTypes::UINT32)) return DType(ncomponents, all_unsigned ? DTypes::UINT32 : DTypes::INT32); }
+    for (auto it : args) { if (it.isVectorOf(DTypes::INT16) || it.isVectorOf(DTypes::UINT16)) return DType(ncomponents, all_unsigned ? DTypes::UINT16 : DTypes::INT16); }
+    for (auto it : args) { if (it.isVectorOf(DTypes::INT8)  || it.isVectorOf(DTypes::UINT8))  return DType(ncomponents, all_unsigned ? DTypes::UINT8  : DTypes::INT8); }
+    return DType();
+  }
+
+  //addInstr
+  int addInstr(Instr instr)
+  {
+    instr.atomic = GetAtomic(instr.dtype);
+    if (instr.atomic < 0)
+      return -1;
+
+    instr.ncomponents = instr.dtype.ncomponents();
+    instr.offset = scratch_size;
+    scratch_size += instr.ncomponents * std::max(1, (int)instr.args.size() + 1);
+    program.push_back(instr);
+    return (int)program.size() - 1;
+  }
+
+  //bind (-1 means invalid array, as returned by the ArrayUtils function)
+  int bind(SharedPtr<Node> node)
+  {
+    auto it = slots.find(node.get());
+    if (it != slots.end())
+      return it->second;
+
+    Instr instr;
+    instr.node = node;
+
+    int ret = -1;
+    if (!node->isPointwise())
+    {
+      instr.leaf = evalArray(node);
+      instr.source = instr.leaf;
+      instr.dtype = instr.leaf.dtype;
+      ret = instr.leaf.valid() ? addInstr(instr) : -1;
+    }
+    else if (node->kind == Node::OperationKind)
+    {
+      //ArrayUtils::executeOperation removes null arguments
+      std::vector<DType> dtypes;
+      for (auto arg : node->args)
+      {
+        auto slot = bind(arg);
+        if (slot < 0) continue;
+        instr.args.push_back(slot);
+        dtypes.push_back(program[slot].dtype);
+      }
+
+      if (!instr.args.empty())
+      {
+        instr.dtype = guessDType(dtypes);
+        instr.source = program[instr.args[0]].source;
+        ret = addInstr(instr);
+      }
+    }
+    else
+    {
+      auto arg = bind(node->args[0]);
+      if (arg >= 0)
+      {
+        auto arg_dtype = program[arg].dtype;
+        instr.args = { arg };
+        instr.source = program[arg].source;
+
+        if (node->kind == Node::ComponentKind)
+        {
+          if (node->component < arg_dtype.ncomponents())
+          {
+            instr.dtype = arg_dtype.get(node->component);
+            ret = addInstr(instr);
+          }
+        }
+        else if (node->kind == Node::CastKind)
+        {
+          //useless cast
+          if (arg_dtype == node->dtype)
+            ret = arg;
+          else if (arg_dtype.get(0) == node->dtype.get(0) || arg_dtype.ncomponents() == node->dtype.ncomponents())
+          {
+            instr.dtype = node->dtype;
+            ret = addInstr(instr);
+          }
+        }
+        else
+        {
+          //ScalarKind or SqrtKind
+          bool bDecimal = arg_dtype.isVectorOf(DTypes::FLOAT32) || arg_dtype.isVectorOf(DTypes::FLOAT64);
+          instr.dtype = bDecimal ? arg_dtype : DType(arg_dtype.ncomponents(), DTypes::FLOAT32);
+          ret = addInstr(instr);
+        }
+      }
+    }
+
+    slots[node.get()] = ret;
+    return ret;
+  }
+
+  //roundChunk
+  static void roundChunk(int atomic, double* p, int n) {
+    DISPATCH_ATOMIC(atomic, RoundChunk, p, n);
+  }
+
+  //execChunk
+  void execChunk(std::vector<double>& scratch, Int64 from, int n)
+  {
+    auto getSlot = [&](int slot, int C) {
+      return &scratch[(size_t)(program[slot].offset + C) * ChunkSize];
+    };
+
+    for (int S = 0; S < (int)program.size(); S++)
+    {
+      auto& instr = program[S];
+      auto  node = instr.node;
+      int   nargs = (int)instr.args.size();
+
+      for (int C = 0; C < instr.ncomponents; C++)
+      {
+        double* dst = getSlot(S, C);
+
+        if (!node->isPointwise())
+        {
+          int stride = instr.leaf.dtype.getByteSize();
+          auto src = instr.leaf.c_ptr() + (instr.leaf.dtype.getBitsOffset(C) >> 3) + from * stride;
+          DISPATCH_ATOMIC(instr.atomic, ReadChunk, src, stride, dst, n);
+          continue;
+        }
+
+        if (node->kind == Node::ComponentKind)
+        {
+          memcpy(dst, getSlot(instr.args[0], node->component), sizeof(double) * n);
+          continue;
+        }
+
+        if (node->kind == Node::CastKind)
+        {
+          auto& arg = program[instr.args[0]];
+          if (C < arg.ncomponents)
+          {
+            memcpy(dst, getSlot(instr.args[0], C), sizeof(double) * n);
+            roundChunk(instr.atomic, dst, n);
+          }
+          else
+          {
+            std::fill(dst, dst + n, 0.0);
+          }
+          continue;
+        }
+
+        if (node->kind == Node::ScalarKind || node->kind == Node::SqrtKind)
+        {
+          memcpy(dst, getSlot(instr.args[0], C), sizeof(double) * n);
+          roundChunk(instr.atomic, dst, n);
+
+          double k = node->k;
+          roundChunk(instr.atomic, &k, 1);
+
+          if (node->kind == Node::SqrtKind)
+            for (int I = 0; I < n; I++) dst[I] = std::sqrt(dst[I]);
+          else switch (node->scalar_op)
+          {
+            case Node::ScalarAdd : for (int I = 0; I < n; I++) dst[I] = dst[I] + k; break;
+            case Node::ScalarSub : for (int I = 0; I < n; I++) dst[I] = dst[I] - k; break;
+            case Node::ScalarRSub: for (int I = 0; I < n; I++) dst[I] = k - dst[I]; break;
+            case Node::ScalarMul : for (int I = 0; I < n; I++) dst[I] = k * dst[I]; break;
+            case Node::ScalarRDiv: for (int I = 0; I < n; I++) dst[I] = k / dst[I]; break;
+          }
+          roundChunk(instr.atomic, dst, n);
+          continue;
+        }
+
+        //OperationKind: arguments are first casted to the output dtype
+        std::vector<double*> args(nargs);
+        for (int A = 0; A < nargs; A++)
+        {
+          args[A] = getSlot(S, instr.ncomponents + A * instr.ncomponents + C);
+          memcpy(args[A], getSlot(instr.args[A], C), sizeof(double) * n);
+          roundChunk(instr.atomic, args[A], n);
+        }
+
+        switch (node->op)
+        {
+          case ArrayUtils::AddOperation:
+          case ArrayUtils::AverageOperation:
+          {
+            std::fill(dst, dst + n, 0.0);
+            for (int A = 0; A < nargs; A++)
+              for (int I = 0; I < n; I++) dst[I] += args[A][I];
+            if (node->op == ArrayUtils::AverageOperation)
+              for (int I = 0; I < n; I++) dst[I] /= nargs;
+            break;
+          }
+          case ArrayUtils::SubOperation:
+          {
+            memcpy(dst, args[0], sizeof(double) * n);
+            for (int A = 1; A < nargs; A++)
+              for (int I = 0; I < n; I++) dst[I] -= args[A][I];
+            break;
+          }
+          case ArrayUtils::MulOperation:
+          {
+            std::fill(dst, dst + n, 1.0);
+            for (int A = 0; A < nargs; A++)
+              for (int I = 0; I < n; I++) dst[I] *= args[A][I];
+            break;
+          }
+          case ArrayUtils::DivOperation:
+          {
+            std::vector<double> den(n, 1.0);
+            for (int A = 1; A < nargs; A++)
+              for (int I = 0; I < n; I++) den[I] *= args[A][I];
+            for (int I = 0; I < n; I++) dst[I] = args[0][I] / den[I];
+            break;
+          }
+          case ArrayUtils::MinOperation:
+          case ArrayUtils::MaxOperation:
+          {
+            bool bMin = node->op == ArrayUtils::MinOperation;
+            memcpy(dst, args[0], sizeof(double) * n);
+            for (int A = 1; A < nargs; A++)
+              for (int I = 0; I < n; I++) dst[I] = bMin ? std::min(dst[I], args[A][I]) : std::max(dst[I], args[A][I]);
+            break;
+          }
+          case ArrayUtils::StandardDeviationOperation:
+          {
+            for (int I = 0; I < n; I++)
+            {
+              double avg = 0.0;
+              for (int A = 0; A < nargs; A++) avg += args[A][I];
+              avg /= nargs;
+              double sdv = 0.0;
+              for (int A = 0; A < nargs; A++) sdv += (args[A][I] - avg) * (args[A][I] - avg);
+              dst[I] = std::sqrt(sdv / nargs);
+            }
+            break;
+          }
+          case ArrayUtils::MedianOperation:
+          {
+            std::vector<double> ordered(nargs);
+            int middle = nargs / 2;
+            for (int I = 0; I < n; I++)
+            {
+              for (int A = 0; A < nargs; A++) ordered[A] = args[A][I];
+              std::sort(ordered.begin(), ordered.end());
+              //NOTE: same formula as ArrayUtils
+              dst[I] = (nargs & 1) == 0 ? ordered[middle - 1] + ordered[middle] / 2.0 : ordered[middle];
+            }
+            break;
+          }
+          default:
+            VisusAssert(false);
+            break;
+        }
+        roundChunk(instr.atomic, dst, n);
+      }
+    }
+  }
+
+  //materializeLeaves
+  void materializeLeaves(SharedPtr<Node> node)
+  {
+    if (!node->isPointwise())
+    {
+      evalArray(node);
+      return;
+    }
+
+    for (auto arg : node->args)
+      materializeLeaves(arg);
+  }
+
+  //evalPointwise
+  Array evalPointwise(SharedPtr<Node> root)
+  {
+    //inputs and blends first (a blend argument can be another pointwise expression)
+    materializeLeaves(root);
+
+    program.clear();
+    slots.clear();
+    scratch_size = 0;
+
+    auto slot = bind(root);
+    if (slot < 0)
+      return Array();
+
+    //for example output=ArrayUtils.cast(input.A.data,"uint8") when data is already uint8
+    if (!program[slot].node->isPointwise())
+      return program[slot].leaf;
+
+    //the output has the same dims of all the arguments (they all come from the same up QUERY)
+    PointNi dims = program[slot].source.dims;
+    for (auto& instr : program)
+    {
+      if (!instr.node->isPointwise() && instr.leaf.dims != dims)
+        ThrowException("IdxMultipleExpression arguments with different dims", instr.leaf.dims, dims);
+    }
+
+    auto& out = program[slot];
+
+    Array ret;
+    if (!ret.resize(dims, out.dtype, __FILE__, __LINE__))
+      return Array();
+    ret.shareProperties(out.source);
+
+    Int64 tot = ret.getTotalNumberOfSamples();
+    if (!tot)
+      return ret;
+
+    auto runRange = [&](Int64 A, Int64 B)
+    {
+      std::vector<double> scratch((size_t)scratch_size * ChunkSize);
+      int stride = ret.dtype.getByteSize();
+      for (Int64 from = A; from < B; from += ChunkSize)
+      {
+        if (aborted())
+          return;
+
+        int n = (int)std::min((Int64)ChunkSize, B - from);
+        execChunk(scratch, from, n);
+        for (int C = 0; C < out.ncomponents; C++)
+        {
+          auto dst = ret.c_ptr() + (ret.dtype.getBitsOffset(C) >> 3) + from * stride;
+          auto src = &scratch[(size_t)(out.offset + C) * ChunkSize];
+          DISPATCH_ATOMIC(out.atomic, WriteChunk, dst, stride, src, n);
+        }
+      }
+    };
+
+    //one single pass, split between the workers of the shared pool
+    auto tpool = ThreadPool::getShared();
+    int nthreads = tpool->getNumWorkers();
+    const Int64 min_range = 64 * ChunkSize;
+    if (nthreads == 1 || tot < 2 * min_range)
+    {
+      runRange(0, tot);
+    }
+    else
+    {
+      Int64 range = std::max(min_range, ((tot / (4 * nthreads)) / ChunkSize + 1) * ChunkSize);
+      ThreadPool::TaskGroup group(tpool);
+      for (Int64 A = 0; A < tot; A += range)
+      {
+        Int64 B = std::min(tot, A + range);
+        group.push([&runRange, A, B]() {
+          runRange(A, B);
+        });
+      }
+    }
+
+    return aborted() ? Array() : ret;
+  }
+
+};
+
+} //namespace IdxMultipleExpressionPrivate
+
+using namespace IdxMultipleExpressionPrivate;
+
+////////////////////////////////////////////////////////////////////////////////////
+SharedPtr<IdxMultipleExpression> IdxMultipleExpression::compile(const IdxMultipleDataset* DATASET, String code)
+{
+  auto output = Parser(DATASET).parseProgram(code);
+  return output ? std::make_shared<IdxMultipleExpression>(output) : SharedPtr<IdxMultipleExpression>();
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+Array IdxMultipleExpression::evaluate(const IdxMultipleDataset* DATASET, BoxQuery* QUERY, SharedPtr<Access> ACCESS, Aborted aborted) const
+{
+  auto ret = Evaluator(DATASET, QUERY, ACCESS, aborted).evalArray(output);
+
+  if (!ret.valid() && !aborted())
+    ThrowException("IdxMultipleExpression output not valid");
+
+  return ret;
+}
+
+} //namespace Visus
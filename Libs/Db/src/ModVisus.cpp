@@ -45,6 +45,7 @@ For support : support@visus.net
 #include <Visus/IdxDataset.h>
 #include <Visus/IdxMultipleDataset.h>
 #include <Visus/IdxFilter.h>
+#include <Visus/Utils.h>
 
 namespace Visus {
 
@@ -94,11 +95,14 @@ public:
   //findDataset
   SharedPtr<Dataset> findDataset(String name) 
   {
+    ScopedLock temp_lock(temp_dataset_lock);
+
     // first remove any temp datasets older than 5 minutes
     for (auto it = temp_dataset_map.cbegin(); it != temp_dataset_map.cend(); /* no increment */) {
       if (it->second.second.elapsedMsec() > 5*60*1000 &&
           it->first != name) {
         PrintInfo("releasing temp dataset", it->first);
+        releaseAccessPool(it->second.first);
         it = temp_dataset_map.erase(it);
       }
       else {
@@ -137,6 +141,7 @@ public:
         {
           auto d = LoadDatasetEx(stree);
           temp_dataset_map[name] = { d, Time::now() };
+          createAccessPool(d);
           return d;
         }
         catch(...) {
@@ -163,10 +168,94 @@ public:
       return datasets_xml_body;
   }
 
+  //acquireAccess (reuse a long-lived access, creating a new one only if all are busy)
+  SharedPtr<Access> acquireAccess(SharedPtr<Dataset> dataset, bool for_block_query)
+  {
+    {
+      ScopedLock lock(access_pool_lock);
+      auto it = access_pool.find(dataset.get());
+      if (it != access_pool.end() && !it->second.accesses[for_block_query].empty())
+      {
+        auto& pool = it->second.accesses[for_block_query];
+        auto ret = pool.back();
+        pool.pop_back();
+        return ret;
+      }
+    }
+
+    //for idx files keep the last open files (and their block headers) between requests
+    auto config = dataset->getDefaultAccessConfig();
+    if (std::dynamic_pointer_cast<IdxDataset>(dataset) && !std::dynamic_pointer_cast<IdxMultipleDataset>(dataset))
+    {
+      if (!config.valid())
+        config = StringTree("access");
+
+      if (!config.hasAttribute("max_open_files"))
+        config.write("max_open_files", owner->access_pool.max_open_files);
+    }
+
+    return dataset->createAccess(config, for_block_query);
+  }
+
+  //releaseAccess
+  void releaseAccess(SharedPtr<Dataset> dataset, bool for_block_query, SharedPtr<Access> access)
+  {
+    //pure remote query or in a bad state
+    if (!access || access->getMode() != 0)
+      return;
+
+    //the dataset is not public anymore (e.g. an expired temp dataset)
+    ScopedLock lock(access_pool_lock);
+    auto it = access_pool.find(dataset.get());
+    if (it == access_pool.end())
+      return;
+
+    auto& pool = it->second.accesses[for_block_query];
+    if ((int)pool.size() < owner->access_pool.max_accesses)
+      pool.push_back(access);
+  }
+
+  //___________________________________________
+  class ScopedAccess
+  {
+  public:
+
+    SharedPtr<Access> access;
+
+    //constructor
+    ScopedAccess(SharedPtr<PublicDatasets> datasets_, SharedPtr<Dataset> dataset_, bool for_block_query_)
+      : datasets(datasets_), dataset(dataset_), for_block_query(for_block_query_) {
+      this->access = datasets->acquireAccess(dataset, for_block_query);
+    }
+
+    //destructor
+    ~ScopedAccess() {
+      datasets->releaseAccess(dataset, for_block_query, access);
+    }
+
+  private:
+
+    SharedPtr<PublicDatasets> datasets;
+    SharedPtr<Dataset>        dataset;
+    bool                      for_block_query;
+  };
+
 private:
 
+  //pooled accesses are bound to a dataset instance (a temp dataset reloaded with the same name is a new instance)
+  class AccessPool
+  {
+  public:
+    SharedPtr<Dataset>               dataset; //keeps the key valid
+    std::vector< SharedPtr<Access> > accesses[2]; //indexed by for_block_query
+  };
+
+  CriticalSection                        access_pool_lock;
+  std::map<Dataset*, AccessPool>         access_pool;
+
   StringTree                              datasets;
   std::map<String, SharedPtr<Dataset > >  dataset_map;
+  CriticalSection                         temp_dataset_lock;
   std::map<String, std::pair<SharedPtr<Dataset>, Time>> temp_dataset_map;
   String                                  datasets_xml_body;
   String                                  datasets_json_body;
@@ -176,6 +265,7 @@ private:
   {
     this->dataset_map[name] = dataset;
     dataset->setServerMode(true);
+    createAccessPool(dataset);
 
     auto child= dst.addChild("dataset");
     child->write("name", name);
@@ -196,6 +286,20 @@ private:
     return ret;
   }
 
+  //createAccessPool
+  void createAccessPool(SharedPtr<Dataset> dataset)
+  {
+    ScopedLock lock(access_pool_lock);
+    access_pool[dataset.get()].dataset = dataset;
+  }
+
+  //releaseAccessPool (accesses still in use will not go back to the pool)
+  void releaseAccessPool(SharedPtr<Dataset> dataset)
+  {
+    ScopedLock lock(access_pool_lock);
+    access_pool.erase(dataset.get());
+  }
+
   //addPublicDatasets
   int addPublicDatasets(StringTree& dst, const StringTree& cursor)
   {
@@ -258,6 +362,364 @@ private:
 
 };
 
+////////////////////////////////////////////////////////////////////////////////
+class ModVisus::ResponseCache
+{
+public:
+
+  VISUS_NON_COPYABLE_CLASS(ResponseCache)
+
+  ResponseCacheConfig config;
+
+  std::atomic<Int64> nhits;
+  std::atomic<Int64> nmisses;
+  std::atomic<Int64> nspill_hits;
+  std::atomic<Int64> nspill_files;
+
+  //constructor
+  ResponseCache(ResponseCacheConfig config_) : config(config_), nhits(0), nmisses(0), nspill_hits(0), nspill_files(0) {
+    if (!config.spill_directory.empty())
+      FileUtils::createDirectory(config.spill_directory);
+  }
+
+  //destructor
+  ~ResponseCache() {
+    clear();
+  }
+
+  //getKey (all the params contribute to the response, the action has aliases)
+  static String getKey(String action, const NetRequest& request)
+  {
+    if (action == "rangequery") action = "blockquery";
+    if (action == "query"     ) action = "boxquery";
+
+    std::ostringstream out;
+    out << action;
+    for (auto it : request.url.params)
+    {
+      if (it.first != "action")
+        out << "&" << it.first << "=" << it.second;
+    }
+    return out.str();
+  }
+
+  //getGeneration
+  Int64 getGeneration() {
+    ScopedLock lock(this->lock);
+    return generation;
+  }
+
+  //find
+  bool find(String key, NetResponse& response)
+  {
+    String spill_filename, expired_filename;
+    Int64 spill_timestamp = 0;
+    {
+      ScopedLock lock(this->lock);
+      auto it = items.find(key);
+      if (it != items.end())
+      {
+        if (!isExpired(it->second->timestamp))
+        {
+          lru.splice(lru.begin(), lru, it->second);
+          response = it->second->response;
+          ++nhits;
+          return true;
+        }
+        removeItem(key);
+      }
+
+      auto jt = spilled.find(key);
+      if (jt != spilled.end())
+      {
+        if (!isExpired(jt->second->timestamp))
+        {
+          spill_filename = getSpillFilename(key);
+          spill_timestamp = jt->second->timestamp;
+        }
+        else
+        {
+          expired_filename = getSpillFilename(key);
+          removeSpilled(key);
+        }
+      }
+    }
+
+    if (!expired_filename.empty())
+      FileUtils::removeFile(expired_filename);
+
+    if (!spill_filename.empty())
+    {
+      auto generation = getGeneration();
+      if (loadSpilled(spill_filename, response))
+      {
+        ++nhits;
+        ++nspill_hits;
+        insert(generation, key, response, spill_timestamp); //back to memory
+        return true;
+      }
+    }
+
+    ++nmisses;
+    return false;
+  }
+
+  //insert (<timestamp> is when the response has been computed, 0 means now)
+  void insert(Int64 generation, String key, NetResponse response, Int64 timestamp = 0)
+  {
+    Int64 nbytes = getByteSize(response);
+    if (!response.isSuccessful() || nbytes > config.max_item_bytes || nbytes > config.max_bytes)
+      return;
+
+    //do not keep serving a transient failure (for example some blocks of a blockquery could not be read)
+    if (response.hasErrorMessage() || response.hasHeader("block-query-failed"))
+      return;
+
+    std::vector<Item> evicted;
+    {
+      ScopedLock lock(this->lock);
+
+      //a reload happened while the response was computed
+      if (generation != this->generation)
+        return;
+
+      removeItem(key);
+
+      Item item;
+      item.key = key;
+      item.response = response;
+      item.nbytes = nbytes;
+      item.timestamp = timestamp ? timestamp : Time::getTimeStamp();
+      lru.push_front(item);
+      items[key] = lru.begin();
+      this->nbytes += nbytes;
+
+      while (this->nbytes > config.max_bytes)
+      {
+        evicted.push_back(lru.back());
+        removeItem(lru.back().key);
+      }
+    }
+
+    //file io outside the lock
+    if (!config.spill_directory.empty())
+    {
+      for (auto& item : evicted)
+        spill(generation, item);
+    }
+  }
+
+  //clear
+  void clear()
+  {
+    std::vector<String> filenames;
+    {
+      ScopedLock lock(this->lock);
+      ++generation;
+      lru.clear();
+      items.clear();
+      nbytes = 0;
+
+      for (auto it : spilled_lru)
+        filenames.push_back(getSpillFilename(it.key));
+      spilled_lru.clear();
+      spilled.clear();
+      spilled_nbytes = 0;
+    }
+
+    for (auto filename : filenames)
+      FileUtils::removeFile(filename);
+  }
+
+  //writeInfo
+  void writeInfo(NetResponse& response)
+  {
+    ScopedLock lock(this->lock);
+    response.setHeader("visus-response-cache-max-bytes", cstring(config.max_bytes));
+    response.setHeader("visus-response-cache-bytes", cstring(nbytes));
+    response.setHeader("visus-response-cache-items", cstring((Int64)items.size()));
+    response.setHeader("visus-response-cache-spilled-bytes", cstring(spilled_nbytes));
+    response.setHeader("visus-response-cache-spilled-items", cstring((Int64)spilled.size()));
+    response.setHeader("visus-response-cache-hits", cstring((Int64)nhits));
+    response.setHeader("visus-response-cache-misses", cstring((Int64)nmisses));
+    response.setHeader("visus-response-cache-spill-hits", cstring((Int64)nspill_hits));
+  }
+
+private:
+
+  class Item
+  {
+  public:
+    String      key;
+    NetResponse response;
+    Int64       nbytes = 0;
+    Int64       timestamp = 0;
+  };
+
+  class SpilledItem
+  {
+  public:
+    String key;
+    Int64  nbytes = 0;
+    Int64  timestamp = 0;
+  };
+
+  typedef std::list<SpilledItem> SpilledList;
+
+  CriticalSection                                  lock;
+  Int64                                            generation = 0;
+  std::list<Item>                                  lru;
+  std::map<String, std::list<Item>::iterator >     items;
+  Int64                                            nbytes = 0;
+  SpilledList                                      spilled_lru;
+  std::map<String, SpilledList::iterator >         spilled;
+  Int64                                            spilled_nbytes = 0;
+
+  //getByteSize
+  static Int64 getByteSize(const NetResponse& response) {
+    return (response.body ? response.body->c_size() : 0) + 1024; /*rough estimation of headers*/
+  }
+
+  //getSpillFilename
+  String getSpillFilename(String key) const {
+    return config.spill_directory + "/" + StringUtils::md5(key) + ".response";
+  }
+
+  //isExpired
+  bool isExpired(Int64 timestamp) const {
+    return config.ttl > 0 && Time::getTimeStamp() - timestamp > config.ttl * (Int64)1000;
+  }
+
+  //removeSpilled (NOTE: the file is not removed)
+  void removeSpilled(String key)
+  {
+    auto it = spilled.find(key);
+    if (it == spilled.end())
+      return;
+
+    spilled_nbytes -= it->second->nbytes;
+    spilled_lru.erase(it->second);
+    spilled.erase(it);
+  }
+
+  //removeItem
+  void removeItem(String key)
+  {
+    auto it = items.find(key);
+    if (it == items.end())
+      return;
+
+    this->nbytes -= it->second->nbytes;
+    lru.erase(it->second);
+    items.erase(it);
+  }
+
+  //spill
+  void spill(Int64 generation, const Item& item)
+  {
+    auto filename = getSpillFilename(item.key);
+
+    auto headers = item.response.getHeadersAsString();
+    auto body = item.response.body;
+    auto content = std::make_shared<HeapMemory>();
+    if (!content->resize(headers.size() + (body ? body->c_size() : 0), __FILE__, __LINE__))
+      return;
+
+    memcpy(content->c_ptr(), headers.c_str(), headers.size());
+    if (body && body->c_size())
+      memcpy(content->c_ptr() + headers.size(), body->c_ptr(), body->c_size());
+
+    //write and rename, so that a concurrent find never reads a partial file
+    auto tmp_filename = concatenate(filename, ".", ++nspill_files, ".tmp");
+    try {
+      Utils::saveBinaryDocument(tmp_filename, content);
+    }
+    catch (...) {
+      FileUtils::removeFile(tmp_filename);
+      return;
+    }
+
+    //NOTE: on windows rename does not overwrite
+    if (!FileUtils::moveFile(tmp_filename, filename))
+    {
+      FileUtils::removeFile(filename);
+      if (!FileUtils::moveFile(tmp_filename, filename))
+      {
+        FileUtils::removeFile(tmp_filename);
+        return;
+      }
+    }
+
+    std::vector<String> removed;
+    {
+      ScopedLock lock(this->lock);
+
+      if (generation != this->generation)
+      {
+        removed.push_back(filename);
+      }
+      else
+      {
+        removeSpilled(item.key);
+
+        SpilledItem spilled_item;
+        spilled_item.key = item.key;
+        spilled_item.nbytes = content->c_size();
+        spilled_item.timestamp = item.timestamp;
+        spilled_lru.push_front(spilled_item);
+        spilled[item.key] = spilled_lru.begin();
+        spilled_nbytes += spilled_item.nbytes;
+
+        while (spilled_nbytes > config.max_spill_bytes && !spilled_lru.empty())
+        {
+          auto key = spilled_lru.back().key;
+          removed.push_back(getSpillFilename(key));
+          removeSpilled(key);
+        }
+      }
+    }
+
+    for (auto it : removed)
+      FileUtils::removeFile(it);
+  }
+
+  //loadSpilled
+  static bool loadSpilled(String filename, NetResponse& response)
+  {
+    auto content = Utils::loadBinaryDocument(filename);
+    if (!content)
+      return false;
+
+    String separator = "\r\n\r\n";
+    auto begin = (const char*)content->c_ptr();
+    auto end = begin + content->c_size();
+    auto pos = std::search(begin, end, separator.begin(), separator.end());
+    if (pos == end)
+      return false;
+
+    NetResponse ret;
+    if (!ret.setHeadersFromString(String(begin, pos + separator.size())))
+      return false;
+
+    auto body_offset = (pos + separator.size()) - begin;
+    auto body_size = content->c_size() - body_offset;
+    if (body_size)
+    {
+      ret.body = std::make_shared<HeapMemory>();
+      if (!ret.body->resize(body_size, __FILE__, __LINE__))
+        return false;
+      memcpy(ret.body->c_ptr(), content->c_ptr() + body_offset, body_size);
+    }
+
+    if (ret.getContentLength() != body_size)
+      return false;
+
+    response = ret;
+    return true;
+  }
+
+};
+
 ////////////////////////////////////////////////////////////////////////////////
 ModVisus::ModVisus()
 {
@@ -322,6 +784,9 @@ void ModVisus::trackConfigChangesInBackground()
         this->m_datasets = datasets;
         TIMESTAMP = timestamp;
       }
+
+      if (m_response_cache)
+        m_response_cache->clear();
     }
   }
 }
@@ -332,6 +797,24 @@ bool ModVisus::configureDatasets(const ConfigFile& config)
   this->dynamic.enabled = false;
   this->config_filename = config.getFilename();
 
+  this->access_pool.max_accesses   = config.readInt("Configuration/ModVisus/AccessPool/max_accesses", this->access_pool.max_accesses);
+  this->access_pool.max_open_files = config.readInt("Configuration/ModVisus/AccessPool/max_open_files", this->access_pool.max_open_files);
+
+  auto readByteSize = [&](String key, Int64 default_value) {
+    auto value = config.readString(key);
+    return value.empty() ? default_value : StringUtils::getByteSizeFromString(value);
+  };
+
+  this->response_cache.max_bytes       = readByteSize("Configuration/ModVisus/ResponseCache/max_bytes", this->response_cache.max_bytes);
+  this->response_cache.max_item_bytes  = readByteSize("Configuration/ModVisus/ResponseCache/max_item_bytes", this->response_cache.max_item_bytes);
+  this->response_cache.spill_directory = config.readString("Configuration/ModVisus/ResponseCache/spill_directory", this->response_cache.spill_directory);
+  this->response_cache.max_spill_bytes = readByteSize("Configuration/ModVisus/ResponseCache/max_spill_bytes", this->response_cache.max_spill_bytes);
+  this->response_cache.ttl             = config.readInt("Configuration/ModVisus/ResponseCache/ttl", this->response_cache.ttl);
+
+  this->m_response_cache.reset();
+  if (this->response_cache.max_bytes > 0)
+    this->m_response_cache = std::make_shared<ResponseCache>(this->response_cache);
+
   auto datasets = std::make_shared<PublicDatasets>(this, config);
   this->m_datasets = datasets;
 
@@ -455,6 +938,9 @@ NetResponse ModVisus::handleDynamicReload(const NetRequest& request)
     this->m_datasets = datasets;
   }
 
+  if (m_response_cache)
+    m_response_cache->clear();
+
   PrintInfo("reload done", this->config_filename, "#datasets", datasets->getNumberOfDatasets());
   return NetResponse(HttpStatus::STATUS_OK);
 }
@@ -582,6 +1068,9 @@ NetResponse ModVisus::handleBlockQuery(const NetRequest& request)
   double time = cdouble(request.url.getParam("time", cstring(dataset->getTime())));
   bool rowmajor = cbool(request.url.getParam("rowmajor", "0"));
 
+  //binary framing: each record carries its blockid, so records are appended as blocks complete
+  bool bFramed = request.url.getParam("framing") == "binary";
+
   auto bitsperblock = dataset->getDefaultBitsPerBlock();
 
   std::vector<BigInt> blocks;
@@ -607,22 +1096,40 @@ NetResponse ModVisus::handleBlockQuery(const NetRequest& request)
 
   bool bHasFilter = !field.filter.empty();
 
-  auto access = dataset->createAccessForBlockQuery();
+  PublicDatasets::ScopedAccess scoped_access(datasets, dataset, /*for_block_query*/true);
+  auto access = scoped_access.access;
 
   WaitAsync< Future<Void> > wait_async(/*max_running*/0);
   access->beginRead();
   Aborted aborted;
 
-  std::vector<NetResponse> responses;
-  for (auto blockid : blocks)
+  NetResponse RESPONSE(HttpStatus::STATUS_OK);
+  if (bFramed)
+    RESPONSE.setHeader("response-framing", "binary");
+
+  //blocks can complete in any order (callbacks run in this thread, see WaitAsync)
+  std::vector<NetResponse> responses(blocks.size());
+  int nfailed = 0;
+  for (int I = 0; I < (int)blocks.size(); I++)
   {
-    auto block_query = dataset->createBlockQuery(blockid, field, time, 'r', aborted);
+    auto block_query = dataset->createBlockQuery(blocks[I], field, time, 'r', aborted);
+    block_query->bKeepEncoded = !rowmajor; //stored bytes can be sent as they are if the compression matches
     dataset->executeBlockQuery(access, block_query);
-    wait_async.pushRunning(block_query->done,[block_query, &responses, dataset, compression, rowmajor](Void) {
+    wait_async.pushRunning(block_query->done,[I, block_query, &responses, &RESPONSE, &nfailed, bFramed, dataset, compression, rowmajor](Void) {
+
+      auto setResponse = [&](const NetResponse& response) {
+        if (!response.isSuccessful())
+          nfailed++;
+
+        if (bFramed)
+          RESPONSE.appendFrame(cstring(block_query->blockid), response);
+        else
+          responses[I] = response;
+      };
 
       if (block_query->failed())
       {
-        responses.push_back(NetResponseError(HttpStatus::STATUS_NOT_FOUND, "block_query->executeAndWait failed"));
+        setResponse(NetResponseError(HttpStatus::STATUS_NOT_FOUND, "block_query->executeAndWait failed"));
         return;
       }
 
@@ -630,22 +1137,99 @@ NetResponse ModVisus::handleBlockQuery(const NetRequest& request)
       if (rowmajor)
         dataset->convertBlockQueryToRowMajor(block_query);
 
-      //encode data
+      //encode data (unless the block was stored with the same compression)
+      auto encoded = (block_query->encoded && block_query->compression == compression) ? block_query->encoded : SharedPtr<HeapMemory>();
       NetResponse response(HttpStatus::STATUS_OK);
-      if (!response.setArrayBody(compression, block_query->buffer))
+      if (!response.setArrayBody(compression, block_query->buffer, encoded))
       {
-        responses.push_back(NetResponseError(HttpStatus::STATUS_INTERNAL_SERVER_ERROR, "Encoding converting to row major failed"));
+        setResponse(NetResponseError(HttpStatus::STATUS_INTERNAL_SERVER_ERROR, "Encoding converting to row major failed"));
         return;
       }
 
-      responses.push_back(response);
+      setResponse(response);
     });
   }
   access->endRead();
 
   wait_async.waitAllDone();
 
-  return NetResponse::compose(responses);
+  if (!bFramed)
+    RESPONSE = NetResponse::compose(responses);
+
+  //the envelope is ok even if some blocks failed (see ResponseCache::insert)
+  if (nfailed)
+    RESPONSE.setHeader("block-query-failed", cstring(nfailed));
+
+  return RESPONSE;
+}
+
+///////////////////////////////////////////////////////////////////////////
+NetResponse ModVisus::handleBlockSummary(const NetRequest& request)
+{
+  auto datasets = getDatasets();
+
+  String dataset_name = request.url.getParam("dataset");
+  auto dataset = datasets->findDataset(dataset_name);
+  if (!dataset)
+    return NetResponseError(HttpStatus::STATUS_NOT_FOUND, "Cannot find dataset(" + dataset_name + ")");
+
+  String fieldname = request.url.getParam("field");
+  double time = cdouble(request.url.getParam("time", cstring(dataset->getTime())));
+  String format = request.url.getParam("format", "xml");
+
+  Field field = fieldname.empty() ? dataset->getField() : dataset->getField(fieldname);
+  if (!field.valid())
+    return NetResponseError(HttpStatus::STATUS_NOT_FOUND, "Cannot find field(" + fieldname + ")");
+
+  PublicDatasets::ScopedAccess scoped_access(datasets, dataset, /*for_block_query*/true);
+  auto access = scoped_access.access;
+
+  StringTree ret("summary");
+  ret.write("field", field.name);
+  ret.write("time", time);
+
+  access->beginRead();
+
+  //summary of some blocks
+  if (request.url.hasParam("block"))
+  {
+    for (auto it : StringUtils::split(request.url.getParam("block")))
+    {
+      BlockSummary summary;
+      access->readBlockSummary(field, time, cbigint(it), summary);
+      auto child = ret.addChild("block");
+      child->write("id", it);
+      summary.write(*child);
+    }
+  }
+  //blocks that may contain values in range (e.g. range=100 200)
+  else if (request.url.hasParam("range"))
+  {
+    auto range = Range::fromString(request.url.getParam("range"));
+    auto C = cint(request.url.getParam("component", "0"));
+    std::vector<String> blocks;
+    for (auto blockid : dataset->findBlocksInRange(access, field, time, range, C))
+      blocks.push_back(cstring(blockid));
+    ret.write("blocks", StringUtils::join(blocks));
+  }
+  //whole field
+  else
+  {
+    auto nbins = cint(request.url.getParam("nbins", "256"));
+    dataset->computeFieldSummary(access, field, time, nbins).write(ret);
+  }
+
+  access->endRead();
+
+  NetResponse response(HttpStatus::STATUS_OK);
+  if (format == "xml")
+    response.setXmlBody(ret.toXmlString());
+  else if (format == "json")
+    response.setJSONBody(ret.toJSONString());
+  else
+    return NetResponseError(HttpStatus::STATUS_NOT_FOUND, "wrong format(" + format + ")");
+
+  return response;
 }
 
 ///////////////////////////////////////////////////////////////////////////
@@ -703,8 +1287,8 @@ NetResponse ModVisus::handleBoxQuery(const NetRequest& request)
   if (!query->isRunning())
     return NetResponseError(HttpStatus::STATUS_BAD_REQUEST, "dataset->beginBoxQuery() failed " + query->errormsg);
 
-  auto access = dataset->createAccess();
-  if (!dataset->executeBoxQuery(access, query))
+  PublicDatasets::ScopedAccess scoped_access(datasets, dataset, /*for_block_query*/false);
+  if (!dataset->executeBoxQuery(scoped_access.access, query))
     return NetResponseError(HttpStatus::STATUS_BAD_REQUEST, "dataset->executeBoxQuery() failed " + query->errormsg);
 
   buffer = query->buffer;
@@ -738,6 +1322,17 @@ NetResponse ModVisus::handleBoxQuery(const NetRequest& request)
       double palette_min = cdouble(request.url.getParam("palette_min"));
       double palette_max = cdouble(request.url.getParam("palette_max"));
 
+      //same range for all the tiles, from the block summaries (i.e. no need to read the whole field)
+      if (palette_min == palette_max && request.url.getParam("palette_range") == "field")
+      {
+        auto summary = dataset->computeFieldSummary(scoped_access.access, field, time, /*nbins*/1);
+        if (summary.valid() && summary.nsamples)
+        {
+          palette_min = summary.components[0].min;
+          palette_max = summary.components[0].max;
+        }
+      }
+
       if (palette_min != palette_max)
       {
         tf->beginTransaction();
@@ -822,13 +1417,12 @@ NetResponse ModVisus::handlePointQuery(const NetRequest& request)
   Array buffer;
 
   auto nsamples = PointNi::fromString(request.url.getParam("nsamples"));
-  VisusAssert(nsamples.getPointDim() == 3);
 
   VisusAssert(fromh == 0);
 
   auto logic_position = Position(
     Matrix::fromString(4, request.url.getParam("matrix")),
-    BoxNd::fromString(request.url.getParam("box"),/*bInterleave*/false).withPointDim(3));
+    BoxNd::fromString(request.url.getParam("box"),/*bInterleave*/false).withPointDim(std::max(3, pdim)));
 
   auto query = dataset->createPointQuery(logic_position, field, time);
   query->end_resolutions = { endh };
@@ -842,8 +1436,8 @@ NetResponse ModVisus::handlePointQuery(const NetRequest& request)
   if (!query->setPoints(nsamples))
     return NetResponseError(HttpStatus::STATUS_BAD_REQUEST, "dataset->setPoints failed " + query->errormsg);
 
-  auto access = dataset->createAccess();
-  if (!dataset->executePointQuery(access, query))
+  PublicDatasets::ScopedAccess scoped_access(datasets, dataset, /*for_block_query*/false);
+  if (!dataset->executePointQuery(scoped_access.access, query))
     return NetResponseError(HttpStatus::STATUS_BAD_REQUEST, "dataset->executeBoxQuery() failed " + query->errormsg);
 
   buffer = query->buffer;
@@ -867,6 +1461,17 @@ NetResponse ModVisus::handlePointQuery(const NetRequest& request)
       double palette_min = cdouble(request.url.getParam("palette_min"));
       double palette_max = cdouble(request.url.getParam("palette_max"));
 
+      //same range for all the tiles, from the block summaries (i.e. no need to read the whole field)
+      if (palette_min == palette_max && request.url.getParam("palette_range") == "field")
+      {
+        auto summary = dataset->computeFieldSummary(scoped_access.access, field, time, /*nbins*/1);
+        if (summary.valid() && summary.nsamples)
+        {
+          palette_min = summary.components[0].min;
+          palette_max = summary.components[0].max;
+        }
+      }
+
       if (palette_min != palette_max)
       {
         tf->setNormalizationMode(TransferFunction::UserRange);
@@ -900,7 +1505,22 @@ NetResponse ModVisus::handleRequest(NetRequest request)
 
   NetResponse response;
 
-  if (action == "rangequery" || action == "blockquery")
+  //already encoded response?
+  auto response_cache = this->m_response_cache;
+  String cache_key;
+  Int64  cache_generation = 0;
+  bool   bCacheHit = false;
+  if (response_cache && (action == "rangequery" || action == "blockquery" || action == "query" || action == "boxquery"))
+  {
+    cache_key = ResponseCache::getKey(action, request);
+    cache_generation = response_cache->getGeneration();
+    bCacheHit = response_cache->find(cache_key, response);
+  }
+
+  if (bCacheHit)
+    ;
+
+  else if (action == "rangequery" || action == "blockquery")
     response = handleBlockQuery(request);
 
   else if (action == "query" || action == "boxquery")
@@ -909,6 +1529,9 @@ NetResponse ModVisus::handleRequest(NetRequest request)
   else if (action == "pointquery")
     response = handlePointQuery(request);
 
+  else if (action == "blocksummary" || action == "block_summary")
+    response = handleBlockSummary(request);
+
   else if (action == "readdataset" || action == "read_dataset")
     response = handleReadDataset(request);
 
@@ -919,6 +1542,7 @@ NetResponse ModVisus::handleRequest(NetRequest request)
   {
     response = NetResponse(HttpStatus::STATUS_OK);
     response.setHeader("block-query-support-aggregation", "1");
+    response.setHeader("block-query-support-framing", "binary");
   }
   else if (action == "info")
   {
@@ -932,6 +1556,10 @@ NetResponse ModVisus::handleRequest(NetRequest request)
     response.setHeader("visus-binary-dir", GetBinaryDirectory());
     response.setHeader("visus-cwd", GetCurrentWorkingDirectory());
     response.setHeader("block-query-support-aggregation", "1");
+    response.setHeader("block-query-support-framing", "binary");
+
+    if (response_cache)
+      response_cache->writeInfo(response);
   }
 
   ////////////////////////// DEPRECATED, do not use. Use COnfiguration/ModVisus/Dynamic instead
@@ -948,6 +1576,9 @@ NetResponse ModVisus::handleRequest(NetRequest request)
   else
     response = NetResponseError(HttpStatus::STATUS_NOT_FOUND, "unknown action(" + action + ")");
 
+  if (!cache_key.empty() && !bCacheHit)
+    response_cache->insert(cache_generation, cache_key, response);
+
   PrintInfo(
     "request", request.url,
     "status", response.getStatusDescription(), "body", StringUtils::getStringFromByteSize(response.body ? response.body->c_size() : 0), "msec", t1.elapsedMsec());
@@ -42,6 +42,24 @@ For support : support@visus.net
 
 namespace Visus {
 
+///////////////////////////////////////////////////////////////////////////////////////
+class ModVisusAccess::FramedBatch
+{
+public:
+
+  std::vector< SharedPtr<BlockQuery> > queries;
+  std::multimap<String, int>           index; //blockid -> query
+  std::vector<bool>                    done;
+  Int64                                offset = 0;
+  bool                                 corrupted = false;
+
+  //constructor
+  FramedBatch(const std::vector< SharedPtr<BlockQuery> >& queries_) : queries(queries_), done(queries_.size(), false) {
+    for (int I = 0; I < (int)queries.size(); I++)
+      index.insert(std::make_pair(cstring(queries[I]->blockid), I));
+  }
+};
+
 
 ///////////////////////////////////////////////////////////////////////////////////////
 ModVisusAccess::ModVisusAccess(Dataset* dataset,StringTree config_)
@@ -67,6 +85,7 @@ ModVisusAccess::ModVisusAccess(Dataset* dataset,StringTree config_)
 
     auto response = NetService::getNetResponse(request);
     bool bSupportAggregation = cbool(response.getHeader("block-query-support-aggregation", "0"));
+    this->framing = bSupportAggregation && config.readBool("framing", response.getHeader("block-query-support-framing") == "binary");
     if (!bSupportAggregation)
     {
       PrintInfo("Server does not support block-query-support-aggregation, so I'm overriding num_queries_per_request to be 1");
@@ -79,23 +98,45 @@ ModVisusAccess::ModVisusAccess(Dataset* dataset,StringTree config_)
   }
 
 
+  //concurrent reads of the same block share one request
+  if (config.readBool("coalesce_reads", true))
+    this->coalesced_reads = CoalescedReads::getSingleton(cstring("ModVisusAccess", url, bitsperblock));
+
   bool disable_async = dataset->isServerMode() || config.readBool("disable_async", false);
   if (!disable_async)
   {
     int nconnections = config.readInt("nconnections", 6);
-    this->netservice = std::make_shared<NetService>(nconnections);
+    this->netservice = std::make_shared<NetService>(nconnections, config);
   }
 
 }
 
 //////////////////////////////////////////////////////////////////////////////////////
 ModVisusAccess::~ModVisusAccess() {
+  if (coalesced_reads)
+    coalesced_reads->detach(this);
 }
 
 
 
 ///////////////////////////////////////////////////////////////////////////////////////
 void ModVisusAccess::readBlock(SharedPtr<BlockQuery> query)
+{
+  //NOTE: a restarted read can happen in any thread, so it does not go in the batch
+  if (coalesced_reads)
+  {
+    coalesced_reads->readBlock(this, query,
+      [this](SharedPtr<BlockQuery> query) { addToBatch(query); },
+      [this](SharedPtr<BlockQuery> query) { sendBatch(Batch({ query })); });
+  }
+  else
+  {
+    addToBatch(query);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+void ModVisusAccess::addToBatch(SharedPtr<BlockQuery> query)
 {
   if (!batch.empty())
   {
@@ -124,7 +165,12 @@ void ModVisusAccess::flushBatch()
 
   Batch batch;
   std::swap(batch,this->batch);
+  sendBatch(batch);
+}
 
+//////////////////////////////////////////////////////////////////////////////////////
+void ModVisusAccess::sendBatch(Batch batch)
+{
   auto compression = getCompression();
 
   Url URL(this->url.withPath("/mod_visus"));
@@ -142,49 +188,120 @@ void ModVisusAccess::flushBatch()
     URL.setParam("block", StringUtils::join(v));
   }
 
+  if (framing)
+    URL.setParam("framing", "binary");
+
   auto REQUEST=NetRequest(URL);
   REQUEST.aborted=batch[0]->aborted;
 
+  if (framing)
+  {
+    //blocks are decoded as soon as their record is downloaded, without waiting for the whole batch
+    auto framed = std::make_shared<FramedBatch>(batch);
+
+    REQUEST.on_body_progress = [this, framed](const NetResponse& RESPONSE) {
+      readFrames(framed, RESPONSE);
+    };
+
+    NetService::push(netservice, REQUEST).when_ready([this, framed](NetResponse RESPONSE)
+    {
+      if (RESPONSE.isSuccessful())
+        readFrames(framed, RESPONSE);
+
+      for (int I = 0; I < (int)framed->queries.size(); I++)
+      {
+        if (!framed->done[I])
+          setBlockResponse(framed->queries[I], RESPONSE.isSuccessful() ? NetResponse(HttpStatus::STATUS_NOT_FOUND, "missing record") : RESPONSE);
+      }
+    });
+
+    return;
+  }
+
   NetService::push(netservice, REQUEST).when_ready([this,batch](NetResponse RESPONSE)
   {
     std::vector<NetResponse> responses = NetResponse::decompose(RESPONSE);
     responses.resize(batch.size(), NetResponse(HttpStatus::STATUS_CANCELLED));
 
     for (int I = 0; I < batch.size(); I++)
-    {
-      auto query    = batch[I];
-      auto response = responses[I];
+      setBlockResponse(batch[I], responses[I]);
+  });
 
-      if (!response.hasHeader("visus-dtype"))
-        response.setHeader("visus-dtype", query->field.dtype.toString());
+}
 
-      if (!response.hasHeader("visus-nsamples"))
-        response.setHeader("visus-nsamples", query->getNumberOfSamples().toString());
+//////////////////////////////////////////////////////////////////////////////////////
+void ModVisusAccess::readFrames(SharedPtr<FramedBatch> framed, const NetResponse& RESPONSE)
+{
+  if (RESPONSE.getHeader("response-framing") != "binary" || framed->corrupted)
+    return;
 
-      if (query->aborted()) {
-        readFailed(query,"aborted");
-        continue;
-      }
-      
-      if (!response.isSuccessful())
-      {
-        readFailed(query,"response not valid");
+  String id;
+  NetResponse response;
+  int ret;
+  while ((ret = RESPONSE.readFrame(framed->offset, id, response)) > 0)
+  {
+    for (auto it = framed->index.lower_bound(id); it != framed->index.upper_bound(id); ++it)
+    {
+      if (framed->done[it->second])
         continue;
-      }
 
-      auto decoded = response.getCompatibleArrayBody(query->getNumberOfSamples(), query->field.dtype);
-      if (!decoded.valid())
-      {
-        readFailed(query,"cannot decode array");
-        continue;
-      }
+      framed->done[it->second] = true;
+      setBlockResponse(framed->queries[it->second], response);
+    }
+  }
 
-      query->buffer = decoded;
+  //cannot go on with the other records
+  if (ret < 0)
+  {
+    framed->corrupted = true;
+    for (int I = 0; I < (int)framed->queries.size(); I++)
+    {
+      if (framed->done[I])
+        continue;
 
-      readOk(query);
+      framed->done[I] = true;
+      setBlockResponse(framed->queries[I], NetResponse(HttpStatus::STATUS_BAD_GATEWAY, "corrupted record"));
     }
-  });
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+void ModVisusAccess::setBlockResponse(SharedPtr<BlockQuery> query, NetResponse response)
+{
+  if (!response.hasHeader("visus-dtype"))
+    response.setHeader("visus-dtype", query->field.dtype.toString());
+
+  if (!response.hasHeader("visus-nsamples"))
+    response.setHeader("visus-nsamples", query->getNumberOfSamples().toString());
+
+  if (query->aborted()) {
+    readFailed(query,"aborted");
+    return;
+  }
+  
+  if (!response.isSuccessful())
+  {
+    readFailed(query,"response not valid");
+    return;
+  }
+
+  auto decoded = response.getCompatibleArrayBody(query->getNumberOfSamples(), query->field.dtype);
+  if (!decoded.valid())
+  {
+    readFailed(query,"cannot decode array");
+    return;
+  }
+
+  query->buffer = decoded;
+
+  //keep the bytes as they came from the server (only if they decode to exactly this block)
+  if (query->bKeepEncoded && response.hasHeader("visus-compression") && PointNi::fromString(response.getHeader("visus-nsamples")) == query->getNumberOfSamples())
+  {
+    query->encoded = response.body;
+    query->compression = response.getHeader("visus-compression");
+  }
 
+  readOk(query);
 }
 
 
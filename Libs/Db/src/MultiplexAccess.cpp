@@ -64,6 +64,10 @@ MultiplexAccess::MultiplexAccess(Dataset* dataset, StringTree config)
 
   }
 
+  //concurrent reads of the same block share one read
+  if (config.readBool("coalesce_reads", true))
+    this->coalesced_reads = CoalescedReads::getSingleton(cstring("MultiplexAccess", dataset->getUrl(), bitsperblock));
+
   //NOTE: 
   //I must use a thread because Access class are not thread-enabled
   //so I need to make sure that readBlock/writeBlock are called from the same thread 
@@ -77,6 +81,15 @@ MultiplexAccess::MultiplexAccess(Dataset* dataset, StringTree config)
 ///////////////////////////////////////////////////////
 MultiplexAccess::~MultiplexAccess()
 {
+  if (coalesced_reads)
+    coalesced_reads->detach(this);
+
+  //wait for caching writes still running (nobody is waiting for them)
+  {
+    std::unique_lock<CriticalSection> lock(this->lock);
+    writing_done.wait(lock, [this]() {return nwriting == 0; });
+  }
+
   //safe exit
   bExit = true;
   something_happened.up();
@@ -153,6 +166,7 @@ bool MultiplexAccess::passThought(int index, BigInt blockid)
 ///////////////////////////////////////////////////////
 void MultiplexAccess::scheduleOp(int mode, int index, SharedPtr<BlockQuery> up_query)
 {
+  //NOTE: for writing <up_query> is the (already completed) read query whose data needs to be cached in upper levels
   auto blockid = up_query->blockid;
   
   if (mode == 'r')
@@ -175,23 +189,39 @@ void MultiplexAccess::scheduleOp(int mode, int index, SharedPtr<BlockQuery> up_q
     while (isGoodIndex(index) && (!dw_access[index]->can_write || !passThought(index, blockid)))
       index--;
 
-    //even if the writing fails, the return code for the reading is ok
+    //nothing more to cache
     if (!isGoodIndex(index)) 
-      return readOk(up_query);
+      return;
     else
       VisusAssert(dw_access[index]->can_write && passThought(index, blockid));
   }
 
   //PrintInfo("!!!!", blockid, dw_access[index]->name);
 
-  auto dw_query = dataset->createBlockQuery(up_query->blockid, up_query->field, up_query->time, mode, up_query->aborted);
+  //caching must not be interrupted by the query that triggered it (which is already done)
+  auto dw_query = dataset->createBlockQuery(up_query->blockid, up_query->field, up_query->time, mode, mode == 'r' ? up_query->aborted : Aborted());
   VisusAssert(dw_query->getNumberOfSamples() == up_query->getNumberOfSamples());
   VisusAssert(dw_query->logic_samples == up_query->logic_samples);
   dw_query->buffer = up_query->buffer;
 
+  if (mode == 'r')
+  {
+    //keep the encoded bytes if some upper level can store them
+    dw_query->bKeepEncoded = up_query->bKeepEncoded || index > 0;
+  }
+  else
+  {
+    //pass-through encoded bytes, the Access will store them verbatim if the compression matches
+    dw_query->encoded = up_query->encoded;
+    dw_query->compression = up_query->compression;
+  }
+
   {
     ScopedLock lock(this->lock);
 
+    if (mode == 'w')
+      ++nwriting;
+
     Pending pending;
     pending.index = index;
     pending.up_query = up_query;
@@ -271,6 +301,7 @@ void MultiplexAccess::runInBackground()
           }
           //I need to write to upper access (i.e. for caching the reading)
           //NOTE: the operation is readBlock and the caching happens in the previous dw_access
+          //NOTE: the caching is not in the critical path, up_query is done as soon as the data is available
           else
           {
             VisusAssert(dw_query->ok());
@@ -279,7 +310,14 @@ void MultiplexAccess::runInBackground()
             VisusAssert(up_query->logic_samples == dw_query->logic_samples);
 
             up_query->buffer = dw_query->buffer;
-            scheduleOp('w', index - 1, up_query);
+            if (up_query->bKeepEncoded)
+            {
+              up_query->encoded = dw_query->encoded;
+              up_query->compression = dw_query->compression;
+            }
+
+            scheduleOp('w', index - 1, dw_query);
+            readOk(up_query);
           }
         });
       }
@@ -291,8 +329,12 @@ void MultiplexAccess::runInBackground()
 
         //if fails or not I don't care, I try to cache to upper levels anyway
         dataset->executeBlockQuery(dw_access[index], dw_query);
-        dw_query->done.when_ready([this, up_query, dw_query, index](Void) {
+        dw_query->done.when_ready([this, up_query, index](Void) {
           scheduleOp('w', index - 1, up_query);
+
+          ScopedLock lock(this->lock);
+          if (--nwriting == 0)
+            writing_done.notify_all();
         });
       }
     }
@@ -44,6 +44,16 @@ namespace Visus {
 ////////////////////////////////////////////////////////////////////
 bool PointQuery::setPoints(PointNi npoints)
 {
+  int pdim = dataset ? dataset->getPointDim() : npoints.getPointDim();
+
+  //allow for example 3d nsamples (see guessPointQueryNumberOfSamples) on 2d datasets
+  for (int D = pdim; D < npoints.getPointDim(); D++)
+  {
+    if (npoints[D] != 1)
+      return false;
+  }
+  npoints.setPointDim(pdim, 1);
+
   //no samples or overflow
   if (npoints.innerProduct() <= 0)
     return false;
@@ -51,34 +61,53 @@ bool PointQuery::setPoints(PointNi npoints)
   if (!this->logic_position.valid())
     return false;
 
-  if (!this->points->resize(npoints.innerProduct()*sizeof(Int64)*3, __FILE__, __LINE__))
+  if (!this->points->resize(npoints.innerProduct()*sizeof(Int64)*pdim, __FILE__, __LINE__))
     return false;
 
   //definition of a point query!
   //P'=T* (P0 + I* X/npoints[0] +  J * Y/npoints[1] + K * Z/npoints[2])
   //P'=T*P0 +(T*Stepx)*I + (T*Stepy)*J + (T*Stepz)*K
+  //T is a 3d transformation, other dimensions (if any) are sampled regularly
 
   auto T   = this->logic_position.getTransformation().withSpaceDim(4);
-  auto box = this->logic_position.getBoxNd().withPointDim(3);
+  auto box = this->logic_position.getBoxNd().withPointDim(std::max(3, pdim));
+  auto N3  = npoints; N3.setPointDim(3, 1);
 
   Point4d P0(box.p1[0], box.p1[1], box.p1[2], 1.0);
-  Point4d X(1, 0, 0, 0); X[0] = box.p2[0] - box.p1[0]; Point4d DX = X * (1.0 / (double)npoints[0]); VisusAssert(X[3] == 0.0 && DX[3] == 0.0);
-  Point4d Y(0, 1, 0, 0); Y[1] = box.p2[1] - box.p1[1]; Point4d DY = Y * (1.0 / (double)npoints[1]); VisusAssert(Y[3] == 0.0 && DY[3] == 0.0);
-  Point4d Z(0, 0, 1, 0); Z[2] = box.p2[2] - box.p1[2]; Point4d DZ = Z * (1.0 / (double)npoints[2]); VisusAssert(Z[3] == 0.0 && DZ[3] == 0.0);
+  Point4d X(1, 0, 0, 0); X[0] = box.p2[0] - box.p1[0]; Point4d DX = X * (1.0 / (double)N3[0]); VisusAssert(X[3] == 0.0 && DX[3] == 0.0);
+  Point4d Y(0, 1, 0, 0); Y[1] = box.p2[1] - box.p1[1]; Point4d DY = Y * (1.0 / (double)N3[1]); VisusAssert(Y[3] == 0.0 && DY[3] == 0.0);
+  Point4d Z(0, 0, 1, 0); Z[2] = box.p2[2] - box.p1[2]; Point4d DZ = Z * (1.0 / (double)N3[2]); VisusAssert(Z[3] == 0.0 && DZ[3] == 0.0);
 
   Point4d TP0_4d = T * P0;                                Point3d TP0 = TP0_4d.dropHomogeneousCoordinate();
   Point4d TDX_4d = T * DX; VisusAssert(TDX_4d[3] == 0.0); Point3d TDX = TDX_4d.toPoint3();
   Point4d TDY_4d = T * DY; VisusAssert(TDY_4d[3] == 0.0); Point3d TDY = TDY_4d.toPoint3();
   Point4d TDZ_4d = T * DZ; VisusAssert(TDZ_4d[3] == 0.0); Point3d TDZ = TDZ_4d.toPoint3();
 
+  int ntransformed = std::min(3, pdim);
+  Int64 nextra = 1;
+  for (int D = 3; D < pdim; D++)
+    nextra *= npoints[D];
+
   auto DST = this->points->c_ptr<Int64*>();
-  Point3d PZ = TP0; for (int K = 0; K < npoints[2]; ++K, PZ += TDZ) {
-  Point3d PY = PZ;  for (int J = 0; J < npoints[1]; ++J, PY += TDY) {
-  Point3d PX = PY;  for (int I = 0; I < npoints[0]; ++I, PX += TDX) {
-    *DST++ = (Int64)(PX[0]);
-    *DST++ = (Int64)(PX[1]);
-    *DST++ = (Int64)(PX[2]);
-  }}}
+  PointNi E(pdim), extra(pdim);
+  for (Int64 N = 0; N < nextra; N++)
+  {
+    for (int D = 3; D < pdim; D++)
+      extra[D] = (Int64)(box.p1[D] + E[D] * (box.p2[D] - box.p1[D]) / (double)npoints[D]);
+
+    Point3d PZ = TP0; for (int K = 0; K < N3[2]; ++K, PZ += TDZ) {
+    Point3d PY = PZ;  for (int J = 0; J < N3[1]; ++J, PY += TDY) {
+    Point3d PX = PY;  for (int I = 0; I < N3[0]; ++I, PX += TDX) {
+      for (int D = 0; D < ntransformed; D++) *DST++ = (Int64)(PX[D]);
+      for (int D = 3; D < pdim        ; D++) *DST++ = extra[D];
+    }}}
+
+    for (int D = 3; D < pdim; D++)
+    {
+      if (++E[D] < npoints[D]) break;
+      E[D] = 0;
+    }
+  }
 
   this->npoints = npoints;
   return true;
@@ -39,6 +39,8 @@ For support : support@visus.net
 #include <Visus/RamAccess.h>
 #include <Visus/Dataset.h>
 
+#include <unordered_map>
+
 namespace Visus {
 
 ////////////////////////////////////////////////////////////////////
@@ -51,29 +53,34 @@ public:
   {
   public:
   
-    String   fieldname;
+    int      field;  //interned field name
     double   time;
     BigInt   blockid; 
 
     //constructor
-    inline Key(String fieldname_,double time_,BigInt blockid_) : fieldname(fieldname_),time(time_), blockid(blockid_)
+    inline Key(int field_,double time_,BigInt blockid_) : field(field_),time(time_), blockid(blockid_)
     {}
 
     //operator==
     inline bool operator==(const Key& other) const 
-    {return blockid ==other.blockid && time==other.time && fieldname==other.fieldname;}
+    {return blockid ==other.blockid && time==other.time && field==other.field;}
 
-    //operator<
-    inline bool operator<(const Key& other) const 
+    //getHashCode
+    inline Uint64 getHashCode() const
     {
-      return (blockid <other.blockid)
-          || (blockid ==other.blockid && time<other.time)
-          || (blockid ==other.blockid && time==other.time && fieldname<other.fieldname);
+      Uint64 lo = (Uint64)blockid;
+      Uint64 hi = (Uint64)((blockid >> 32) >> 32);
+      Uint64 ret = lo ^ (hi * 0xC2B2AE3D27D4EB4FULL) ^ ((Uint64)std::hash<double>()(time) * 0x9E3779B97F4A7C15ULL) ^ ((Uint64)field << 48);
+      //splitmix64 finalizer, consecutive blocks must spread over shards
+      ret = (ret ^ (ret >> 30)) * 0xBF58476D1CE4E5B9ULL;
+      ret = (ret ^ (ret >> 27)) * 0x94D049BB133111EBULL;
+      return ret ^ (ret >> 31);
     }
 
-    //valid
-    inline bool valid() 
-    {return blockid >=0 && !fieldname.empty();}
+    //Hash
+    struct Hash {
+      size_t operator()(const Key& key) const { return (size_t)key.getHashCode(); }
+    };
 
   };
 
@@ -81,117 +88,279 @@ public:
   class Cached
   {
   public:
-    Field                        field;
-    double                       time=0;
-    BigInt                       blockid =0;
+    Key                          key;
+    int                          H = 0;
     Array                        buffer;
     Cached                       *prev=nullptr,*next=nullptr;
 
-    inline Key key() {
-      return Key(field.name,time, blockid);
+    //constructor
+    Cached(const Key& key_) : key(key_) {
     }
   };
 
-  CriticalSection        lock;
-  Int64                  available=0,used=0;
-  Cached                 *front=nullptr,*back=nullptr;
-  std::map<Key,Cached*>  index;
+  //________________________________________________________________
+  class Lru
+  {
+  public:
+    Cached *front=nullptr, *back=nullptr;
+  };
+
+  //________________________________________________________________
+  class Shard
+  {
+  public:
+
+    CriticalSection                                   lock;
+    Int64                                             available=0,used=0;
+    std::unordered_map<Key, Cached*, Key::Hash>       index;
+    std::vector<Lru>                                  lru; //one list for "lru", one per resolution level for "level"
+
+    //statistics (modified only with the lock)
+    Int64 nhits = 0, nmisses = 0, nwrites = 0, nevicted = 0, nrejected = 0, nlock_waits = 0;
+  };
+
+  static const int MaxFieldNames = 256;
+
+  std::vector< SharedPtr<Shard> > shards;
+  bool                            evict_by_level = false;
+  int                             admit_max_level = -1;
+
+  //interned field names, written once under intern_lock and then read without any lock
+  CriticalSection                 intern_lock;
+  String                          fieldnames[MaxFieldNames];
+  std::atomic<int>                nfieldnames;
 
   //constructor
-  Shared(Int64 available_) : available(available_) {  
+  Shared(Int64 available, int nshards, String policy, int admit_max_level_) : admit_max_level(admit_max_level_), nfieldnames(0)
+  {
+    //too small shards would reject most of the blocks
+    const Int64 MinShardSize = 8 * 1024 * 1024;
+    if (available > 0)
+      nshards = (int)std::min((Int64)nshards, std::max((Int64)1, available / MinShardSize));
+
+    nshards = std::max(1, nshards);
+
+    if (policy == "level")
+      evict_by_level = true;
+    else if (policy != "lru")
+      PrintWarning("RamAccess unknown policy", policy, "using lru");
+
+    for (int I = 0; I < nshards; I++)
+    {
+      auto shard = std::make_shared<Shard>();
+      shard->available = available > 0 ? available / nshards : 0;
+      shard->lru.resize(1);
+      shards.push_back(shard);
+    }
   }
 
   //destructor
-  ~Shared() {
-    while (!index.empty()) 
-      delete remove(back);
+  ~Shared() 
+  {
+    for (auto shard : shards)
+    {
+      for (auto it : shard->index)
+      {
+        shard->used -= it.second->buffer.c_size();
+        delete it.second;
+      }
+      VisusAssert(shard->used == 0);
+    }
+  }
+
+  //internFieldName
+  int internFieldName(const String& name)
+  {
+    int N = nfieldnames.load(std::memory_order_acquire);
+    for (int I = 0; I < N; I++)
+    {
+      if (fieldnames[I] == name)
+        return I;
+    }
+
+    ScopedLock lock(intern_lock);
+    N = nfieldnames.load(std::memory_order_relaxed);
+    for (int I = 0; I < N; I++)
+    {
+      if (fieldnames[I] == name)
+        return I;
+    }
 
-    VisusAssert(used==0);
+    if (N == MaxFieldNames)
+      return -1;
+
+    fieldnames[N] = name;
+    nfieldnames.store(N + 1, std::memory_order_release);
+    return N;
+  }
+
+  //getShard
+  Shard& getShard(const Key& key) {
+    return *shards[(key.getHashCode() >> 32) % shards.size()];
+  }
+
+  //lockShard
+  static std::unique_lock<CriticalSection> lockShard(Shard& shard)
+  {
+    std::unique_lock<CriticalSection> lock(shard.lock, std::try_to_lock);
+    if (!lock.owns_lock())
+    {
+      lock.lock();
+      shard.nlock_waits++;
+    }
+    return lock;
   }
 
   //read
   bool read(SharedPtr<BlockQuery> query) 
   {
-    ScopedLock lock(this->lock);
+    int field = internFieldName(query->field.name);
+    if (field < 0)
+      return false;
 
-    Key key(query->field.name, query->time, query->blockid);
-    auto it = index.find(key);
-    VisusAssert(it == index.end() || it->second->key() == key);
+    Key key(field, query->time, query->blockid);
+    auto& shard = getShard(key);
+    auto lock = lockShard(shard);
 
-    if (it == index.end())
+    auto it = shard.index.find(key);
+    if (it == shard.index.end())
+    {
+      shard.nmisses++;
       return false;
+    }
 
-    query->buffer = it->second->buffer.clone();
+    auto cached = it->second;
 
-    VisusAssert(query->field.name == it->second->field.name);
-    VisusAssert(query->time == it->second->time);
-    VisusAssert(query->blockid == it->second->blockid);
+    //no copy, the buffer is immutable once in the cache
+    query->buffer = cached->buffer;
 
-    if (it->second != front)
-      push_front(remove(it->second));
+    if (cached != lru(shard, cached).front)
+      push_front(shard, remove(shard, cached));
 
-    //TODO: statistics without lock?
+    shard.nhits++;
     return true;
   }
 
   //write
   bool write(SharedPtr<BlockQuery> query) 
   {
-    ScopedLock lock(this->lock);
+    int field = internFieldName(query->field.name);
+    if (field < 0)
+      return false;
 
-    Key key(query->field.name, query->time, query->blockid);
-    auto it = index.find(key);
-    VisusAssert(it == index.end() || it->second->key() == key);
+    Key key(field, query->time, query->blockid);
+    auto& shard = getShard(key);
 
-    Cached* cached = (it == index.end()) ? 0 : it->second;
-    if (!cached)
+    if (admit_max_level >= 0 && query->H > admit_max_level)
     {
-      while (available>0 && used >= available) 
-        delete remove(back);
-      cached = new Cached();
+      auto lock = lockShard(shard);
+      shard.nrejected++;
+      return false;
     }
 
-    cached->buffer = query->buffer.clone();
-    cached->field = query->field;
-    cached->time = query->time;
-    cached->blockid = query->blockid;
+    //copy outside the lock: the writer's buffer can be a view on memory it does not own (e.g. a numpy array)
+    auto buffer = query->buffer.clone();
+    auto size = buffer.c_size();
+
+    auto lock = lockShard(shard);
+    if (shard.available > 0 && size > shard.available)
+    {
+      shard.nrejected++;
+      return false;
+    }
+
+    auto it = shard.index.find(key);
+    Cached* cached = (it == shard.index.end()) ? nullptr : remove(shard, it->second);
+
+    while (shard.available>0 && shard.used + size > shard.available)
+    {
+      auto victim = getVictim(shard);
+      if (!victim)
+        break;
+      delete remove(shard, victim);
+      shard.nevicted++;
+    }
 
-    if (it == index.end())
-      push_front(cached);
+    if (!cached)
+      cached = new Cached(key);
 
-    else if (cached != front)
-      push_front(remove(cached));
+    cached->buffer = buffer;
+    cached->H = query->H;
+    push_front(shard, cached);
 
-    //TODO: statistics without lock?
+    shard.nwrites++;
     return true;
   }
 
+  //printStatistics
+  void printStatistics()
+  {
+    Int64 used = 0, available = 0, nhits = 0, nmisses = 0, nwrites = 0, nevicted = 0, nrejected = 0, nlock_waits = 0;
+    for (auto shard : shards)
+    {
+      ScopedLock lock(shard->lock);
+      used        += shard->used;
+      available   += shard->available;
+      nhits       += shard->nhits;
+      nmisses     += shard->nmisses;
+      nwrites     += shard->nwrites;
+      nevicted    += shard->nevicted;
+      nrejected   += shard->nrejected;
+      nlock_waits += shard->nlock_waits;
+    }
+
+    PrintInfo("RAM used", StringUtils::getStringFromByteSize(used));
+    PrintInfo("RAM available", StringUtils::getStringFromByteSize(available));
+    PrintInfo("RAM nshards", (int)shards.size(), "policy", evict_by_level ? "level" : "lru", "admit_max_level", admit_max_level);
+    PrintInfo("RAM nhits", nhits, "nmisses", nmisses, "hit-rate", (nhits + nmisses) ? nhits / (double)(nhits + nmisses) : 0.0);
+    PrintInfo("RAM nwrites", nwrites, "nevicted", nevicted, "nrejected", nrejected, "nlock_waits", nlock_waits);
+  }
+
 private:
 
+  //lru
+  Lru& lru(Shard& shard, Cached* cached) {
+    return shard.lru[evict_by_level ? cached->H : 0];
+  }
+
+  //getVictim
+  Cached* getVictim(Shard& shard)
+  {
+    //"level": finer levels are touched by few views, evict them first (LRU inside each level)
+    for (int I = (int)shard.lru.size() - 1; I >= 0; I--)
+    {
+      if (shard.lru[I].back)
+        return shard.lru[I].back;
+    }
+    return nullptr;
+  }
+
   //push_front
-  void push_front(Cached* cached)
+  void push_front(Shard& shard, Cached* cached)
   {
-    VisusAssert(cached->key().valid());
     VisusAssert(!cached->prev && !cached->next);
-    cached->prev=0;
-    cached->next=this->front;
-    if (cached->prev) cached->prev->next=cached; else this->front = cached;
-    if (cached->next) cached->next->prev=cached; else this->back  = cached;
-    VisusAssert((cached->prev || front==cached) && (cached->next || back==cached));
-    this->used+=cached->buffer.c_size();
-    index[cached->key()]=cached;
+    if (evict_by_level && cached->H >= (int)shard.lru.size())
+      shard.lru.resize(cached->H + 1);
+
+    auto& list = lru(shard, cached);
+    cached->prev=nullptr;
+    cached->next=list.front;
+    if (cached->next) cached->next->prev=cached; else list.back = cached;
+    list.front = cached;
+    shard.used+=cached->buffer.c_size();
+    shard.index[cached->key]=cached;
   }
 
   //remove
-  Cached* remove(Cached* cached)
+  Cached* remove(Shard& shard, Cached* cached)
   {
-    VisusAssert(cached->key().valid());
-    VisusAssert((cached->prev || front==cached) && (cached->next || back==cached));
-    if (cached->prev) cached->prev->next=cached->next; else front=cached->next;
-    if (cached->next) cached->next->prev=cached->prev; else back =cached->prev;
-    cached->prev=cached->next=0;
-    index.erase(cached->key());
-    this->used-=cached->buffer.c_size();
+    auto& list = lru(shard, cached);
+    VisusAssert((cached->prev || list.front==cached) && (cached->next || list.back==cached));
+    if (cached->prev) cached->prev->next=cached->next; else list.front=cached->next;
+    if (cached->next) cached->next->prev=cached->prev; else list.back =cached->prev;
+    cached->prev=cached->next=nullptr;
+    shard.index.erase(cached->key);
+    shard.used-=cached->buffer.c_size();
     return cached;
   }
 
@@ -204,6 +373,9 @@ RamAccess::RamAccess(int bitsperblock,StringTree config) {
   this->bitsperblock = bitsperblock;
   this->can_read = StringUtils::contains(config.readString("chmod", Access::DefaultChMod), "r");
   this->can_write = StringUtils::contains(config.readString("chmod", Access::DefaultChMod), "w");
+  this->nshards = config.readInt("nshards", this->nshards);
+  this->policy = config.readString("policy", this->policy);
+  this->admit_max_level = config.readInt("admit_max_level", this->admit_max_level);
   this->setAvailableMemory(StringUtils::getByteSizeFromString(config.readString("available", "128mb")));
 
 }
@@ -216,7 +388,7 @@ RamAccess::~RamAccess() {
 ////////////////////////////////////////////////////////////////////////////////
 void RamAccess::setAvailableMemory(Int64 value)
 {
-  this->shared = std::make_shared<Shared>(value);
+  this->shared = std::make_shared<Shared>(value, nshards, policy, admit_max_level);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -234,7 +406,7 @@ void RamAccess::readBlock(SharedPtr<BlockQuery> query)
 ////////////////////////////////////////////////////////////////////////////////
 void RamAccess::writeBlock(SharedPtr<BlockQuery> query)  
 {
-  return shared->write(query)? writeOk(query):writeFailed(query,"not found");
+  return shared->write(query)? writeOk(query):writeFailed(query,"not admitted");
 }
 
 
@@ -242,13 +414,7 @@ void RamAccess::writeBlock(SharedPtr<BlockQuery> query)
 void RamAccess::printStatistics()  {
   
   Access::printStatistics();
-
-  {
-    ScopedLock lock(shared->lock);
-    PrintInfo("RAM used", StringUtils::getStringFromByteSize(shared->used));
-    PrintInfo("RAM available", StringUtils::getStringFromByteSize(shared->available));
-  }
+  shared->printStatistics();
 }
 
 } //namespace Visus 
-
@@ -51,9 +51,16 @@ For support : support@visus.net
 #include <Visus/NetService.h>
 #include <Visus/Utils.h>
 #include <Visus/IdxDiskAccess.h>
+#include <Visus/NetSocket.h>
+#include <Visus/IdxHzOrder.h>
 #include <Visus/IdxMultipleDataset.h>
 #include <Visus/MultiplexAccess.h>
 #include <Visus/RamResource.h>
+#include <Visus/RamAccess.h>
+
+#include <set>
+#include <random>
+#include <fstream>
 
 namespace Visus {
 
@@ -94,7 +101,10 @@ public:
       << "   [--blocksperfile <int>]" << std::endl
       << "   [--filename_template <string>]" << std::endl
       << "   [--time from to template]" << std::endl
-      << "   [--arco <value>]" << std::endl;
+      << "   [--arco <value>]" << std::endl
+      << "   [--raw <filename>] raw row-major samples of the first field, streamed slab by slab" << std::endl
+      << "   [--slab <int>] number of samples along the last axis for each slab" << std::endl
+      << "   [--block-summaries] store per-block min/max/mean/histogram next to the block files" << std::endl;
     return out.str();
   }
 
@@ -105,6 +115,9 @@ public:
       ThrowException(args[0], "syntax error");
 
     String filename = args[1];
+    String raw_filename;
+    int slab_size = 0;
+    bool bBlockSummary = false;
 
     IdxFile idxfile;
     if (data.valid() && data.getTotalNumberOfSamples())
@@ -155,21 +168,76 @@ public:
       {
         idxfile.arco = cint(args[++I]);
       }
+      else if (args[I] == "--raw")
+      {
+        raw_filename = args[++I];
+      }
+      else if (args[I] == "--slab")
+      {
+        slab_size = cint(args[++I]);
+      }
+      else if (args[I] == "--block-summaries")
+      {
+        bBlockSummary = true;
+      }
       else
       {
         //just ignore
       }
     }
 
+    if (!data.valid() && raw_filename.empty())
+    {
+      idxfile.save(filename);
+      return data;
+    }
+
+    if (idxfile.fields.empty())
+      ThrowException(args[0], "missing fields");
+
+    for (auto& field : idxfile.fields)
+      field.default_compression = "zip";
 
     idxfile.save(filename);
 
-    if (data.valid())
+    auto db = LoadIdxDataset(filename);
+    auto field = db->getField();
+    auto time = db->getTime();
+    auto logic_box = db->getLogicBox();
+    int axis = logic_box.getPointDim() - 1;
+    auto slice_size = field.dtype.getByteSize(logic_box.size().innerProduct() / logic_box.size()[axis]);
+
+    //slabs along the last axis are contiguous in row-major order, so they are zero-copy views of the input...
+    std::function<Array(BoxNi)> readSlab = [&](BoxNi slab_box) {
+      auto offset = (slab_box.p1[axis] - logic_box.p1[axis]) * slice_size;
+      auto nbytes = (slab_box.p2[axis] - slab_box.p1[axis]) * slice_size;
+      return Array(slab_box.size(), field.dtype, HeapMemory::createSlice(data.heap, offset, nbytes));
+    };
+
+    //...or streamed from the raw file without materializing the whole volume
+    File file;
+    if (!raw_filename.empty())
+    {
+      if (!file.open(raw_filename, "r"))
+        ThrowException(args[0], "cannot open", raw_filename);
+
+      readSlab = [&](BoxNi slab_box) {
+        Array ret;
+        auto offset = (slab_box.p1[axis] - logic_box.p1[axis]) * slice_size;
+        if (!ret.resize(slab_box.size(), field.dtype, __FILE__, __LINE__) || !file.read(offset, ret.c_size(), ret.c_ptr()))
+          return Array();
+        return ret;
+      };
+    }
+    else if (data.dtype != field.dtype || data.dims != logic_box.size())
     {
-      auto db = LoadIdxDataset(filename);
-      db->compressDataset({ "zip" }, data);
+      ThrowException(args[0], "input data does not match the dataset");
     }
 
+    auto access = bBlockSummary ? db->createAccessForBlockQuery(StringTree("access", "block_summary", "1")) : SharedPtr<Access>();
+    if (!db->ingestDataset(field, time, readSlab, slab_size, access))
+      ThrowException(args[0], "ingest failed");
+
     return data;
   }
 
@@ -623,6 +691,521 @@ public:
   }
 };
 
+///////////////////////////////////////////////////////////
+class ArcoShardDataset : public VisusConvert::Step
+{
+public:
+
+  //getHelp
+  virtual String getHelp(std::vector<String> args) override
+  {
+    std::ostringstream out;
+    out << args[0]
+      << " <src.idx> <dst.idx>" << std::endl
+      << "   [--shard <int>] number of blocks in each container file (0 means one file for each block)" << std::endl
+      << "Example: " << args[0] << " arco/visus.idx sharded/visus.idx --shard 4096" << std::endl;
+    return out.str();
+  }
+
+  //exec
+  virtual Array exec(Array data, std::vector<String> args) override
+  {
+    if (args.size() < 3)
+      ThrowException(args[0], "syntax error");
+
+    String src_url = args[1];
+    String dst_url = args[2];
+    int shard = 4096;
+
+    for (int I = 3; I < (int)args.size(); I++)
+    {
+      if (args[I] == "--shard")
+        shard = cint(args[++I]);
+
+      else
+        ThrowException(args[0], "Invalid arguments", args[I]);
+    }
+
+    auto src = LoadDataset(src_url);
+    if (!src->idxfile.arco)
+      ThrowException(args[0], src_url, "is not an arco dataset");
+
+    if (Url(dst_url).getPath() == Url(src_url).getPath())
+      ThrowException(args[0], "source and destination must be different");
+
+    auto idxfile = src->idxfile;
+    idxfile.arco_shard = std::max(0, shard);
+    idxfile.save(dst_url);
+
+    auto dst = LoadDataset(dst_url);
+    auto src_access = src->createAccessForBlockQuery();
+    auto dst_access = dst->createAccessForBlockQuery();
+    dst_access->disableWriteLocks();
+
+    Int64 nblocks = 0, nbytes = 0;
+    auto t1 = Time::now();
+
+    src_access->beginRead();
+    dst_access->beginWrite();
+    for (auto time : src->getTimesteps().asVector())
+    {
+      for (auto field : src->getFields())
+      {
+        for (BigInt blockid = 0, total_blocks = src->getTotalNumberOfBlocks(); blockid < total_blocks; blockid++)
+        {
+          //missing blocks are not copied
+          auto read_block = src->createBlockQuery(blockid, field, time, 'r');
+          read_block->bKeepEncoded = true;
+          if (!src->executeBlockQueryAndWait(src_access, read_block))
+            continue;
+
+          //the encoded data is written as it is if the compression is the same
+          auto write_block = dst->createBlockQuery(blockid, field, time, 'w');
+          write_block->buffer = read_block->buffer;
+          write_block->encoded = read_block->encoded;
+          write_block->compression = read_block->compression;
+          if (!dst->executeBlockQueryAndWait(dst_access, write_block))
+            ThrowException(args[0], "cannot write block", blockid);
+
+          nblocks++;
+          nbytes += write_block->encoded ? write_block->encoded->c_size() : 0;
+        }
+      }
+    }
+    dst_access->endWrite();
+    src_access->endRead();
+
+    PrintInfo("arco-shard", src_url, "->", dst_url, "arco_shard", idxfile.arco_shard, "nblocks", nblocks, "size", StringUtils::getStringFromByteSize(nbytes), "msec", t1.elapsedMsec());
+    return data;
+  }
+};
+
+
+///////////////////////////////////////////////////////////
+class RecompressDataset : public VisusConvert::Step
+{
+public:
+
+  //getHelp
+  virtual String getHelp(std::vector<String> args) override
+  {
+    std::ostringstream out;
+    out << args[0]
+      << " <src.idx> [<dst.idx>]" << std::endl
+      << "   [--compression <string>] one for each level (the last one is the finest), example \"zip\" or \"zip zip jpg\" (empty means copy blocks as stored)" << std::endl
+      << "   [--nthreads <int>] threads for reading/decoding/encoding (0 means VISUS_WRITE_NTHREADS or hardware concurrency)" << std::endl
+      << "   [--no-resume] ignore the files done by a previous interrupted run" << std::endl
+      << "Without <dst.idx> the dataset is recompressed in place (default compression zip), one file at a time" << std::endl
+      << "Example: " << args[0] << " visus.idx --compression lz4 --nthreads 8" << std::endl
+      << "Example: " << args[0] << " http://host/mod_visus?dataset=foo local/visus.idx" << std::endl;
+    return out.str();
+  }
+
+  //exec
+  virtual Array exec(Array data, std::vector<String> args) override
+  {
+    if (args.size() < 2)
+      ThrowException(args[0], "syntax error");
+
+    String src_url = args[1];
+    String dst_url;
+    String compression_arg;
+    bool bCompression = false;
+    int nthreads = 0;
+    bool bResume = true;
+
+    for (int I = 2; I < (int)args.size(); I++)
+    {
+      if (args[I] == "--compression")
+      {
+        compression_arg = args[++I];
+        bCompression = true;
+      }
+
+      else if (args[I] == "--nthreads")
+        nthreads = cint(args[++I]);
+
+      else if (args[I] == "--no-resume")
+        bResume = false;
+
+      else if (I == 2 && !StringUtils::startsWith(args[I], "--"))
+        dst_url = args[I];
+
+      else
+        ThrowException(args[0], "Invalid arguments", args[I]);
+    }
+
+    auto src = LoadDataset(src_url);
+    if (!src)
+      ThrowException(args[0], "cannot load dataset", src_url);
+
+    bool bInPlace = dst_url.empty();
+    if (bInPlace && !Url(src_url).isFile())
+      ThrowException(args[0], "in place recompression needs a local dataset", src_url);
+
+    if (!bInPlace && Url(dst_url).getPath() == Url(src_url).getPath())
+      ThrowException(args[0], "source and destination must be different, omit <dst.idx> to recompress in place");
+
+    if (bInPlace && !bCompression)
+      compression_arg = "zip";
+
+    //one compression for each level, example ["zip","jpg","jpg"] means last level "jpg", last-level-minus-one "jpg" all others zip (see Dataset::compressDataset)
+    std::vector<String> compression = StringUtils::split(compression_arg);
+    int nlevels = src->getMaxResolution() + 1;
+    if ((int)compression.size() > nlevels)
+      ThrowException(args[0], "too many compressions, the dataset has", nlevels, "levels");
+
+    while (!compression.empty() && (int)compression.size() < nlevels)
+      compression.insert(compression.begin(), compression.front());
+
+    bool bUniform = !compression.empty() && std::set<String>(compression.begin(), compression.end()).size() == 1;
+
+    //arco blocks do not store their compression, the field does
+    if (src->idxfile.arco && !compression.empty() && !bUniform)
+      ThrowException(args[0], "arco datasets need the same compression for all levels");
+
+    const String suffix = ".~recompressed";
+    String src_idx_filename = Url(src_url).getPath();
+    String dst_idx_filename = bInPlace ? Path(src_idx_filename).withoutExtension() + suffix + ".idx" : dst_url;
+
+    //files already done by a previous (interrupted) run
+    String journal_filename = (bInPlace ? src_idx_filename : dst_idx_filename) + ".~journal";
+    std::set<String> done;
+    if (bResume && FileUtils::existsFile(journal_filename))
+    {
+      for (auto it : StringUtils::getLines(Utils::loadTextDocument(journal_filename)))
+      {
+        if (!StringUtils::trim(it).empty())
+          done.insert(StringUtils::trim(it));
+      }
+      PrintInfo("recompress resuming", journal_filename, "files already done", done.size());
+    }
+    else
+    {
+      FileUtils::removeFile(journal_filename);
+    }
+
+    //in place: a temporary dataset with the same layout, each file is moved over the original one as soon as it's done
+    auto idxfile = src->idxfile;
+    if (bUniform)
+    {
+      for (auto& field : idxfile.fields)
+        field.default_compression = compression[0];
+    }
+
+    if (bInPlace)
+      idxfile.filename_template = src->idxfile.filename_template + suffix;
+
+    if (bInPlace || done.empty() || !FileUtils::existsFile(dst_idx_filename))
+      idxfile.save(dst_idx_filename);
+
+    auto dst = LoadDataset(dst_idx_filename);
+    auto Waccess = dst->createAccessForBlockQuery();
+    Waccess->disableWriteLocks();
+
+    //group blocks by the file they are written to
+    class Item
+    {
+    public:
+      double time;
+      int    field;
+      BigInt blockid;
+    };
+
+    class Group
+    {
+    public:
+      String            filename;
+      String            final_filename;
+      std::vector<Item> items;
+    };
+
+    std::vector<Group> groups;
+    Int64 nitems = 0;
+    auto fields = src->getFields();
+    {
+      auto Raccess = src->createAccessForBlockQuery();
+      bool bLocal = Url(src_url).isFile();
+      std::map<String, bool> exists;
+      std::map<String, int> group_index;
+      for (auto time : src->getTimesteps().asVector())
+      {
+        for (BigInt blockid = 0, total_blocks = src->getTotalNumberOfBlocks(); blockid < total_blocks; blockid++)
+        {
+          for (int F = 0; F < (int)fields.size(); F++)
+          {
+            auto src_filename = Raccess->getFilename(fields[F], time, blockid);
+
+            //skip missing files without trying to read each of their blocks
+            if (bLocal)
+            {
+              auto it = exists.find(src_filename);
+              if (it == exists.end())
+                it = exists.insert(std::make_pair(src_filename, FileUtils::existsFile(src_filename))).first;
+
+              if (!it->second)
+                continue;
+            }
+
+            auto filename = Waccess->getFilename(fields[F], time, blockid);
+            auto final_filename = bInPlace ? src_filename : filename;
+            if (done.count(final_filename))
+              continue;
+
+            auto it = group_index.find(filename);
+            if (it == group_index.end())
+            {
+              it = group_index.insert(std::make_pair(filename, (int)groups.size())).first;
+              groups.push_back(Group());
+              groups.back().filename = filename;
+              groups.back().final_filename = final_filename;
+            }
+
+            Item item;
+            item.time = time;
+            item.field = F;
+            item.blockid = blockid;
+            groups[it->second].items.push_back(item);
+            nitems++;
+          }
+        }
+      }
+    }
+
+    PrintInfo("recompress", src_url, "->", bInPlace ? src_url : dst_url, "compression", compression.empty() ? "<as stored>" : compression_arg, 
+      "nfiles", groups.size(), "nblocks", nitems);
+
+    if (nthreads <= 0)
+    {
+      nthreads = std::max(1, (int)std::thread::hardware_concurrency());
+      if (auto env = getenv("VISUS_WRITE_NTHREADS"))
+        nthreads = cint(env);
+    }
+
+    //read, decode and encode are done in parallel; writes stay in this thread since accesses are not thread safe
+    auto tpool = nthreads > 1 ? std::make_shared<ThreadPool>("Recompress Worker", nthreads) : SharedPtr<ThreadPool>();
+
+    //each worker reads with its own access (i.e. its own file handles or network connections)
+    CriticalSection readers_lock;
+    std::vector< SharedPtr<Access> > readers;
+    for (int I = 0; I < std::max(1, nthreads); I++)
+    {
+      auto access = src->createAccessForBlockQuery();
+      access->disableAsync();
+      readers.push_back(access);
+    }
+
+    class Block
+    {
+    public:
+      int                   group = 0;
+      bool                  last = false; //last block of its group
+      SharedPtr<BlockQuery> read_block;
+      SharedPtr<BlockQuery> write_block;
+    };
+
+    class Pending
+    {
+    public:
+      std::vector<Block> blocks;
+      Future<Void>       encoded;
+    };
+
+    //blocks are read in chunks, so an access can sort/merge the reads (and a network access sends one request for them)
+    const int chunk_size = 16;
+
+    //limit the number of blocks in memory
+    const int max_pending = 4 * std::max(1, nthreads);
+    std::deque<Pending> pending;
+    Pending chunk;
+
+    std::ofstream journal(journal_filename.c_str(), std::ios::app);
+
+    String failed;
+    Int64 nblocks = 0, nwrite_bytes = 0, nfiles = 0;
+    auto t1 = Time::now();
+    auto t_progress = Time::now();
+
+    //the file is complete: close it, move it over the original (in place) and remember it for resuming
+    auto finishGroup = [&](const Group& group) {
+      Waccess->endWrite();
+
+      if (bInPlace && FileUtils::existsFile(group.filename))
+      {
+        FileUtils::removeFile(group.final_filename);
+        if (!FileUtils::moveFile(group.filename, group.final_filename))
+        {
+          failed = concatenate("cannot move ", group.filename, " to ", group.final_filename);
+          return;
+        }
+      }
+
+      journal << group.final_filename << std::endl;
+      nfiles++;
+
+      if (t_progress.elapsedSec() > 5)
+      {
+        PrintInfo("recompress progress files", nfiles, "/", groups.size(), "blocks", nblocks, "msec", t1.elapsedMsec());
+        t_progress = Time::now();
+      }
+
+      Waccess->beginWrite();
+    };
+
+    auto writePending = [&]() {
+      auto item = pending.front();
+      pending.pop_front();
+      item.encoded.get();
+
+      for (auto& block : item.blocks)
+      {
+        if (!failed.empty())
+          return;
+
+        //missing blocks are not written
+        if (block.read_block->ok())
+        {
+          auto write_block = block.write_block;
+          if (!dst->executeBlockQueryAndWait(Waccess, write_block))
+          {
+            failed = concatenate("cannot write block ", write_block->blockid, " to ", groups[block.group].filename);
+            return;
+          }
+
+          nblocks++;
+          nwrite_bytes += write_block->encoded ? write_block->encoded->c_size() : 0;
+        }
+
+        if (block.last)
+          finishGroup(groups[block.group]);
+      }
+    };
+
+    auto submitChunk = [&]() {
+      Promise<Void> encoded;
+      chunk.encoded = encoded.get_future();
+      pending.push_back(chunk);
+
+      auto blocks = chunk.blocks;
+      ThreadPool::push(tpool, [&, blocks, encoded]() mutable
+      {
+        SharedPtr<Access> reader;
+        {
+          ScopedLock lock(readers_lock);
+          reader = readers.back();
+          readers.pop_back();
+        }
+
+        std::vector< SharedPtr<BlockQuery> > reads;
+        for (auto& block : blocks)
+          reads.push_back(block.read_block);
+
+        reader->beginRead();
+        src->executeBlockQueries(reader, reads);
+        reader->endRead();
+
+        {
+          ScopedLock lock(readers_lock);
+          readers.push_back(reader);
+        }
+
+        for (auto& block : blocks)
+        {
+          //could fail because the block does not exist
+          auto read_block = block.read_block;
+          read_block->done.get();
+          if (!read_block->ok())
+            continue;
+
+          auto write_block = block.write_block;
+          write_block->buffer = read_block->buffer; //NOTE: the layout will remain the same
+
+          //the encoded data is written as it is
+          if (compression.empty())
+          {
+            write_block->encoded = read_block->encoded;
+            write_block->compression = read_block->compression;
+          }
+          else
+          {
+            Waccess->encodeBlock(write_block);
+          }
+        }
+
+        encoded.set_value(Void());
+      });
+
+      chunk = Pending();
+      while ((int)pending.size() >= max_pending)
+        writePending();
+    };
+
+    Waccess->beginWrite();
+    for (int G = 0; G < (int)groups.size() && failed.empty(); G++)
+    {
+      const auto& group = groups[G];
+
+      //leftover of an interrupted run
+      FileUtils::removeFile(group.filename);
+
+      for (int I = 0; I < (int)group.items.size() && failed.empty(); I++)
+      {
+        auto item = group.items[I];
+        auto Rfield = fields[item.field];
+
+        Block block;
+        block.group = G;
+        block.last = I == (int)group.items.size() - 1;
+        block.read_block = src->createBlockQuery(item.blockid, Rfield, item.time, 'r');
+        block.read_block->bKeepEncoded = compression.empty();
+
+        //compression can depend on level
+        auto Wfield = Rfield;
+        if (!compression.empty())
+          Wfield.default_compression = compression[block.read_block->H];
+        block.write_block = dst->createBlockQuery(item.blockid, Wfield, item.time, 'w');
+
+        chunk.blocks.push_back(block);
+        if ((int)chunk.blocks.size() == chunk_size)
+          submitChunk();
+      }
+    }
+
+    if (!chunk.blocks.empty() && failed.empty())
+      submitChunk();
+
+    while (!pending.empty())
+      writePending();
+
+    Waccess->endWrite();
+    journal.close();
+
+    if (!failed.empty())
+      ThrowException(args[0], failed, "(run again to resume)");
+
+    //the idx file is updated only at the end, since arco blocks depend on field compression
+    if (bInPlace)
+    {
+      //arco blocks of the temporary dataset are in a directory named after it
+      FileUtils::removeFile(dst_idx_filename);
+      if (FileUtils::existsDirectory(Path(dst_idx_filename).withoutExtension()))
+        FileUtils::removeDirectory(Path(dst_idx_filename).withoutExtension());
+
+      if (bUniform)
+      {
+        auto src_idxfile = src->idxfile;
+        for (auto& field : src_idxfile.fields)
+          field.default_compression = compression[0];
+        src_idxfile.save(src_idx_filename);
+      }
+    }
+    FileUtils::removeFile(journal_filename);
+
+    PrintInfo("recompress done", "nfiles", nfiles, "nblocks", nblocks, "size", StringUtils::getStringFromByteSize(nwrite_bytes), "nthreads", nthreads, "msec", t1.elapsedMsec());
+    return data;
+  }
+};
+
 
 ///////////////////////////////////////////////////////////
 class TestIdxMemory : public VisusConvert::Step
@@ -699,6 +1282,1388 @@ public:
   }
 };
 
+
+///////////////////////////////////////////////////////////
+class TestIdxReadSpeed : public VisusConvert::Step
+{
+public:
+
+  //getHelp
+  virtual String getHelp(std::vector<String> args) override
+  {
+    std::ostringstream out;
+    out << args[0]
+      << " <filename.idx>" << std::endl
+      << "   [--field <string>]" << std::endl
+      << "   [--box <BoxNi>]" << std::endl
+      << "   [--resolution <int>]" << std::endl
+      << "   [--nthreads <string>] example \"1 2 4 8\"" << std::endl
+      << "   [--coalesce-gap <string>] example \"-1 0 65536\" (-1 means one read for each block)" << std::endl;
+    return out.str();
+  }
+
+  //exec
+  virtual Array exec(Array data, std::vector<String> args) override
+  {
+    if (args.size() < 2)
+      ThrowException(args[0], "syntax error");
+
+    String url = args[1];
+    auto db = LoadDataset(url);
+    VisusReleaseAssert(db);
+
+    auto field = db->getField();
+    auto logic_box = db->getLogicBox();
+    auto resolution = db->getMaxResolution();
+    std::vector<int> nthreads = { 1, 2, 4, 8 };
+    std::vector<String> coalesce_gaps = { "" };
+
+    for (int I = 2; I < (int)args.size(); I++)
+    {
+      if (args[I] == "--field")
+        field = db->getField(args[++I]);
+
+      else if (args[I] == "--box")
+        logic_box = BoxNi::parseFromOldFormatString(db->getPointDim(), args[++I]);
+
+      else if (args[I] == "--resolution")
+        resolution = cint(args[++I]);
+
+      else if (args[I] == "--nthreads")
+      {
+        nthreads.clear();
+        for (auto it : StringUtils::split(args[++I]))
+          nthreads.push_back(cint(it));
+      }
+
+      else if (args[I] == "--coalesce-gap")
+        coalesce_gaps = StringUtils::split(args[++I]);
+
+      else
+        ThrowException(args[0], "Invalid arguments", args[I]);
+    }
+
+    double base_msec = 0;
+    Array base_buffer;
+    for (auto gap : coalesce_gaps)
+    {
+      for (auto N : nthreads)
+      {
+        //NOTE: for a fair comparison the OS file cache should be dropped before each run
+        auto config = StringTree("access", "nthreads", cstring(N));
+        if (!gap.empty())
+          config.write("read_coalesce_gap", gap);
+
+        auto access = db->createAccess(config);
+        auto query = db->createBoxQuery(logic_box, field, db->getTime(), 'r');
+        query->end_resolutions = { resolution };
+
+        auto t1 = Time::now();
+        db->beginBoxQuery(query);
+        if (!db->executeBoxQuery(access, query))
+          ThrowException(args[0], "query failed", query->errormsg);
+
+        auto msec = (double)t1.elapsedMsec();
+        if (!base_msec) base_msec = msec;
+        PrintInfo("coalesce_gap", gap.empty() ? "default" : gap, "nthreads", N, "query_size", StringUtils::getStringFromByteSize(query->getByteSize()), "msec", msec, "speedup", msec ? base_msec / msec : 1.0);
+
+        if (!base_buffer.valid())
+          base_buffer = query->buffer;
+        else if (query->buffer.c_size() != base_buffer.c_size() || memcmp(query->buffer.c_ptr(), base_buffer.c_ptr(), base_buffer.c_size()) != 0)
+          ThrowException(args[0], "coalesce_gap", gap, "nthreads", N, "gives a different result");
+      }
+    }
+
+    return data;
+  }
+};
+
+///////////////////////////////////////////////////////////
+class TestIdxMergeSpeed : public VisusConvert::Step
+{
+public:
+
+  //getHelp
+  virtual String getHelp(std::vector<String> args) override
+  {
+    std::ostringstream out;
+    out << args[0]
+      << " <filename.idx>" << std::endl
+      << "   [--field <string>]" << std::endl
+      << "   [--box <BoxNi>]" << std::endl
+      << "   [--resolution <int>]" << std::endl
+      << "   [--nrepeat <int>]" << std::endl
+      << "   [--nthreads <string>] merge threads inside executeBoxQuery, example \"1 2 4 8\"" << std::endl;
+    return out.str();
+  }
+
+  //exec
+  virtual Array exec(Array data, std::vector<String> args) override
+  {
+    if (args.size() < 2)
+      ThrowException(args[0], "syntax error");
+
+    String url = args[1];
+    auto db = LoadIdxDataset(url);
+    if (!db)
+      ThrowException(args[0], "cannot load idx dataset", url);
+
+    auto field = db->getField();
+    auto logic_box = db->getLogicBox();
+    auto resolution = db->getMaxResolution();
+    int nrepeat = 5;
+    std::vector<int> nthreads = { 1, 2, 4, 8 };
+
+    for (int I = 2; I < (int)args.size(); I++)
+    {
+      if (args[I] == "--field")
+        field = db->getField(args[++I]);
+
+      else if (args[I] == "--box")
+        logic_box = BoxNi::parseFromOldFormatString(db->getPointDim(), args[++I]);
+
+      else if (args[I] == "--resolution")
+        resolution = cint(args[++I]);
+
+      else if (args[I] == "--nrepeat")
+        nrepeat = cint(args[++I]);
+
+      else if (args[I] == "--nthreads")
+      {
+        nthreads.clear();
+        for (auto it : StringUtils::split(args[++I]))
+          nthreads.push_back(cint(it));
+      }
+
+      else
+        ThrowException(args[0], "Invalid arguments", args[I]);
+    }
+
+    auto createQuery = [&]() {
+      auto query = db->createBoxQuery(logic_box, field, db->getTime(), 'r');
+      query->end_resolutions = { resolution };
+      db->beginBoxQuery(query);
+      if (!query->isRunning())
+        ThrowException(args[0], "cannot begin query", query->errormsg);
+      return query;
+    };
+
+    //read all blocks once, so that only the merge is measured
+    std::vector< SharedPtr<BlockQuery> > blocks;
+    {
+      auto query = createQuery();
+      auto access = db->createAccess();
+      access->beginRead();
+      for (auto blockid : db->createBlockQueriesForBoxQuery(query))
+      {
+        auto block_query = db->createBlockQuery(blockid, field, query->time, 'r');
+        if (db->executeBlockQueryAndWait(access, block_query))
+          blocks.push_back(block_query);
+      }
+      access->endIO();
+    }
+
+    Array expected;
+    double base_msec = 0;
+    for (auto fast : { false, true })
+    {
+      db->fast_hzorder_merge = fast;
+
+      double msec = 0;
+      Array buffer;
+      for (int R = 0; R < nrepeat; R++)
+      {
+        auto query = createQuery();
+        query->allocateBufferIfNeeded();
+        auto t1 = Time::now();
+        for (auto block_query : blocks)
+        {
+          if (!db->mergeBoxQueryWithBlockQuery(query, block_query))
+            ThrowException(args[0], "merge failed");
+        }
+        msec += (double)t1.elapsedMsec();
+        buffer = query->buffer;
+      }
+      msec /= nrepeat;
+
+      if (!fast)
+      {
+        expected = buffer;
+        base_msec = msec;
+      }
+      else if (buffer.c_size() != expected.c_size() || memcmp(buffer.c_ptr(), expected.c_ptr(), (size_t)buffer.c_size()) != 0)
+      {
+        ThrowException(args[0], "fast merge gives a different result");
+      }
+
+      PrintInfo(fast ? "fast-merge" : "kd-merge", "pdim", db->getPointDim(), "nblocks", (Int64)blocks.size(), "query_size", StringUtils::getStringFromByteSize(buffer.c_size()),
+        "msec", msec, "MB/sec", msec ? (buffer.c_size() / (1024.0 * 1024.0)) / (msec / 1000.0) : 0.0, "speedup", msec ? base_msec / msec : 1.0);
+    }
+
+    db->fast_hzorder_merge = true;
+
+    //same blocks served from memory, so that executeBoxQuery time is mostly merging
+    auto ram_access = std::make_shared<RamAccess>(db->getDefaultBitsPerBlock());
+    ram_access->setAvailableMemory(0);
+    ram_access->disableWriteLocks();
+    ram_access->beginWrite();
+    for (auto block_query : blocks)
+    {
+      auto write_block = db->createBlockQuery(block_query->blockid, field, block_query->time, 'w');
+      write_block->buffer = block_query->buffer;
+      if (!db->executeBlockQueryAndWait(ram_access, write_block))
+        ThrowException(args[0], "cannot write block to ram");
+    }
+    ram_access->endWrite();
+
+    base_msec = 0;
+    for (auto N : nthreads)
+    {
+      db->merge_nthreads = N;
+
+      double msec = 0;
+      Array buffer;
+      for (int R = 0; R < nrepeat; R++)
+      {
+        auto query = createQuery();
+        auto t1 = Time::now();
+        if (!db->executeBoxQuery(ram_access, query))
+          ThrowException(args[0], "query failed", query->errormsg);
+        msec += (double)t1.elapsedMsec();
+        buffer = query->buffer;
+      }
+      msec /= nrepeat;
+      if (!base_msec) base_msec = msec;
+
+      if (buffer.c_size() != expected.c_size() || memcmp(buffer.c_ptr(), expected.c_ptr(), (size_t)buffer.c_size()) != 0)
+        ThrowException(args[0], "merge with nthreads", N, "gives a different result");
+
+      PrintInfo("box-query-merge", "nthreads", N, "nblocks", (Int64)blocks.size(), "msec", msec, "speedup", msec ? base_msec / msec : 1.0);
+    }
+
+    db->merge_nthreads = 0;
+    return data;
+  }
+};
+
+///////////////////////////////////////////////////////////
+class TestIdxWriteSpeed : public VisusConvert::Step
+{
+public:
+
+  //getHelp
+  virtual String getHelp(std::vector<String> args) override
+  {
+    std::ostringstream out;
+    out << args[0]
+      << " <filename.idx>" << std::endl
+      << "   [--dims <PointNi>] example \"512 512 512\"" << std::endl
+      << "   [--dtype <dtype>]" << std::endl
+      << "   [--compression <string>]" << std::endl
+      << "   [--blocksperfile <int>]" << std::endl
+      << "   [--nthreads <string>] example \"1 2 4 8\"" << std::endl;
+    return out.str();
+  }
+
+  //exec
+  virtual Array exec(Array data, std::vector<String> args) override
+  {
+    if (args.size() < 2)
+      ThrowException(args[0], "syntax error");
+
+    String filename = args[1];
+    PointNi dims(512, 512, 512);
+    DType dtype = DTypes::UINT8;
+    String compression = "zip";
+    int blocksperfile = -1;
+    std::vector<int> nthreads = { 1, 2, 4, 8 };
+
+    for (int I = 2; I < (int)args.size(); I++)
+    {
+      if (args[I] == "--dims")
+        dims = PointNi::fromString(args[++I]);
+
+      else if (args[I] == "--dtype")
+        dtype = DType::fromString(args[++I]);
+
+      else if (args[I] == "--compression")
+        compression = args[++I];
+
+      else if (args[I] == "--blocksperfile")
+        blocksperfile = cint(args[++I]);
+
+      else if (args[I] == "--nthreads")
+      {
+        nthreads.clear();
+        for (auto it : StringUtils::split(args[++I]))
+          nthreads.push_back(cint(it));
+      }
+
+      else
+        ThrowException(args[0], "Invalid arguments", args[I]);
+    }
+
+    //synthetic volume, not constant so that the compression has some work to do
+    Array src(dims, dtype);
+    if (!src.valid())
+      ThrowException(args[0], "cannot allocate source volume");
+
+    auto ptr = src.c_ptr();
+    for (Int64 I = 0, Tot = src.c_size(); I < Tot; I++)
+      ptr[I] = (Uint8)((I ^ (I >> 9)) % 251);
+
+    auto base = StringUtils::endsWith(filename, ".idx") ? filename.substr(0, filename.size() - 4) : filename;
+
+    double base_msec = 0;
+    for (auto N : nthreads)
+    {
+      IdxFile idxfile;
+      idxfile.logic_box = BoxNi(PointNi(dims.getPointDim()), dims);
+      Field field("data", dtype);
+      field.default_compression = compression;
+      idxfile.fields.push_back(field);
+      if (blocksperfile > 0)
+        idxfile.blocksperfile = blocksperfile;
+
+      //each run writes to its own files
+      auto run_filename = concatenate(base, "_nthreads", N, ".idx");
+      idxfile.save(run_filename);
+
+      auto db = LoadDataset(run_filename);
+      db->write_nthreads = N;
+
+      auto access = db->createAccess();
+      auto query = db->createBoxQuery(db->getLogicBox(), 'w');
+      query->buffer = src;
+
+      auto t1 = Time::now();
+      db->beginBoxQuery(query);
+      if (!db->executeBoxQuery(access, query))
+        ThrowException(args[0], "query failed", query->errormsg);
+
+      auto msec = (double)t1.elapsedMsec();
+      if (!base_msec) base_msec = msec;
+      PrintInfo("nthreads", N, "filename", run_filename, "size", StringUtils::getStringFromByteSize(src.c_size()), "msec", msec, 
+        "MB/sec", msec ? (src.c_size() / (1024.0 * 1024.0)) / (msec / 1000.0) : 0.0, "speedup", msec ? base_msec / msec : 1.0);
+    }
+
+    return data;
+  }
+};
+
+///////////////////////////////////////////////////////////
+class TestIdxIngestSpeed : public VisusConvert::Step
+{
+public:
+
+  //getHelp
+  virtual String getHelp(std::vector<String> args) override
+  {
+    std::ostringstream out;
+    out << args[0]
+      << " <filename.idx>" << std::endl
+      << "   [--dims <PointNi>] example \"1024 1024 1024\"" << std::endl
+      << "   [--dtype <dtype>]" << std::endl
+      << "   [--compression <string>]" << std::endl
+      << "   [--blocksperfile <int>]" << std::endl
+      << "   [--slab <int>]" << std::endl
+      << "   [--nthreads <int>]" << std::endl;
+    return out.str();
+  }
+
+  //exec
+  virtual Array exec(Array data, std::vector<String> args) override
+  {
+    if (args.size() < 2)
+      ThrowException(args[0], "syntax error");
+
+    String filename = args[1];
+    PointNi dims(1024, 1024, 1024);
+    DType dtype = DTypes::UINT8;
+    String compression = "zip";
+    int blocksperfile = -1;
+    int slab_size = 0;
+    int nthreads = 0;
+
+    for (int I = 2; I < (int)args.size(); I++)
+    {
+      if (args[I] == "--dims")
+        dims = PointNi::fromString(args[++I]);
+
+      else if (args[I] == "--dtype")
+        dtype = DType::fromString(args[++I]);
+
+      else if (args[I] == "--compression")
+        compression = args[++I];
+
+      else if (args[I] == "--blocksperfile")
+        blocksperfile = cint(args[++I]);
+
+      else if (args[I] == "--slab")
+        slab_size = cint(args[++I]);
+
+      else if (args[I] == "--nthreads")
+        nthreads = cint(args[++I]);
+
+      else
+        ThrowException(args[0], "Invalid arguments", args[I]);
+    }
+
+    IdxFile idxfile;
+    idxfile.logic_box = BoxNi(PointNi(dims.getPointDim()), dims);
+    Field field("data", dtype);
+    field.default_compression = compression;
+    idxfile.fields.push_back(field);
+    if (blocksperfile > 0)
+      idxfile.blocksperfile = blocksperfile;
+    idxfile.save(filename);
+
+    auto db = LoadDataset(filename);
+    db->write_nthreads = nthreads;
+
+    int axis = dims.getPointDim() - 1;
+    auto slice_size = dtype.getByteSize(dims.innerProduct() / dims[axis]);
+
+    //synthetic volume generated slab by slab (never materialized), not constant so that the compression has some work to do
+    auto generate = [&](BoxNi slab_box) {
+      Array ret;
+      if (!ret.resize(slab_box.size(), dtype, __FILE__, __LINE__))
+        return Array();
+      auto ptr = ret.c_ptr();
+      for (Int64 I = 0, Offset = slab_box.p1[axis] * slice_size, Tot = ret.c_size(); I < Tot; I++)
+        ptr[I] = (Uint8)(((Offset + I) ^ ((Offset + I) >> 9)) % 251);
+      return ret;
+    };
+
+    auto ram = RamResource::getSingleton();
+    ram->setPeakMemory(ram->getVisusUsedMemory());
+
+    auto t1 = Time::now();
+    if (!db->ingestDataset(db->getField(), db->getTime(), generate, slab_size))
+      ThrowException(args[0], "ingest failed");
+    auto sec = t1.elapsedSec();
+
+    auto tot = dtype.getByteSize(dims.innerProduct());
+    PrintInfo("filename", filename, "size", StringUtils::getStringFromByteSize(tot), "sec", sec,
+      "MB/sec", sec ? (tot / (1024.0 * 1024.0)) / sec : 0.0,
+      "peak-memory", StringUtils::getStringFromByteSize(ram->getPeakMemory()));
+
+    //check a slice in the middle
+    auto slice_box = db->getLogicBox();
+    slice_box.p1[axis] = dims[axis] / 2;
+    slice_box.p2[axis] = slice_box.p1[axis] + 1;
+
+    auto query = db->createBoxQuery(slice_box, 'r');
+    db->beginBoxQuery(query);
+    if (!db->executeBoxQuery(db->createAccess(), query))
+      ThrowException(args[0], "cannot read back", query->errormsg);
+
+    auto expected = generate(slice_box);
+    if (query->buffer.c_size() != expected.c_size() || memcmp(query->buffer.c_ptr(), expected.c_ptr(), expected.c_size()) != 0)
+      ThrowException(args[0], "read back does not match");
+
+    PrintInfo("read back ok");
+    return data;
+  }
+};
+
+///////////////////////////////////////////////////////////
+class TestBlockSummary : public VisusConvert::Step
+{
+public:
+
+  //getHelp
+  virtual String getHelp(std::vector<String> args) override
+  {
+    std::ostringstream out;
+    out << args[0]
+      << " <filename.idx>" << std::endl
+      << "   [--dims <PointNi>] example \"300 200 100\"" << std::endl
+      << "   [--range <from> <to>]" << std::endl;
+    return out.str();
+  }
+
+  //exec
+  virtual Array exec(Array data, std::vector<String> args) override
+  {
+    if (args.size() < 2)
+      ThrowException(args[0], "syntax error");
+
+    String filename = args[1];
+    PointNi dims(300, 200, 100); //not a power of two, samples outside the logic box must not be part of the summaries
+    Range range(500, 510, 0);
+
+    for (int I = 2; I < (int)args.size(); I++)
+    {
+      if (args[I] == "--dims")
+        dims = PointNi::fromString(args[++I]);
+
+      else if (args[I] == "--range")
+      {
+        range.from = cdouble(args[++I]);
+        range.to   = cdouble(args[++I]);
+      }
+
+      else
+        ThrowException(args[0], "Invalid arguments", args[I]);
+    }
+
+    IdxFile idxfile;
+    idxfile.logic_box = BoxNi(PointNi(dims.getPointDim()), dims);
+    Field field("data", DTypes::FLOAT32);
+    field.default_compression = "zip";
+    idxfile.fields.push_back(field);
+    idxfile.save(filename);
+
+    auto db = LoadDataset(filename);
+    field = db->getField();
+    int pdim = dims.getPointDim();
+    int axis = pdim - 1;
+
+    //1 + x + 2*y + 3*z... (never zero, so that padding would show up in the minimum)
+    auto generate = [&](BoxNi slab_box) {
+      Array ret;
+      if (!ret.resize(slab_box.size(), field.dtype, __FILE__, __LINE__))
+        return Array();
+      auto ptr = (Float32*)ret.c_ptr();
+      for (auto P = ForEachPoint(slab_box.size()); !P.end(); P.next())
+      {
+        double value = 1;
+        for (int D = 0; D < pdim; D++)
+          value += (D + 1) * (double)(slab_box.p1[D] + P.pos[D]);
+        *ptr++ = (Float32)value;
+      }
+      return ret;
+    };
+
+    if (!db->ingestDataset(field, db->getTime(), generate, 0, db->createAccessForBlockQuery(StringTree("access", "block_summary", "1"))))
+      ThrowException(args[0], "ingest failed");
+
+    auto access = db->createAccessForBlockQuery();
+
+    //metadata only
+    auto t1 = Time::now();
+    auto summary = db->computeFieldSummary(access, field, db->getTime());
+    auto blocks = db->findBlocksInRange(access, field, db->getTime(), range);
+    auto summary_msec = t1.elapsedMsec();
+
+    if (!summary.valid())
+      ThrowException(args[0], "block summaries not available");
+
+    //read and decode all the samples
+    t1 = Time::now();
+    auto query = db->createBoxQuery(db->getLogicBox(), 'r');
+    db->beginBoxQuery(query);
+    if (!db->executeBoxQuery(db->createAccess(), query))
+      ThrowException(args[0], "cannot read", query->errormsg);
+
+    auto ptr = (const Float32*)query->buffer.c_ptr();
+    Int64 tot = query->buffer.getTotalNumberOfSamples();
+    double m = ptr[0], M = ptr[0], sum = 0;
+    for (Int64 I = 0; I < tot; I++)
+    {
+      m = std::min(m, (double)ptr[I]);
+      M = std::max(M, (double)ptr[I]);
+      sum += ptr[I];
+    }
+    auto read_msec = t1.elapsedMsec();
+
+    const auto& component = summary.components[0];
+    PrintInfo("summary", "nsamples", summary.nsamples, "min", component.min, "max", component.max, "mean", component.mean, "msec", summary_msec);
+    PrintInfo("read   ", "nsamples", tot, "min", m, "max", M, "mean", sum / tot, "msec", read_msec);
+
+    if (summary.nsamples != tot || component.min != m || component.max != M || std::fabs(component.mean - sum / tot) > 1e-6 * std::fabs(sum / tot))
+      ThrowException(args[0], "summary does not match the data");
+
+    //blocks not in the candidates must not contain values in range
+    std::set<BigInt> candidates(blocks.begin(), blocks.end());
+    Int64 ncontaining = 0;
+    access->beginRead();
+    for (BigInt blockid = 0, nblocks = db->getTotalNumberOfBlocks(); blockid < nblocks; blockid++)
+    {
+      auto block_query = db->createBlockQuery(blockid, field, db->getTime(), 'r');
+      if (!db->executeBlockQueryAndWait(access, block_query))
+        continue;
+
+      auto samples = (const Float32*)block_query->buffer.c_ptr();
+      bool bContains = false;
+      for (Int64 I = 0, N = block_query->buffer.getTotalNumberOfSamples(); I < N && !bContains; I++)
+        bContains = samples[I] >= range.from && samples[I] <= range.to;
+
+      ncontaining += bContains ? 1 : 0;
+      if (bContains && !candidates.count(blockid))
+        ThrowException(args[0], "block", blockid, "contains values in range but it has been skipped");
+    }
+    access->endRead();
+
+    PrintInfo("range", range.from, range.to, "nblocks", db->getTotalNumberOfBlocks(), "candidates", blocks.size(), "containing", ncontaining);
+    return data;
+  }
+};
+
+///////////////////////////////////////////////////////////
+class TestFilterQuerySpeed : public VisusConvert::Step
+{
+public:
+
+  //getHelp
+  virtual String getHelp(std::vector<String> args) override
+  {
+    std::ostringstream out;
+    out << args[0]
+      << " <filename.idx>" << std::endl
+      << "   [--field <string>]" << std::endl
+      << "   [--filter <string>] override the filter of the field, example \"dehaar\"" << std::endl
+      << "   [--box <BoxNi>]" << std::endl
+      << "   [--resolutions <string>] progressive end resolutions, example \"8 12 16\"" << std::endl
+      << "   [--nrepeat <int>]" << std::endl;
+    return out.str();
+  }
+
+  //exec
+  virtual Array exec(Array data, std::vector<String> args) override
+  {
+    if (args.size() < 2)
+      ThrowException(args[0], "syntax error");
+
+    String url = args[1];
+    auto db = LoadIdxDataset(url);
+    if (!db)
+      ThrowException(args[0], "cannot load idx dataset", url);
+
+    auto field = db->getField();
+    auto logic_box = db->getLogicBox();
+    std::vector<int> resolutions = { db->getMaxResolution() };
+    int nrepeat = 3;
+
+    for (int I = 2; I < (int)args.size(); I++)
+    {
+      if (args[I] == "--field")
+        field = db->getField(args[++I]);
+
+      else if (args[I] == "--filter")
+        field.filter = args[++I];
+
+      else if (args[I] == "--box")
+        logic_box = BoxNi::parseFromOldFormatString(db->getPointDim(), args[++I]);
+
+      else if (args[I] == "--resolutions")
+      {
+        resolutions.clear();
+        for (auto it : StringUtils::split(args[++I]))
+          resolutions.push_back(cint(it));
+      }
+
+      else if (args[I] == "--nrepeat")
+        nrepeat = cint(args[++I]);
+
+      else
+        ThrowException(args[0], "Invalid arguments", args[I]);
+    }
+
+    if (!db->createFilter(field))
+      ThrowException(args[0], "field", field.name, "has no filter, use --filter");
+
+    Array expected;
+    double base_msec = 0;
+    for (auto incremental : { false, true })
+    {
+      db->incremental_filter_query = incremental;
+
+      double msec = 0;
+      Int64 nread = 0;
+      Array buffer;
+      for (int R = 0; R < nrepeat; R++)
+      {
+        auto access = db->createAccess();
+        auto query = db->createBoxQuery(logic_box, field, db->getTime(), 'r');
+        query->end_resolutions = resolutions;
+        query->enableFilters();
+
+        auto t1 = Time::now();
+        db->beginBoxQuery(query);
+        if (!query->isRunning())
+          ThrowException(args[0], "cannot begin query", query->errormsg);
+
+        for (; query->isRunning(); db->nextBoxQuery(query))
+        {
+          if (!db->executeBoxQuery(access, query))
+            ThrowException(args[0], "cannot execute query", query->errormsg);
+        }
+        msec += (double)t1.elapsedMsec();
+        nread = (Int64)access->statistics.rok;
+        buffer = query->buffer;
+      }
+      msec /= nrepeat;
+
+      if (!incremental)
+      {
+        expected = buffer;
+        base_msec = msec;
+      }
+      else if (buffer.dims != expected.dims || buffer.c_size() != expected.c_size() || memcmp(buffer.c_ptr(), expected.c_ptr(), (size_t)buffer.c_size()) != 0)
+      {
+        ThrowException(args[0], "incremental filter query gives a different result");
+      }
+
+      PrintInfo(incremental ? "incremental" : "level-by-level", "filter", field.filter, "dims", buffer.dims, "nread", nread, 
+        "msec", msec, "speedup", msec ? base_msec / msec : 1.0);
+    }
+
+    db->incremental_filter_query = true;
+    return data;
+  }
+};
+
+///////////////////////////////////////////////////////////
+class TestBoxQueryReuse : public VisusConvert::Step
+{
+public:
+
+  //getHelp
+  virtual String getHelp(std::vector<String> args) override
+  {
+    std::ostringstream out;
+    out << args[0]
+      << " <filename.idx>" << std::endl
+      << "   [--field <string>]" << std::endl
+      << "   [--screen <int>] number of samples along each axis of the viewport" << std::endl
+      << "   [--npan <int>] number of pan steps between zooms" << std::endl;
+    return out.str();
+  }
+
+  //exec
+  virtual Array exec(Array data, std::vector<String> args) override
+  {
+    if (args.size() < 2)
+      ThrowException(args[0], "syntax error");
+
+    auto db = LoadDataset(args[1]);
+    VisusReleaseAssert(db);
+
+    auto field = db->getField();
+    int screen = 512;
+    int npan = 10;
+
+    for (int I = 2; I < (int)args.size(); I++)
+    {
+      if (args[I] == "--field")
+        field = db->getField(args[++I]);
+
+      else if (args[I] == "--screen")
+        screen = cint(args[++I]);
+
+      else if (args[I] == "--npan")
+        npan = cint(args[++I]);
+
+      else
+        ThrowException(args[0], "Invalid arguments", args[I]);
+    }
+
+    int pdim = db->getPointDim();
+    auto minh = db->getDefaultBitsPerBlock();
+    auto maxh = db->getMaxResolution();
+    auto progression = (pdim == 2) ? (pdim * 3) : (pdim * 4);
+    Int64 max_samples = (Int64)std::pow((double)screen, pdim);
+
+    //scripted trace: pan along the first axis, zoom in, pan along the second axis, zoom out
+    std::vector<BoxNi> trace;
+    {
+      auto logic_box = db->getLogicBox();
+      auto box = logic_box;
+      for (int D = 0; D < pdim; D++)
+      {
+        auto size = logic_box.size()[D] / 4;
+        box.p1[D] = logic_box.p1[D] + size;
+        box.p2[D] = box.p1[D] + size;
+      }
+
+      auto pan = [&](int D) {
+        for (int I = 0; I < npan; I++)
+        {
+          auto delta = std::max((Int64)1, box.size()[D] / 20);
+          box.p1[D] += delta;
+          box.p2[D] += delta;
+          trace.push_back(box.getIntersection(logic_box));
+        }
+      };
+
+      auto zoom = [&](double factor) {
+        for (int D = 0; D < pdim; D++)
+        {
+          auto center = (box.p1[D] + box.p2[D]) / 2;
+          auto half = std::max((Int64)1, (Int64)(box.size()[D] * factor / 2));
+          box.p1[D] = center - half;
+          box.p2[D] = center + half;
+        }
+        trace.push_back(box.getIntersection(logic_box));
+      };
+
+      trace.push_back(box);
+      pan(0);
+      zoom(0.5);
+      pan(pdim > 1 ? 1 : 0);
+      zoom(2.0);
+    }
+
+    std::vector<Array> results;
+    for (auto bReuse : { false, true })
+    {
+      auto access = db->createAccess();
+      Array last_buffer;
+      LogicSamples last_samples;
+      std::vector<BoxNi> last_failed_boxes;
+      Int64 nskipped = 0;
+
+      auto t1 = Time::now();
+      for (int I = 0; I < (int)trace.size(); I++)
+      {
+        //same end resolution guess as QueryNode, i.e. about <screen> samples along each axis
+        auto endh = maxh;
+        for (; endh > minh; endh--)
+        {
+          auto query = db->createBoxQuery(trace[I], field, db->getTime(), 'r');
+          query->end_resolutions = { endh };
+          db->beginBoxQuery(query);
+          if (query->isRunning() && query->getNumberOfSamples().innerProduct() <= max_samples)
+            break;
+        }
+
+        auto query = db->createBoxQuery(trace[I], field, db->getTime(), 'r');
+        query->end_resolutions.push_back(Utils::clamp(endh - progression, minh, maxh));
+        while (query->end_resolutions.back() < endh)
+          query->end_resolutions.push_back(Utils::clamp(query->end_resolutions.back() + pdim, minh, endh));
+
+        if (bReuse)
+        {
+          query->reuse.buffer = last_buffer;
+          query->reuse.logic_samples = last_samples;
+          query->reuse.failed_boxes = last_failed_boxes;
+        }
+
+        db->beginBoxQuery(query);
+        while (query->isRunning())
+        {
+          if (!db->executeBoxQuery(access, query))
+            ThrowException(args[0], "query failed", query->errormsg);
+
+          last_buffer = query->buffer;
+          last_samples = query->logic_samples;
+          last_failed_boxes = query->failed_boxes;
+          db->nextBoxQuery(query);
+        }
+
+        nskipped += query->reuse.nskipped;
+
+        if (!bReuse)
+        {
+          results.push_back(last_buffer);
+        }
+        else if (last_buffer.dims != results[I].dims || memcmp(last_buffer.c_ptr(), results[I].c_ptr(), last_buffer.c_size()) != 0)
+        {
+          ThrowException(args[0], "viewport", I, "reusing samples gives a different result");
+        }
+      }
+
+      PrintInfo("reuse", bReuse, "nviewports", trace.size(), "msec", t1.elapsedMsec(),
+        "blocks-read", (Int64)access->statistics.rok + (Int64)access->statistics.rfail, "blocks-skipped", nskipped);
+    }
+
+    return data;
+  }
+};
+
+///////////////////////////////////////////////////////////
+class TestHzAddressSpeed : public VisusConvert::Step
+{
+public:
+
+  //getHelp
+  virtual String getHelp(std::vector<String> args) override
+  {
+    std::ostringstream out;
+    out << args[0]
+      << "   [--bitmask <string>] (default is a round robin bitmask for --pdim --maxh)" << std::endl
+      << "   [--pdim <int>]" << std::endl
+      << "   [--maxh <int>]" << std::endl
+      << "   [--npoints <int>]" << std::endl;
+    return out.str();
+  }
+
+  //exec
+  virtual Array exec(Array data, std::vector<String> args) override
+  {
+    String pattern;
+    int pdim = 3;
+    int maxh = 30;
+    Int64 npoints = 4 * 1024 * 1024;
+
+    for (int I = 1; I < (int)args.size(); I++)
+    {
+      if (args[I] == "--bitmask")
+        pattern = args[++I];
+
+      else if (args[I] == "--pdim")
+        pdim = cint(args[++I]);
+
+      else if (args[I] == "--maxh")
+        maxh = cint(args[++I]);
+
+      else if (args[I] == "--npoints")
+        npoints = cint64(args[++I]);
+
+      else
+        ThrowException(args[0], "Invalid arguments", args[I]);
+    }
+
+    if (pattern.empty())
+    {
+      pattern = "V";
+      for (int H = 0; H < maxh; H++)
+        pattern += cstring(H % pdim);
+    }
+
+    auto bitmask = DatasetBitmask::fromString(pattern);
+    if (!bitmask.valid() || bitmask.getMaxResolution() > HzOrder::getMaxSupportedResolution())
+      ThrowException(args[0], "invalid bitmask", pattern);
+
+    pdim = bitmask.getPointDim();
+    auto dims = bitmask.getPow2Dims();
+
+    std::vector<Int64> points(npoints * pdim);
+    std::mt19937_64 rnd(0);
+    for (Int64 N = 0; N < npoints; N++)
+    {
+      for (int D = 0; D < pdim; D++)
+        points[N * pdim + D] = (Int64)(rnd() % (Uint64)dims[D]);
+    }
+
+    HzOrder hzorder(bitmask);
+    FastHzOrder fast_hzorder(bitmask);
+    std::vector<BigInt> expected(npoints), hz(npoints);
+    std::vector<Int64> check(npoints * pdim);
+
+    auto run = [&](String name, std::function<void()> fn, double base_msec) {
+      auto t1 = Time::now();
+      fn();
+      double msec = (double)t1.elapsedMsec();
+      PrintInfo(name, "msec", msec, "Mpoints/sec", msec ? (npoints / 1000.0) / msec : 0.0, "speedup", msec && base_msec ? base_msec / msec : 1.0);
+      return msec;
+    };
+
+    PrintInfo("hz-address-speed", "bitmask", pattern, "npoints", npoints, "bmi2", FastHzOrder::isBMI2Supported());
+
+    //existing bit-by-bit loop
+    double base_msec = run("HzOrder::getAddress", [&]() {
+      PointNi p(pdim);
+      for (Int64 N = 0; N < npoints; N++)
+      {
+        for (int D = 0; D < pdim; D++)
+          p[D] = points[N * pdim + D];
+        expected[N] = hzorder.getAddress(p);
+      }
+    }, 0.0);
+
+    std::vector<bool> modes = { false };
+    if (FastHzOrder::isBMI2Supported())
+      modes.push_back(true);
+
+    for (auto bmi2 : modes)
+    {
+      fast_hzorder.use_bmi2 = bmi2;
+      String engine = bmi2 ? "(bmi2)" : "(table)";
+
+      run("FastHzOrder::getAddress" + engine, [&]() {
+        for (Int64 N = 0; N < npoints; N++)
+          hz[N] = fast_hzorder.getAddress(&points[N * pdim]);
+      }, base_msec);
+
+      if (hz != expected)
+        ThrowException(args[0], "wrong result for FastHzOrder::getAddress" + engine);
+
+      std::fill(hz.begin(), hz.end(), 0);
+      run("FastHzOrder::getAddress" + engine + "[batch]", [&]() {
+        fast_hzorder.getAddress(&points[0], npoints, &hz[0]);
+      }, base_msec);
+
+      if (hz != expected)
+        ThrowException(args[0], "wrong result for batch FastHzOrder::getAddress" + engine);
+    }
+
+    //inverse
+    base_msec = run("HzOrder::getPoint", [&]() {
+      for (Int64 N = 0; N < npoints; N++)
+      {
+        auto p = hzorder.getPoint(expected[N]);
+        for (int D = 0; D < pdim; D++)
+          check[N * pdim + D] = p[D];
+      }
+    }, 0.0);
+
+    for (auto bmi2 : modes)
+    {
+      fast_hzorder.use_bmi2 = bmi2;
+      String engine = bmi2 ? "(bmi2)" : "(table)";
+
+      std::fill(check.begin(), check.end(), 0);
+      run("FastHzOrder::getPoint" + engine + "[batch]", [&]() {
+        fast_hzorder.getPoint(&expected[0], npoints, &check[0]);
+      }, base_msec);
+
+      if (check != points)
+        ThrowException(args[0], "wrong result for batch FastHzOrder::getPoint" + engine);
+    }
+
+    return data;
+  }
+};
+
+///////////////////////////////////////////////////////////
+class TestNetServerSpeed : public VisusConvert::Step
+{
+public:
+
+  //getHelp
+  virtual String getHelp(std::vector<String> args) override
+  {
+    std::ostringstream out;
+    out << args[0]
+      << "   [--port <int>]" << std::endl
+      << "   [--nthreads <int>]" << std::endl
+      << "   [--nconnections <int>]" << std::endl
+      << "   [--nrequests <int>] (per connection)" << std::endl
+      << "   [--body-size <int>]" << std::endl;
+    return out.str();
+  }
+
+  //a module returning a fixed-size body
+  class EchoModule : public NetServerModule
+  {
+  public:
+
+    String body;
+
+    //constructor
+    EchoModule(int body_size) : body(body_size, 'x') {
+    }
+
+    //handleRequest
+    virtual NetResponse handleRequest(NetRequest request) override {
+      NetResponse response(HttpStatus::STATUS_OK);
+      response.setTextBody(body, /*bAsBinary*/true);
+      return response;
+    }
+  };
+
+  //exec
+  virtual Array exec(Array data, std::vector<String> args) override
+  {
+    int port = 10987;
+    int nthreads = 8;
+    int nconnections = 64;
+    int nrequests = 100;
+    int body_size = 1024;
+
+    for (int I = 1; I < (int)args.size(); I++)
+    {
+      if (args[I] == "--port")
+        port = cint(args[++I]);
+
+      else if (args[I] == "--nthreads")
+        nthreads = cint(args[++I]);
+
+      else if (args[I] == "--nconnections")
+        nconnections = cint(args[++I]);
+
+      else if (args[I] == "--nrequests")
+        nrequests = cint(args[++I]);
+
+      else if (args[I] == "--body-size")
+        body_size = cint(args[++I]);
+
+      else
+        ThrowException(args[0], "Invalid arguments", args[I]);
+    }
+
+    String url = concatenate("http://127.0.0.1:", port);
+
+    for (auto keep_alive : { false, true })
+    {
+      auto server = std::make_shared<NetServer>(port, new EchoModule(body_size), nthreads);
+      server->setKeepAlive(keep_alive);
+      server->runInBackground();
+      Thread::sleep(200);
+
+      std::atomic<int> nok(0), nfailed(0);
+      auto t1 = Time::now();
+
+      std::vector< SharedPtr<std::thread> > clients;
+      for (int C = 0; C < nconnections; C++)
+      {
+        clients.push_back(Thread::start("Load generator", [&]()
+        {
+          SharedPtr<NetSocket> socket;
+          for (int R = 0; R < nrequests; R++)
+          {
+            if (!socket)
+            {
+              socket = std::make_shared<NetSocket>();
+              if (!socket->connect(url)) {
+                nfailed++; socket.reset(); continue;
+              }
+            }
+
+            NetRequest request(url + "/");
+            request.setHeader("Connection", keep_alive ? "keep-alive" : "close");
+            NetResponse response;
+            if (socket->sendRequest(request))
+              response = socket->receiveResponse();
+
+            if (response.isSuccessful() && response.body && (int)response.body->c_size() == body_size)
+              nok++;
+            else
+              nfailed++;
+
+            if (!keep_alive || !response.isSuccessful())
+              socket.reset();
+          }
+        }));
+      }
+
+      for (auto it : clients)
+        Thread::join(it);
+
+      auto sec = t1.elapsedSec();
+      PrintInfo("keep_alive", keep_alive, "nthreads", nthreads, "nconnections", nconnections, "nok", (int)nok, "nfailed", (int)nfailed, "sec", sec, "req/sec", sec ? nok / sec : 0.0);
+
+      server->signalExit();
+      server->waitForExit();
+    }
+
+    return data;
+  }
+};
+
+///////////////////////////////////////////////////////////
+class TestNetServiceSpeed : public VisusConvert::Step
+{
+public:
+
+  //getHelp
+  virtual String getHelp(std::vector<String> args) override
+  {
+    std::ostringstream out;
+    out << args[0]
+      << "   [--url <string>] (default is a local stand-in server)" << std::endl
+      << "   [--port <int>]" << std::endl
+      << "   [--nconnections <int>]" << std::endl
+      << "   [--nrequests <int>]" << std::endl
+      << "   [--body-size <int>]" << std::endl
+      << "   [--max-connections-per-host <int>]" << std::endl;
+    return out.str();
+  }
+
+  //exec
+  virtual Array exec(Array data, std::vector<String> args) override
+  {
+    String url;
+    int port = 10988;
+    int nconnections = 64;
+    int nrequests = 2000;
+    int body_size = 64 * 1024;
+    int max_connections_per_host = 0;
+
+    for (int I = 1; I < (int)args.size(); I++)
+    {
+      if (args[I] == "--url")
+        url = args[++I];
+
+      else if (args[I] == "--port")
+        port = cint(args[++I]);
+
+      else if (args[I] == "--nconnections")
+        nconnections = cint(args[++I]);
+
+      else if (args[I] == "--nrequests")
+        nrequests = cint(args[++I]);
+
+      else if (args[I] == "--body-size")
+        body_size = cint(args[++I]);
+
+      else if (args[I] == "--max-connections-per-host")
+        max_connections_per_host = cint(args[++I]);
+
+      else
+        ThrowException(args[0], "Invalid arguments", args[I]);
+    }
+
+    //stand-in for an object storage, returns a fixed size blob per request
+    SharedPtr<NetServer> server;
+    if (url.empty())
+    {
+      url = concatenate("http://127.0.0.1:", port, "/blob");
+      server = std::make_shared<NetServer>(port, new TestNetServerSpeed::EchoModule(body_size), 8);
+      server->setKeepAlive(true);
+      server->runInBackground();
+      Thread::sleep(200);
+    }
+
+    std::vector<String> modes = { "fresh-connect", "keep-alive", "http2" };
+    for (auto mode : modes)
+    {
+      StringTree config("netservice");
+      config.write("keep_alive", mode != "fresh-connect");
+      config.write("http2", mode == "http2");
+      config.write("max_connections_per_host", max_connections_per_host);
+
+      auto service = std::make_shared<NetService>(nconnections, config, false);
+      NetService::global_stats()->resetStats();
+
+      int nok = 0, nfailed = 0;
+      auto t1 = Time::now();
+
+      std::deque< Future<NetResponse> > running;
+      for (int R = 0; R < nrequests || !running.empty(); )
+      {
+        if (R < nrequests && (int)running.size() < 2 * nconnections)
+        {
+          running.push_back(NetService::push(service, NetRequest(url)));
+          R++;
+          continue;
+        }
+
+        auto response = running.front().get();
+        running.pop_front();
+        if (response.isSuccessful())
+          nok++;
+        else
+          nfailed++;
+      }
+
+      auto sec = t1.elapsedSec();
+      PrintInfo(mode, "http2", service->isHttp2(), "nconnections", nconnections, "nok", nok, "nfailed", nfailed, "new_connections", NetService::global_stats()->getNumNewConnections(), 
+        "sec", sec, "blocks/sec", sec ? nok / sec : 0.0, "MB/sec", sec ? NetService::global_stats()->getReadBytes() / (1024.0 * 1024.0) / sec : 0.0);
+    }
+
+    NetService::global_stats()->resetStats();
+
+    if (server)
+    {
+      server->signalExit();
+      server->waitForExit();
+    }
+
+    return data;
+  }
+};
+
+///////////////////////////////////////////////////////////
+class TestThreadPoolSpeed : public VisusConvert::Step
+{
+public:
+
+  //getHelp
+  virtual String getHelp(std::vector<String> args) override
+  {
+    std::ostringstream out;
+    out << args[0]
+      << "   [--nthreads <int>]" << std::endl
+      << "   [--njobs <int>]" << std::endl
+      << "   [--fanout <int>] (inner jobs pushed by each outer job)" << std::endl
+      << "   [--work <int>] (loop iterations per job)" << std::endl;
+    return out.str();
+  }
+
+  //exec
+  virtual Array exec(Array data, std::vector<String> args) override
+  {
+    int nthreads = std::max(2, (int)std::thread::hardware_concurrency());
+    Int64 njobs = 1000000;
+    int fanout = 16;
+    int work = 0;
+
+    for (int I = 1; I < (int)args.size(); I++)
+    {
+      if (args[I] == "--nthreads")
+        nthreads = cint(args[++I]);
+
+      else if (args[I] == "--njobs")
+        njobs = cint64(args[++I]);
+
+      else if (args[I] == "--fanout")
+        fanout = std::max(1, cint(args[++I]));
+
+      else if (args[I] == "--work")
+        work = cint(args[++I]);
+
+      else
+        ThrowException(args[0], "Invalid arguments", args[I]);
+    }
+
+    std::atomic<Int64> counter(0);
+    auto job = [&counter, work]() {
+      volatile int acc = 0;
+      for (int I = 0; I < work; I++)
+        acc = acc + I;
+      counter++;
+    };
+
+    auto run = [&](String name, std::function<void()> fn, double base_msec) {
+      counter = 0;
+      auto t1 = Time::now();
+      fn();
+      double msec = (double)t1.elapsedMsec();
+      if (counter != njobs)
+        ThrowException(args[0], name, "wrong number of executed jobs", (Int64)counter, "expected", njobs);
+      PrintInfo(name, "msec", msec, "Mjobs/sec", msec ? (njobs / 1000.0) / msec : 0.0, "speedup", msec && base_msec ? base_msec / msec : 1.0);
+      return msec;
+    };
+
+    Int64 nouter = njobs / fanout;
+    njobs = nouter * fanout;
+
+    PrintInfo("thread-pool-speed", "nthreads", nthreads, "njobs", njobs, "fanout", fanout, "work", work);
+
+    //all jobs pushed by the main thread
+    double base_msec = run("ThreadPool[flat]", [&]() {
+      auto pool = std::make_shared<ThreadPool>("ThreadPool Speed", nthreads);
+      for (Int64 N = 0; N < njobs; N++)
+        ThreadPool::push(pool, job);
+      pool->waitAll();
+    }, 0.0);
+
+    //jobs pushing other jobs (the typical pattern producing contention on a single queue)
+    run("ThreadPool[nested]", [&]() {
+      auto pool = std::make_shared<ThreadPool>("ThreadPool Speed", nthreads);
+      for (Int64 N = 0; N < nouter; N++)
+      {
+        ThreadPool::push(pool, [&]() {
+          for (int K = 0; K < fanout; K++)
+            ThreadPool::push(pool, job);
+        });
+      }
+      pool->waitAll();
+    }, base_msec);
+
+    run("ThreadPool[nested,groups]", [&]() {
+      auto pool = std::make_shared<ThreadPool>("ThreadPool Speed", nthreads);
+      ThreadPool::TaskGroup outer(pool);
+      for (Int64 N = 0; N < nouter; N++)
+      {
+        outer.push([&]() {
+          ThreadPool::TaskGroup inner(pool);
+          for (int K = 0; K < fanout; K++)
+            inner.push(job);
+          inner.wait();
+        });
+      }
+      outer.wait();
+    }, base_msec);
+
+    return data;
+  }
+};
+
 } //namespace Private
 
 //////////////////////////////////////////////////////////////////////////////
@@ -719,7 +2684,20 @@ VisusConvert::VisusConvert()
   addAction("resize", []() {return std::make_shared<ResizeData>(); });
   addAction("resample", []() {return std::make_shared<ResampleData>(); });
   addAction("get-component", []() {return std::make_shared<GetComponent>(); });
+  addAction("arco-shard", []() {return std::make_shared<ArcoShardDataset>(); });
+  addAction("recompress", []() {return std::make_shared<RecompressDataset>(); });
   addAction("idx-memory", []() {return std::make_shared<TestIdxMemory>(); });
+  addAction("idx-read-speed", []() {return std::make_shared<TestIdxReadSpeed>(); });
+  addAction("idx-merge-speed", []() {return std::make_shared<TestIdxMergeSpeed>(); });
+  addAction("idx-write-speed", []() {return std::make_shared<TestIdxWriteSpeed>(); });
+  addAction("idx-ingest-speed", []() {return std::make_shared<TestIdxIngestSpeed>(); });
+  addAction("block-summary", []() {return std::make_shared<TestBlockSummary>(); });
+  addAction("filter-query-speed", []() {return std::make_shared<TestFilterQuerySpeed>(); });
+  addAction("box-query-reuse", []() {return std::make_shared<TestBoxQueryReuse>(); });
+  addAction("hz-address-speed", []() {return std::make_shared<TestHzAddressSpeed>(); });
+  addAction("net-server-speed", []() {return std::make_shared<TestNetServerSpeed>(); });
+  addAction("net-service-speed", []() {return std::make_shared<TestNetServiceSpeed>(); });
+  addAction("thread-pool-speed", []() {return std::make_shared<TestThreadPoolSpeed>(); });
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -38,7 +38,16 @@ For support : support@visus.net
 
 #include <Visus/Encoder.h>
 #include <Visus/IdxDataset.h>
+#include <Visus/IdxHzOrder.h>
+#include <Visus/RamAccess.h>
+#include <Visus/IdxMultipleDataset.h>
+#include <Visus/IdxMultipleExpression.h>
 #include <Visus/File.h>
+#include <Visus/NetServer.h>
+#include <Visus/VisusConvert.h>
+
+#include <random>
+#include <set>
 
 namespace Visus {
 
@@ -288,6 +297,502 @@ protected:
 }; //end class 
 
 
+////////////////////////////////////////////////////////////////////////////////////
+//serves the files of a directory, with (inclusive) byte ranges as cloud storages do
+class SelfTestRangeServer : public NetServerModule
+{
+public:
+
+  String directory;
+
+  //constructor
+  SelfTestRangeServer(String directory_) : directory(directory_) {
+  }
+
+  //handleRequest
+  virtual NetResponse handleRequest(NetRequest request) override
+  {
+    auto body = Utils::loadBinaryDocument(directory + request.url.getPath());
+    if (!body)
+      return NetResponse(HttpStatus::STATUS_NOT_FOUND);
+
+    NetResponse response(HttpStatus::STATUS_OK);
+    response.body = body;
+
+    //bytes=<first>-<last>
+    auto range = request.getHeader("Range");
+    if (StringUtils::startsWith(range, "bytes="))
+    {
+      auto v = StringUtils::split(range.substr(6), "-");
+      auto first = cint64(v[0]);
+      auto last = std::min(cint64(v[1]), body->c_size() - 1);
+      if (first > last)
+        return NetResponse(HttpStatus::STATUS_REQUESTED_RANGE_NOT_SATISFIABLE);
+
+      response.status = HttpStatus::STATUS_PARTIAL_CONTENT;
+      response.body = std::make_shared<HeapMemory>();
+      VisusReleaseAssert(response.body->resize(last - first + 1, __FILE__, __LINE__));
+      memcpy(response.body->c_ptr(), body->c_ptr() + first, (size_t)response.body->c_size());
+    }
+
+    response.setContentLength(response.body->c_size());
+    return response;
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////////
+//read a sharded arco dataset with range requests (see CloudStorageAccess)
+static void SelfTestArcoShard()
+{
+  String directory = "tmp/self_test_shard";
+
+  Array data(PointNi(64, 64, 64), DTypes::UINT8);
+  for (Int64 I = 0, N = data.c_size(); I < N; I++)
+    data.c_ptr()[I] = (Uint8)(I * 7 + I / 4096);
+
+  {
+    IdxFile idxfile;
+    idxfile.logic_box = BoxNi(PointNi(0, 0, 0), data.dims);
+    idxfile.fields.push_back(Field::fromString("myfield uint8 compression(zip)")); //CloudStorageAccess default compression
+    idxfile.arco = 4096;
+    idxfile.save(directory + "/arco/visus.idx");
+  }
+
+  {
+    auto dataset = LoadDataset(directory + "/arco/visus.idx");
+    auto access = dataset->createAccess();
+    auto query = dataset->createBoxQuery(dataset->getLogicBox(), 'w');
+    dataset->beginBoxQuery(query);
+    query->buffer = data;
+    VisusReleaseAssert(dataset->executeBoxQuery(access, query));
+  }
+
+  VisusConvert().runFromArgs({ "arco-shard", directory + "/arco/visus.idx", directory + "/sharded/visus.idx", "--shard", "16" });
+
+  const int port = 10089;
+  auto server = std::make_shared<NetServer>(port, new SelfTestRangeServer(directory), 2);
+  server->runInBackground();
+  Thread::sleep(200);
+
+  {
+    auto dataset = LoadDataset(concatenate("http://127.0.0.1:", port, "/sharded/visus.idx"));
+    VisusReleaseAssert(dataset->idxfile.arco_shard == 16);
+    auto access = dataset->createAccess();
+    auto query = dataset->createBoxQuery(dataset->getLogicBox(), 'r');
+    dataset->beginBoxQuery(query);
+    VisusReleaseAssert(dataset->executeBoxQuery(access, query));
+    VisusReleaseAssert(query->buffer.c_size() == data.c_size());
+    VisusReleaseAssert(memcmp(query->buffer.c_ptr(), data.c_ptr(), (size_t)data.c_size()) == 0);
+  }
+
+  server->signalExit();
+  server->waitForExit();
+  FileUtils::removeDirectory(Path(directory));
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////
+//HzOrder and FastHzOrder (table and bmi2) must agree, and hz addresses must survive the text protocol
+static void SelfTestHzAddress()
+{
+  std::mt19937_64 rnd(0);
+  for (int pdim = 2; pdim <= 5; pdim++)
+  {
+    int maxh = HzOrder::getMaxSupportedResolution();
+
+    //round robin bitmask, for example V012012012...
+    String pattern = "V";
+    for (int H = 0; H < maxh; H++)
+      pattern += cstring(H % pdim);
+
+    auto bitmask = DatasetBitmask::fromString(pattern);
+    HzOrder hzorder(bitmask);
+    FastHzOrder fast_hzorder(bitmask);
+    auto use_bmi2 = fast_hzorder.use_bmi2;
+    auto dims = bitmask.getPow2Dims();
+    BigInt last_address = (((BigInt)1) << maxh) - 1;
+
+    std::vector<PointNi> points = { PointNi(pdim), dims - PointNi::one(pdim) };
+    for (int N = 0; N < 10000; N++)
+    {
+      auto p = PointNi(pdim);
+      for (int D = 0; D < pdim; D++)
+        p[D] = (Int64)(rnd() % (Uint64)dims[D]);
+      points.push_back(p);
+    }
+
+    for (auto p : points)
+    {
+      auto hz = hzorder.getAddress(p);
+      VisusReleaseAssert(hz >= 0 && hz <= last_address);
+      VisusReleaseAssert(hzorder.getPoint(hz) == p);
+
+      for (auto bmi2 : { false, use_bmi2 })
+      {
+        fast_hzorder.use_bmi2 = bmi2;
+        VisusReleaseAssert(fast_hzorder.getAddress(p) == hz);
+        VisusReleaseAssert(fast_hzorder.getPoint(hz) == p);
+      }
+
+      //this is how block ids travel in the mod_visus protocol
+      VisusReleaseAssert(cbigint(cstring(hz)) == hz);
+    }
+
+    VisusReleaseAssert(hzorder.getAddress(dims - PointNi::one(pdim)) == last_address);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+//per-block summaries written by ingestDataset must match the data
+static void SelfTestBlockSummary()
+{
+  String filename = "tmp/self_test_summary/visus.idx";
+  PointNi dims(60, 40, 20); //not a power of two, samples outside the logic box must not be part of the summaries
+  Range range(100, 102, 0);
+
+  {
+    IdxFile idxfile;
+    idxfile.logic_box = BoxNi(PointNi(0, 0, 0), dims);
+    idxfile.fields.push_back(Field::fromString("data float32 compression(zip)"));
+    idxfile.bitsperblock = 10;
+    idxfile.save(filename);
+  }
+
+  auto db = LoadDataset(filename);
+  auto field = db->getField();
+
+  //1 + x + 2*y + 3*z (never zero, so that padding would show up in the minimum)
+  auto generate = [&](BoxNi slab_box) {
+    Array ret(slab_box.size(), field.dtype);
+    auto ptr = (Float32*)ret.c_ptr();
+    for (auto P = ForEachPoint(slab_box.size()); !P.end(); P.next())
+      *ptr++ = (Float32)(1 + (slab_box.p1[0] + P.pos[0]) + 2 * (slab_box.p1[1] + P.pos[1]) + 3 * (slab_box.p1[2] + P.pos[2]));
+    return ret;
+  };
+
+  VisusReleaseAssert(db->ingestDataset(field, db->getTime(), generate, 0, db->createAccessForBlockQuery(StringTree("access", "block_summary", "1"))));
+
+  auto access = db->createAccessForBlockQuery();
+  auto summary = db->computeFieldSummary(access, field, db->getTime());
+  auto blocks = db->findBlocksInRange(access, field, db->getTime(), range);
+  VisusReleaseAssert(summary.valid());
+
+  auto query = db->createBoxQuery(db->getLogicBox(), 'r');
+  db->beginBoxQuery(query);
+  VisusReleaseAssert(db->executeBoxQuery(db->createAccess(), query));
+
+  auto ptr = (const Float32*)query->buffer.c_ptr();
+  Int64 tot = query->buffer.getTotalNumberOfSamples();
+  double m = ptr[0], M = ptr[0], sum = 0;
+  for (Int64 I = 0; I < tot; I++)
+  {
+    m = std::min(m, (double)ptr[I]);
+    M = std::max(M, (double)ptr[I]);
+    sum += ptr[I];
+  }
+
+  const auto& component = summary.components[0];
+  VisusReleaseAssert(summary.nsamples == tot);
+  VisusReleaseAssert(component.min == m && component.max == M);
+  VisusReleaseAssert(std::fabs(component.mean - sum / tot) <= 1e-6 * std::fabs(sum / tot));
+
+  //blocks not in the candidates must not contain values in range
+  std::set<BigInt> candidates(blocks.begin(), blocks.end());
+  access->beginRead();
+  for (BigInt blockid = 0, nblocks = db->getTotalNumberOfBlocks(); blockid < nblocks; blockid++)
+  {
+    auto block_query = db->createBlockQuery(blockid, field, db->getTime(), 'r');
+    if (!db->executeBlockQueryAndWait(access, block_query))
+      continue;
+
+    auto samples = (const Float32*)block_query->buffer.c_ptr();
+    for (Int64 I = 0, N = block_query->buffer.getTotalNumberOfSamples(); I < N; I++)
+    {
+      if (samples[I] >= range.from && samples[I] <= range.to)
+        VisusReleaseAssert(candidates.count(blockid));
+    }
+  }
+  access->endRead();
+
+  db.reset();
+  FileUtils::removeDirectory(Path("tmp/self_test_summary"));
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+//viewport queries reusing the samples of the previous result must give the same buffers
+static void SelfTestBoxQueryReuse()
+{
+  String filename = "tmp/self_test_reuse/visus.idx";
+
+  {
+    IdxFile idxfile;
+    idxfile.logic_box = BoxNi(PointNi(0, 0), PointNi(256, 256));
+    idxfile.fields.push_back(Field("myfield", DTypes::UINT8));
+    idxfile.bitsperblock = 8;
+    idxfile.blocksperfile = 16;
+    idxfile.save(filename);
+  }
+
+  auto db = LoadDataset(filename);
+
+  {
+    auto query = db->createBoxQuery(db->getLogicBox(), 'w');
+    db->beginBoxQuery(query);
+    query->buffer = Array(query->getNumberOfSamples(), query->field.dtype);
+    for (Int64 I = 0, N = query->buffer.c_size(); I < N; I++)
+      query->buffer.c_ptr()[I] = (Uint8)(I * 13 + I / 256);
+    VisusReleaseAssert(db->executeBoxQuery(db->createAccess(), query));
+  }
+
+  auto field = db->getField();
+  int pdim = db->getPointDim();
+  auto minh = db->getDefaultBitsPerBlock();
+  auto maxh = db->getMaxResolution();
+  auto logic_box = db->getLogicBox();
+
+  //pan along the first axis, zoom in, pan along the second axis, zoom out
+  std::vector<BoxNi> trace;
+  {
+    auto box = BoxNi(PointNi(64, 64), PointNi(128, 128));
+
+    auto pan = [&](int D) {
+      for (int I = 0; I < 4; I++)
+      {
+        box.p1[D] += 8;
+        box.p2[D] += 8;
+        trace.push_back(box.getIntersection(logic_box));
+      }
+    };
+
+    auto zoom = [&](double factor) {
+      for (int D = 0; D < pdim; D++)
+      {
+        auto center = (box.p1[D] + box.p2[D]) / 2;
+        auto half = std::max((Int64)1, (Int64)(box.size()[D] * factor / 2));
+        box.p1[D] = center - half;
+        box.p2[D] = center + half;
+      }
+      trace.push_back(box.getIntersection(logic_box));
+    };
+
+    trace.push_back(box);
+    pan(0);
+    zoom(0.5);
+    pan(1);
+    zoom(2.0);
+  }
+
+  std::vector<Array> results;
+  for (auto bReuse : { false, true })
+  {
+    auto access = db->createAccess();
+    Array last_buffer;
+    LogicSamples last_samples;
+
+    for (int I = 0; I < (int)trace.size(); I++)
+    {
+      auto query = db->createBoxQuery(trace[I], field, db->getTime(), 'r');
+      for (int H = minh; H <= maxh; H += pdim)
+        query->end_resolutions.push_back(H);
+
+      if (bReuse)
+      {
+        query->reuse.buffer = last_buffer;
+        query->reuse.logic_samples = last_samples;
+      }
+
+      db->beginBoxQuery(query);
+      for (; query->isRunning(); db->nextBoxQuery(query))
+      {
+        VisusReleaseAssert(db->executeBoxQuery(access, query));
+        last_buffer = query->buffer;
+        last_samples = query->logic_samples;
+      }
+
+      if (!bReuse)
+        results.push_back(last_buffer);
+      else
+        VisusReleaseAssert(last_buffer.dims == results[I].dims && memcmp(last_buffer.c_ptr(), results[I].c_ptr(), (size_t)last_buffer.c_size()) == 0);
+    }
+  }
+
+  //samples of the blocks that failed (here a file not available) must be read again
+  {
+    auto read = [&](SharedPtr<BoxQuery> last) {
+      auto query = db->createBoxQuery(logic_box, field, db->getTime(), 'r');
+      query->end_resolutions = { maxh - pdim, maxh };
+      if (last)
+      {
+        query->reuse.buffer = last->buffer;
+        query->reuse.logic_samples = last->logic_samples;
+        query->reuse.failed_boxes = last->failed_boxes;
+      }
+      db->beginBoxQuery(query);
+      for (; query->isRunning(); db->nextBoxQuery(query))
+        VisusReleaseAssert(db->executeBoxQuery(db->createAccess(), query));
+      return query;
+    };
+
+    auto full = read(SharedPtr<BoxQuery>());
+    VisusReleaseAssert(full->failed_boxes.empty());
+
+    //a block read in the first step, so that the next steps must not copy its old samples again
+    String block_filename = db->createAccess()->getFilename(field, db->getTime(), db->getTotalNumberOfBlocks() / 8);
+    VisusReleaseAssert(FileUtils::moveFile(block_filename, block_filename + ".~moved"));
+    auto partial = read(SharedPtr<BoxQuery>());
+    VisusReleaseAssert(FileUtils::moveFile(block_filename + ".~moved", block_filename));
+    VisusReleaseAssert(!partial->failed_boxes.empty());
+
+    auto reused = read(partial);
+    VisusReleaseAssert(reused->failed_boxes.empty());
+    VisusReleaseAssert(reused->buffer.dims == full->buffer.dims && memcmp(reused->buffer.c_ptr(), full->buffer.c_ptr(), (size_t)full->buffer.c_size()) == 0);
+  }
+
+  db.reset();
+  FileUtils::removeDirectory(Path("tmp/self_test_reuse"));
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+//incremental and level-by-level filter reconstruction must give the same buffers
+static void SelfTestFilterQuery()
+{
+  String filename = "tmp/self_test_filter/visus.idx";
+
+  {
+    IdxFile idxfile;
+    idxfile.logic_box = BoxNi(PointNi(0, 0), PointNi(128, 128));
+    idxfile.fields.push_back(Field::fromString("myfield float32 filter(dehaar)"));
+    idxfile.bitsperblock = 8;
+    idxfile.save(filename);
+  }
+
+  auto db = LoadIdxDataset(filename);
+  auto field = db->getField();
+
+  {
+    auto query = db->createBoxQuery(db->getLogicBox(), 'w');
+    db->beginBoxQuery(query);
+    query->buffer = Array(query->getNumberOfSamples(), field.dtype);
+    auto ptr = (Float32*)query->buffer.c_ptr();
+    for (Int64 I = 0, N = query->buffer.getTotalNumberOfSamples(); I < N; I++)
+      ptr[I] = (Float32)((I * 7) % 251);
+    VisusReleaseAssert(db->executeBoxQuery(db->createAccess(), query));
+  }
+
+  db->computeFilter(field, 32);
+
+  Array expected;
+  for (auto incremental : { false, true })
+  {
+    db->incremental_filter_query = incremental;
+
+    auto access = db->createAccess();
+    auto query = db->createBoxQuery(BoxNi(PointNi(10, 20), PointNi(100, 90)), field, db->getTime(), 'r');
+    query->end_resolutions = { 6, 10, db->getMaxResolution() };
+    query->enableFilters();
+
+    db->beginBoxQuery(query);
+    VisusReleaseAssert(query->isRunning());
+    for (; query->isRunning(); db->nextBoxQuery(query))
+      VisusReleaseAssert(db->executeBoxQuery(access, query));
+
+    if (!incremental)
+      expected = query->buffer;
+    else
+      VisusReleaseAssert(query->buffer.dims == expected.dims && memcmp(query->buffer.c_ptr(), expected.c_ptr(), (size_t)expected.c_size()) == 0);
+  }
+
+  db->incremental_filter_query = true;
+  db.reset();
+  FileUtils::removeDirectory(Path("tmp/self_test_filter"));
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////
+//RamAccess must not keep a reference to the writer's buffer (python writes numpy memory it owns)
+static void SelfTestRamAccess()
+{
+  String filename = "tmp/self_test_ram/visus.idx";
+
+  {
+    IdxFile idxfile;
+    idxfile.logic_box = BoxNi(PointNi(0, 0), PointNi(64, 64));
+    idxfile.fields.push_back(Field("myfield", DTypes::UINT8));
+    idxfile.bitsperblock = 8;
+    idxfile.save(filename);
+  }
+
+  auto db = LoadDataset(filename);
+  auto access = std::make_shared<RamAccess>(db->getDefaultBitsPerBlock());
+  access->disableWriteLocks();
+
+  auto blockid = db->getTotalNumberOfBlocks() - 1;
+  auto write = db->createBlockQuery(blockid, db->getField(), db->getTime(), 'w');
+  auto nsamples = write->getNumberOfSamples().innerProduct();
+
+  {
+    auto temp = std::make_shared< std::vector<Uint8> >((size_t)nsamples);
+    for (Int64 I = 0; I < nsamples; I++)
+      (*temp)[I] = (Uint8)(I * 3);
+
+    write->buffer = Array(write->getNumberOfSamples(), DTypes::UINT8, HeapMemory::createUnmanaged(temp->data(), nsamples));
+    access->beginWrite();
+    VisusReleaseAssert(db->executeBlockQueryAndWait(access, write));
+    access->endWrite();
+
+    //the writer changes and then frees its memory
+    std::fill(temp->begin(), temp->end(), (Uint8)0xff);
+    write->buffer = Array();
+  }
+
+  auto read = db->createBlockQuery(blockid, db->getField(), db->getTime(), 'r');
+  access->beginRead();
+  VisusReleaseAssert(db->executeBlockQueryAndWait(access, read));
+  access->endRead();
+
+  VisusReleaseAssert(read->buffer.c_size() == nsamples);
+  for (Int64 I = 0; I < nsamples; I++)
+    VisusReleaseAssert(read->buffer.c_ptr()[I] == (Uint8)(I * 3));
+
+  db.reset();
+  FileUtils::removeDirectory(Path("tmp/self_test_ram"));
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////
+//midx expressions on 64 bit integers must not be evaluated natively (samples are evaluated as double)
+static void SelfTestMidxExpression()
+{
+  String directory = "tmp/self_test_midx";
+
+  for (auto it : std::vector< std::pair<String, String> >({ {"A","int32"}, {"B","int64"} }))
+  {
+    IdxFile idxfile;
+    idxfile.logic_box = BoxNi(PointNi(0, 0), PointNi(16, 16));
+    idxfile.fields.push_back(Field::fromString("data " + it.second));
+    idxfile.save(directory + "/" + it.first + "/visus.idx");
+  }
+
+  Utils::saveTextDocument(directory + "/visus.midx",
+    "<dataset typename='IdxMultipleDataset'>\n"
+    "  <field name='sum'><code>output=input.A.data+input.A.data</code></field>\n"
+    "  <dataset url='./A/visus.idx' name='A' />\n"
+    "  <dataset url='./B/visus.idx' name='B' />\n"
+    "</dataset>\n");
+
+  {
+    auto midx = std::dynamic_pointer_cast<IdxMultipleDataset>(LoadDataset(directory + "/visus.midx"));
+    VisusReleaseAssert(midx);
+    VisusReleaseAssert( IdxMultipleExpression::compile(midx.get(), "output=input.A.data*2+input.A.data"));
+    VisusReleaseAssert(!IdxMultipleExpression::compile(midx.get(), "output=input.B.data+input.A.data"));
+    VisusReleaseAssert(!IdxMultipleExpression::compile(midx.get(), "output=ArrayUtils.cast(input.A.data, 'int64')"));
+    VisusReleaseAssert(!IdxMultipleExpression::compile(midx.get(), "output=voronoi()"));
+  }
+
+  FileUtils::removeDirectory(Path(directory));
+}
+
+
 /////////////////////////////////////////////////////
 void SelfTestIdx(int max_seconds)
 {
@@ -320,6 +825,34 @@ void SelfTestIdx(int max_seconds)
   }
 #endif
 
+  PrintInfo("Running SelfTestArcoShard...");
+  SelfTestArcoShard();
+  PrintInfo("...done");
+
+  PrintInfo("Running SelfTestHzAddress...");
+  SelfTestHzAddress();
+  PrintInfo("...done");
+
+  PrintInfo("Running SelfTestBlockSummary...");
+  SelfTestBlockSummary();
+  PrintInfo("...done");
+
+  PrintInfo("Running SelfTestBoxQueryReuse...");
+  SelfTestBoxQueryReuse();
+  PrintInfo("...done");
+
+  PrintInfo("Running SelfTestFilterQuery...");
+  SelfTestFilterQuery();
+  PrintInfo("...done");
+
+  PrintInfo("Running SelfTestRamAccess...");
+  SelfTestRamAccess();
+  PrintInfo("...done");
+
+  PrintInfo("Running SelfTestMidxExpression...");
+  SelfTestMidxExpression();
+  PrintInfo("...done");
+
   ////do self testing on random field
   PrintInfo("Running self test procedure max_seconds", max_seconds, "...");
 
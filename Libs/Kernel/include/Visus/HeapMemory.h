@@ -65,6 +65,9 @@ public:
   //createManaged
   static SharedPtr<HeapMemory> createManaged(Uint8* p, Int64 n);
 
+  //createSlice (zero-copy view of [offset,offset+n) keeping <parent> alive; parent must not be reallocated)
+  static SharedPtr<HeapMemory> createSlice(SharedPtr<HeapMemory> parent, Int64 offset, Int64 n);
+
   //clone
   SharedPtr<HeapMemory> clone() const;
 
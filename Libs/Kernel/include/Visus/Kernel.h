@@ -47,6 +47,8 @@ For support : support@visus.net
 #include <atomic>
 #include <exception>
 #include <vector>
+#include <limits>
+#include <cctype>
 
 //__________________________________________________________
 #if defined(_WIN32)
@@ -117,7 +119,13 @@ typedef float              Float32;
 typedef double             Float64;
 typedef long long          Int64;
 typedef unsigned long long Uint64;
+
+//hz addresses and block ids (use cmake -DVISUS_BIGINT_128=1 for datasets with maxh>=63, gcc/clang only)
+#if VISUS_BIGINT_128 && !SWIG
+typedef __int128           BigInt;
+#else
 typedef Int64              BigInt;
+#endif
 
 typedef std::string String;
 
@@ -160,6 +168,24 @@ VISUS_KERNEL_API inline String     cstring(const char* value)    { return String
 VISUS_KERNEL_API inline String     cstring(char* value)          { return String(value); }
 #endif
 
+#if VISUS_BIGINT_128 && !SWIG
+//BigInt->String
+VISUS_KERNEL_API inline String cstring(BigInt v) 
+{
+  if (v >= std::numeric_limits<Int64>::min() && v <= std::numeric_limits<Int64>::max())
+    return std::to_string((Int64)v);
+
+  bool negative = v < 0;
+  unsigned __int128 u = negative ? (unsigned __int128)(-(v + 1)) + 1 : (unsigned __int128)v;
+  String ret;
+  for (; u; u /= 10)
+    ret.push_back((char)('0' + (int)(u % 10)));
+  if (negative) 
+    ret.push_back('-');
+  return String(ret.rbegin(), ret.rend());
+}
+#endif
+
 template <typename Value>
 inline String cstring(const Value& value) { 
   return value.toString(); 
@@ -207,6 +233,28 @@ VISUS_KERNEL_API inline double     cdouble(const String& s) { return s.empty() ?
 VISUS_KERNEL_API inline Int64      cint64 (const String& s) { return s.empty() ? 0 : std::stoll(s); }
 VISUS_KERNEL_API inline Uint64     cuint64(const String& s) { return s.empty() ? 0 : std::stoull(s); }
 
+#if VISUS_BIGINT_128 && !SWIG
+
+//String->BigInt
+VISUS_KERNEL_API inline BigInt cbigint(const String& s) 
+{
+  BigInt ret = 0;
+  int I = 0, N = (int)s.size();
+  while (I < N && isspace(s[I])) I++;
+  bool negative = I < N && s[I] == '-';
+  if (I < N && (s[I] == '-' || s[I] == '+')) I++;
+  for (; I < N && isdigit(s[I]); I++)
+    ret = ret * 10 + (s[I] - '0');
+  return negative ? -ret : ret;
+}
+
+//BigInt->Int64
+VISUS_KERNEL_API inline Int64 cint64(const BigInt& value) {
+  return (Int64)value;
+}
+
+#else
+
 //String->BigInt
 VISUS_KERNEL_API inline BigInt cbigint(const String& s) {
   return cint64(s);
@@ -217,6 +265,8 @@ VISUS_KERNEL_API inline Int64 cint64(const BigInt& value) {
   return value;
 }
 
+#endif
+
 template <typename Value>
 inline Value from_string(const std::string& s) {
   std::istringstream parser(s);
@@ -222,6 +222,9 @@ public:
   //setArrayBody
   bool setArrayBody(String compression,Array value);
 
+  //setArrayBody (<encoded> is <value> already encoded with <compression>, if null it will be computed)
+  bool setArrayBody(String compression, Array value, SharedPtr<HeapMemory> encoded);
+
   //getArrayBody
   Array getArrayBody() const {
     return ArrayUtils::decodeArray(this->headers, this->body);
@@ -311,6 +314,8 @@ public:
 
 };
 
+class NetResponse;
+
 ///////////////////////////////////////////////////////////////////////////////////////
 class VISUS_KERNEL_API NetRequest : public NetMessage
 {
@@ -337,6 +342,11 @@ public:
   }
   statistics;
 
+#if !SWIG
+  //(optional) called by NetService while the body is downloading, only when the body will not be reallocated (i.e. Content-Length is known)
+  std::function<void(const NetResponse&)> on_body_progress;
+#endif
+
   //default constructor
   NetRequest() : method("GET")
   {}
@@ -419,6 +429,13 @@ public:
   //decompose
   static std::vector<NetResponse> decompose(NetResponse RESPONSE);
 
+  //appendFrame (binary framing of multiple responses: length-prefixed records that can be written and read as they come)
+  bool appendFrame(String id, const NetResponse& response);
+
+  //readFrame (1 if a record has been read, 0 if there is no complete record yet at <offset>, -1 if the data is corrupted)
+  //NOTE the response body is a zero-copy slice of this body
+  int readFrame(Int64& offset, String& id, NetResponse& response) const;
+
 };
 
 } //namespace Visus
@@ -45,6 +45,8 @@ For support : support@visus.net
 #include <Visus/NetMessage.h>
 #include <Visus/NetSocket.h>
 
+#include <atomic>
+
 namespace Visus {
 
 
@@ -84,6 +86,21 @@ public:
     this->verbose = value;
   }
 
+  //setKeepAlive (persistent connections and pipelined requests; on linux connections are multiplexed with epoll)
+  void setKeepAlive(bool value) {
+    this->keep_alive = value;
+  }
+
+  //isKeepAlive
+  bool isKeepAlive() const {
+    return keep_alive;
+  }
+
+  //setReadTimeout (msec, a client that does not send a complete request in time is disconnected)
+  void setReadTimeout(int msec) {
+    this->read_timeout = msec;
+  }
+
   //runInThisThread
   void runInThisThread();
 
@@ -105,9 +122,20 @@ protected:
   UniquePtr<NetServerModule> module;
   SharedPtr<std::thread>     thread;
   bool                       bExitThread = false;
+  bool                       keep_alive = false;
+  int                        read_timeout = 30000;
 
   //writeResponse
-  bool writeResponse(NetSocket* client, NetResponse response);
+  bool writeResponse(NetSocket* client, NetResponse response, bool bKeepAlive = false);
+
+  //handleNextRequest (return true if the connection should stay open)
+  bool handleNextRequest(NetSocket* client);
+
+  //waitForNextRequest (false if an idle persistent connection should be closed)
+  bool waitForNextRequest(NetSocket* client, const std::atomic<int>& nconnections);
+
+  //runEventLoop
+  void runEventLoop(SharedPtr<NetSocket> server, SharedPtr<ThreadPool> thread_pool);
 
 }; //end class
 
@@ -43,6 +43,7 @@ For support : support@visus.net
 #include <Visus/NetMessage.h>
 #include <Visus/Async.h>
 #include <Visus/NetSocket.h>
+#include <Visus/StringTree.h>
 
 #include <atomic>
 
@@ -60,15 +61,16 @@ public:
   std::atomic<Int64> rbytes;
   std::atomic<Int64> wbytes;
   std::atomic<Int64> running_requests;
+  std::atomic<Int64> new_connections;
 #endif
 
   //constructor
-  NetGlobalStats() : tot_requests(0), running_requests(0), rbytes(0),wbytes(0) {
+  NetGlobalStats() : tot_requests(0), running_requests(0), rbytes(0),wbytes(0), new_connections(0) {
   }
 
   //resetStats
   void resetStats() {
-    tot_requests = rbytes = wbytes = 0;
+    tot_requests = rbytes = wbytes = new_connections = 0;
     //running_requests is a real number
   }
 
@@ -92,6 +94,11 @@ public:
     return (Int64)running_requests;
   }
 
+  //getNumNewConnections (i.e. requests that could not reuse an existing connection)
+  Int64 getNumNewConnections() const {
+    return new_connections;
+  }
+
 };
 
 ///////////////////////////////////////////////////////////////////////
@@ -117,6 +124,9 @@ public:
   //constructor
   NetService(int nconnections,bool bVerbose=1);
 
+  //constructor (see "keep_alive", "http2", "max_connections_per_host")
+  NetService(int nconnections, const StringTree& config, bool bVerbose = 1);
+
   //destructor
   virtual ~NetService();
 
@@ -143,6 +153,16 @@ public:
     this->connect_timeout=value;
   }
 
+  //isKeepAlive
+  bool isKeepAlive() const {
+    return keep_alive;
+  }
+
+  //isHttp2
+  bool isHttp2() const {
+    return http2;
+  }
+
   //push
   static Future<NetResponse> push(SharedPtr<NetService> service, NetRequest request);
 
@@ -161,6 +181,12 @@ private:
   int                          max_connections_per_sec = 0;
   int                          connect_timeout = 10; //in seconds (explanation in CONNECTTIMEOUT)
   int                          verbose = 0;
+  bool                         keep_alive = false;                //reuse connections instead of a fresh connect per request
+  bool                         http2 = false;                     //multiplex requests over few connections (https only)
+  int                          max_connections_per_host = 0;
+
+  //readOptions
+  void readOptions(const StringTree& config);
 
   CriticalSection              waiting_lock;
   Waiting                      waiting;
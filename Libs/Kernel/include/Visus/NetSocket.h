@@ -68,12 +68,21 @@ public:
   //destructor
   virtual ~NetSocket();
 
+  //getNativeHandle (pointer to the socket descriptor)
+  void* getNativeHandle();
+
   //shutdownSend
   void shutdownSend();
 
   //close
   void close();
 
+  //setReceiveTimeout (msec, 0 means wait forever)
+  void setReceiveTimeout(int msec);
+
+  //waitForData (true if there is something to receive, including the connection closed by the peer)
+  bool waitForData(int msec);
+
   //connect (client side)
   bool connect(String url);
 
@@ -43,9 +43,13 @@ For support : support@visus.net
 #include <Visus/Thread.h>
 
 #include <vector>
-#include <set>
 #include <deque>
 #include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <type_traits>
+#include <cstddef>
+#include <new>
 
 namespace Visus {
 
@@ -78,49 +82,259 @@ public:
 
   VISUS_NON_COPYABLE_CLASS(ThreadPool)
 
+#if !SWIG
+
+  //________________________________________________
+  //move-only callable; small closures are stored inline so pushing a job does not need a heap allocation
+  class Task
+  {
+  public:
+
+    static const size_t InlineSize = 48;
+
+    //constructor
+    Task() {
+    }
+
+    //constructor
+    template <class Fn, typename = typename std::enable_if<!std::is_same<typename std::decay<Fn>::type, Task>::value>::type >
+    Task(Fn&& fn) {
+      typedef typename std::decay<Fn>::type F;
+      typedef std::integral_constant<bool, sizeof(F) <= InlineSize && alignof(F) <= alignof(std::max_align_t) && std::is_nothrow_move_constructible<F>::value> IsInline;
+      init<F>(std::forward<Fn>(fn), IsInline());
+    }
+
+    //constructor
+    Task(Task&& other) {
+      moveFrom(other);
+    }
+
+    //destructor
+    ~Task() {
+      reset();
+    }
+
+    //operator=
+    Task& operator=(Task&& other) {
+      if (this != &other) {
+        reset();
+        moveFrom(other);
+      }
+      return *this;
+    }
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    //valid
+    bool valid() const {
+      return ops != nullptr;
+    }
+
+    //operator()
+    void operator()() {
+      ops->invoke(&storage);
+    }
+
+    //reset
+    void reset() {
+      if (ops) {
+        ops->destroy(&storage);
+        ops = nullptr;
+      }
+    }
+
+  private:
+
+    struct Ops
+    {
+      void (*invoke )(void*);
+      void (*move   )(void* dst, void* src);
+      void (*destroy)(void*);
+    };
+
+    template <class F>
+    struct InlineOps
+    {
+      static void invoke (void* p) { (*static_cast<F*>(p))(); }
+      static void move   (void* dst, void* src) { new (dst) F(std::move(*static_cast<F*>(src))); static_cast<F*>(src)->~F(); }
+      static void destroy(void* p) { static_cast<F*>(p)->~F(); }
+      static const Ops* get() { static const Ops ret = { invoke, move, destroy }; return &ret; }
+    };
+
+    template <class F>
+    struct HeapOps
+    {
+      static void invoke (void* p) { (**static_cast<F**>(p))(); }
+      static void move   (void* dst, void* src) { *static_cast<F**>(dst) = *static_cast<F**>(src); }
+      static void destroy(void* p) { delete *static_cast<F**>(p); }
+      static const Ops* get() { static const Ops ret = { invoke, move, destroy }; return &ret; }
+    };
+
+    typename std::aligned_storage<InlineSize, alignof(std::max_align_t)>::type storage;
+    const Ops* ops = nullptr;
+
+    //init (chosen at compile time, so the inline branch is never instantiated for big closures)
+    template <class F, class Fn>
+    void init(Fn&& fn, std::true_type) {
+      new (&storage) F(std::forward<Fn>(fn));
+      this->ops = InlineOps<F>::get();
+    }
+
+    //init
+    template <class F, class Fn>
+    void init(Fn&& fn, std::false_type) {
+      *reinterpret_cast<F**>(&storage) = new F(std::forward<Fn>(fn));
+      this->ops = HeapOps<F>::get();
+    }
+
+    //moveFrom
+    void moveFrom(Task& other) {
+      if ((this->ops = other.ops) != nullptr) {
+        ops->move(&storage, &other.storage);
+        other.ops = nullptr;
+      }
+    }
+
+  };
+
+  //________________________________________________
+  //a subset of jobs of a pool that can be waited for independently of waitAll
+  //if max_pending>0, push blocks while there are already max_pending jobs of the group queued or running
+  class VISUS_KERNEL_API TaskGroup
+  {
+  public:
+
+    VISUS_NON_COPYABLE_CLASS(TaskGroup)
+
+    //constructor
+    TaskGroup(SharedPtr<ThreadPool> pool_, Int64 max_pending_ = 0) : pool(pool_), max_pending(max_pending_), npending(0) {
+    }
+
+    //destructor
+    ~TaskGroup() {
+      wait();
+    }
+
+    //push
+    template <class Fn>
+    void push(Fn&& fn) 
+    {
+      if (!pool)
+      {
+        fn();
+        return;
+      }
+
+      if (max_pending > 0)
+        waitBelow(max_pending);
+
+      npending++;
+      pool->asyncRun(Task(GroupJob<typename std::decay<Fn>::type>(this, std::forward<Fn>(fn))));
+    }
+
+    //wait (if called from a worker of the same pool, the caller keeps running jobs instead of blocking)
+    void wait() {
+      waitBelow(1);
+    }
+
+  private:
+
+    template <class F>
+    struct GroupJob
+    {
+      TaskGroup* group;
+      F          fn;
+      template <class Fn>
+      GroupJob(TaskGroup* group_, Fn&& fn_) : group(group_), fn(std::forward<Fn>(fn_)) {}
+      void operator()() { fn(); group->done(); }
+    };
+
+    SharedPtr<ThreadPool>   pool;
+    Int64                   max_pending;
+    std::atomic<Int64>      npending;
+    CriticalSection         lock;
+    std::condition_variable cv;
+
+    //done
+    void done();
+
+    //waitBelow
+    void waitBelow(Int64 value);
+
+  };
+
+#endif
+
   //global_stats
   static ThreadPoolGlobalStats* global_stats() {
     static ThreadPoolGlobalStats ret;
     return &ret;
   }
 
+  //getShared (process-wide pool with one worker per core, created on first use; VISUS_NUM_THREADS overrides the size)
+  static SharedPtr<ThreadPool> getShared();
+
+  //releaseShared
+  static void releaseShared();
+
   //constructor
   ThreadPool(String basename,int num_workers);
 
   //destructor
   virtual ~ThreadPool();
 
+  //getNumWorkers
+  int getNumWorkers() const {
+    return (int)threads.size();
+  }
+
   //waitAll
   void waitAll();
 
+#if !SWIG
   //push
-  static void push(SharedPtr<ThreadPool> pool, std::function<void()> fn);
+  template <class Fn>
+  static void push(SharedPtr<ThreadPool> pool, Fn&& fn) {
+    if (pool)
+      pool->asyncRun(Task(std::forward<Fn>(fn)));
+    else
+      fn();
+  }
+#endif
 
 private:
 
-  //___________________________________________
-  class WaitAll
-  {
-  public:
-    CriticalSection  lock;
-    int              num_inside = 0;
-    Semaphore        num_done;
-    WaitAll() : num_inside(0) {}
-  };
+  class Worker;
+
+  std::vector< SharedPtr<std::thread> >   threads;
+  std::vector< SharedPtr<Worker> >        workers;
+
+  std::atomic<Int64>                      npending;   //queued but not started
+  std::atomic<Int64>                      nactive;    //queued or running
+  std::atomic<int>                        nsleeping;
+  std::atomic<Int64>                      next_worker;
+  std::atomic<bool>                       bExit;
 
+  CriticalSection                         idle_lock;
+  std::condition_variable                 idle_cv;
 
-  CriticalSection                                   lock;
-  std::vector< SharedPtr<std::thread> >             threads;
-  Semaphore                                         nwaiting;
-  std::deque< SharedPtr<std::function<void()> > >   waiting;
-  std::set  < SharedPtr<std::function<void()> > >   running;
-  WaitAll                                           wait_all;
+  CriticalSection                         done_lock;
+  std::condition_variable                 done_cv;
 
   //workerEntryProc
   void workerEntryProc(int worker);
 
+#if !SWIG
   //asyncRun
-  void asyncRun(std::function<void()> fn);
+  void asyncRun(Task task);
+
+  //popTask
+  bool popTask(int worker, Task& task);
+
+  //runTask
+  void runTask(Task& task);
+#endif
 
 };
 
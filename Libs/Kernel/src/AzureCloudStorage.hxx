@@ -146,13 +146,18 @@ public:
   // getBlob 
   virtual Future< SharedPtr<CloudStorageItem> > getBlob(SharedPtr<NetService> net, String fullname, bool head=false, std::pair<Int64, Int64> range = { 0,0 }, Aborted aborted = Aborted()) override
   {
-    //TODO range query not supported
-    VisusReleaseAssert(range.first==0 && range.second==0);
-
     auto ret = Promise< SharedPtr<CloudStorageItem> >().get_future();
 
     NetRequest request(this->protocol + "://" + this->hostname + fullname, head? "HEAD" : "GET");
     request.aborted = aborted;
+
+    //range request (NOTE the range is inclusive, and it's part of the signature)
+    if (!(range.first == 0 && range.second == 0))
+    {
+      VisusReleaseAssert(!head);
+      request.setHeader("Range", concatenate("bytes=", range.first, "-", range.second - 1));
+    }
+
     signRequest(request);
 
     NetService::push(net, request).when_ready([ret, this, fullname](NetResponse response) {
@@ -205,8 +205,8 @@ public:
     std::pair<Int64, Int64> range = {0,0}, 
     Aborted aborted = Aborted()) override
   {
-    //TODO range query not supported
-    VisusReleaseAssert(range.first == 0 && range.second == 0);
+    //range is applied to the media request
+    VisusReleaseAssert(!head || (range.first == 0 && range.second == 0));
 
     auto ret = Promise< SharedPtr<CloudStorageItem>  >().get_future();
 
@@ -214,7 +214,7 @@ public:
     v.pop_back();
     auto container_id = "/" + StringUtils::join(v, "/");
 
-    getContainerId(net, container_id,/*bCreate*/false, aborted).when_ready([this, net, head, ret, fullname, aborted](String container_id) {
+    getContainerId(net, container_id,/*bCreate*/false, aborted).when_ready([this, net, head, range, ret, fullname, aborted](String container_id) {
 
       if (container_id.empty())
       {
@@ -228,7 +228,7 @@ public:
       get_blob_id.aborted = aborted;
       signRequest(get_blob_id);
 
-      NetService::push(net, get_blob_id).when_ready([this, net, ret, head, fullname, aborted](NetResponse response) {
+      NetService::push(net, get_blob_id).when_ready([this, net, ret, head, range, fullname, aborted](NetResponse response) {
 
         if (!response.isSuccessful())
         {
@@ -249,7 +249,7 @@ public:
         get_blob_metadata.aborted = aborted;
         signRequest(get_blob_metadata);
 
-        NetService::push(net, get_blob_metadata).when_ready([this, net, ret, blob_id, head, fullname, aborted](NetResponse response) {
+        NetService::push(net, get_blob_metadata).when_ready([this, net, ret, blob_id, head, range, fullname, aborted](NetResponse response) {
 
           if (!response.isSuccessful())
           {
@@ -269,6 +269,11 @@ public:
 
           NetRequest get_blob_media(Url(this->url.toString() + "/drive/v3/files/" + blob_id + "?alt=media"), head? "HEAD" : "GET");
           get_blob_media.aborted = aborted;
+
+          //NOTE the range is inclusive
+          if (!(range.first == 0 && range.second == 0))
+            get_blob_media.setHeader("Range", concatenate("bytes=", range.first, "-", range.second - 1));
+
           signRequest(get_blob_media);
 
           NetService::push(net, get_blob_media).when_ready([ret, aborted, fullname, metadata](NetResponse response) {
@@ -76,6 +76,16 @@ SharedPtr<HeapMemory> HeapMemory::createManaged(Uint8* p, Int64 n)
 }
 
 
+////////////////////////////////////////////////////////
+SharedPtr<HeapMemory> HeapMemory::createSlice(SharedPtr<HeapMemory> parent, Int64 offset, Int64 n)
+{
+  VisusAssert(parent && offset >= 0 && n >= 0 && offset + n <= parent->c_size());
+
+  //the returned pointer shares the ownership of both the slice and the parent
+  auto holder = std::make_shared< std::pair< SharedPtr<HeapMemory>, SharedPtr<HeapMemory> > >(parent, createUnmanaged(parent->c_ptr() + offset, n));
+  return SharedPtr<HeapMemory>(holder, holder->second.get());
+}
+
 ////////////////////////////////////////////////////////
 SharedPtr<HeapMemory> HeapMemory::clone() const
 {
@@ -39,6 +39,7 @@ For support : support@visus.net
 #include <Visus/Kernel.h>
 
 #include <Visus/Thread.h>
+#include <Visus/ThreadPool.h>
 #include <Visus/NetService.h>
 #include <Visus/RamResource.h>
 #include <Visus/Path.h>
@@ -452,6 +453,8 @@ void KernelModule::detach()
 {
   if ((--attached) > 0) return;
 
+  ThreadPool::releaseShared();
+
   ArrayPlugins::releaseSingleton();
   Encoders::releaseSingleton();
   RamResource::releaseSingleton();
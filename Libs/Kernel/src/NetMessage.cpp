@@ -38,6 +38,9 @@ For support : support@visus.net
 
 #include <Visus/NetMessage.h>
 #include <Visus/Encoder.h>
+#include <Visus/ByteOrder.h>
+
+#include <limits>
 
 namespace Visus {
 
@@ -45,7 +48,14 @@ namespace Visus {
 ///////////////////////////////////////////////////////////////////
 bool NetMessage::setArrayBody(String compression,Array decoded)
 {
-  auto encoded=ArrayUtils::encodeArray(compression,decoded);
+  return setArrayBody(compression, decoded, SharedPtr<HeapMemory>());
+}
+
+///////////////////////////////////////////////////////////////////
+bool NetMessage::setArrayBody(String compression, Array decoded, SharedPtr<HeapMemory> encoded)
+{
+  if (!encoded)
+    encoded=ArrayUtils::encodeArray(compression,decoded);
 
   if (!encoded)
     return false;
@@ -351,5 +361,107 @@ std::vector<NetResponse> NetResponse::decompose(NetResponse RESPONSE)
   return responses;
 }
 
+//each record is: magic(4) header_size(4) body_size(8) header body (network byte order, like ArcoShard)
+static const Uint32 NetFrameMagic = 0x56465231; //"VFR1"
+static const Int64  NetFramePrefixSize = 16;
+static const Int64  NetFrameMaxHeaderSize = 1024 * 1024; //headers are small, anything bigger is a corrupted record
+
+///////////////////////////////////////////////////////////////////
+template <typename T>
+static inline T ToNetworkByteOrder(T value) {
+  return ByteOrder::isNetworkByteOrder() ? value : ByteOrder::swapByteOrder(value);
+}
+
+///////////////////////////////////////////////////////////////////
+bool NetResponse::appendFrame(String id, const NetResponse& response)
+{
+  std::ostringstream out;
+  out << id << "\r\n" << response.status << "\r\n";
+  for (auto it : response.headers)
+    out << it.first << ": " << it.second << "\r\n";
+  String header = out.str();
+
+  Uint32 header_size = (Uint32)header.size();
+  Int64  body_size = response.body ? response.body->c_size() : 0;
+
+  if (!this->body)
+    this->body = std::make_shared<HeapMemory>();
+
+  //amortized growth, records are appended one by one
+  Int64 offset = this->body->c_size();
+  Int64 new_size = offset + NetFramePrefixSize + header_size + body_size;
+  if (new_size > this->body->c_capacity() && !this->body->reserve(std::max(new_size, 2 * this->body->c_capacity()), __FILE__, __LINE__))
+    return false;
+
+  this->body->resize(new_size, __FILE__, __LINE__);
+
+  Uint32 prefix32[2] = { ToNetworkByteOrder(NetFrameMagic), ToNetworkByteOrder(header_size) };
+  Int64  prefix64    = ToNetworkByteOrder(body_size);
+
+  Uint8* p = this->body->c_ptr() + offset;
+  memcpy(p, prefix32 , 8); p += 8;
+  memcpy(p, &prefix64, 8); p += 8;
+  memcpy(p, header.c_str(), header_size); p += header_size;
+  if (body_size)
+    memcpy(p, response.body->c_ptr(), (size_t)body_size);
+
+  return true;
+}
+
+///////////////////////////////////////////////////////////////////
+int NetResponse::readFrame(Int64& offset, String& id, NetResponse& response) const
+{
+  Int64 available = body ? body->c_size() - offset : 0;
+  if (available < NetFramePrefixSize)
+    return 0;
+
+  const Uint8* p = body->c_ptr() + offset;
+
+  Uint32 magic, header_size; Int64 body_size;
+  memcpy(&magic      , p + 0, 4); magic       = ToNetworkByteOrder(magic);
+  memcpy(&header_size, p + 4, 4); header_size = ToNetworkByteOrder(header_size);
+  memcpy(&body_size  , p + 8, 8); body_size   = ToNetworkByteOrder(body_size);
+
+  if (magic != NetFrameMagic)
+  {
+    PrintWarning("wrong frame magic at offset", offset);
+    return -1;
+  }
+
+  //sizes come from the network (NOTE: checking them before summing to avoid overflows)
+  if (header_size > NetFrameMaxHeaderSize || body_size < 0 || body_size > std::numeric_limits<Int64>::max() - NetFramePrefixSize - header_size)
+  {
+    PrintWarning("wrong frame sizes at offset", offset, "header_size", header_size, "body_size", body_size);
+    return -1;
+  }
+
+  if (available < NetFramePrefixSize + header_size + body_size)
+    return 0;
+
+  auto lines = StringUtils::split(String((const char*)p + NetFramePrefixSize, header_size), "\r\n");
+
+  int status = 0;
+  if (lines.size() < 2 || !StringUtils::tryParse(lines[1], status))
+  {
+    PrintWarning("wrong frame header at offset", offset);
+    return -1;
+  }
+
+  id = lines[0];
+  response = NetResponse(status);
+  for (int I = 2; I < (int)lines.size(); I++)
+  {
+    auto sep = lines[I].find(':');
+    if (sep != String::npos)
+      response.setHeader(StringUtils::trim(lines[I].substr(0, sep)), StringUtils::trim(lines[I].substr(sep + 1)));
+  }
+
+  if (body_size)
+    response.body = HeapMemory::createSlice(body, offset + NetFramePrefixSize + header_size, body_size);
+
+  offset += NetFramePrefixSize + header_size + body_size;
+  return 1;
+}
+
 } //namespace Visus
 
@@ -39,6 +39,13 @@ For support : support@visus.net
 #include <Visus/NetServer.h>
 #include <Visus/StringTree.h>
 
+#if __linux__
+#include <sys/epoll.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#endif
+
 namespace Visus {
 
 
@@ -86,14 +93,65 @@ void NetServer::waitForExit() {
 
 
 ///////////////////////////////////////////////////////////////
-bool NetServer::writeResponse(NetSocket* client, NetResponse response)
+bool NetServer::writeResponse(NetSocket* client, NetResponse response, bool bKeepAlive)
 {
-  response.setHeader("Connection", "Close");//in this debug version I don't keep the connections alive!
   response.setHeader("NetServer", "Visus debugging server");//just as double check
   response.setHeader("Access-Control-Allow-Origin", "*");//accept connections from localhost
-  client->sendResponse(response);
+
+  if (bKeepAlive)
+  {
+    //the client needs the Content-Length to know where the next response starts
+    response.setHeader("Connection", "keep-alive");
+    if (!response.body)
+      response.setContentLength(0);
+    return client->sendResponse(response);
+  }
+
+  response.setHeader("Connection", "Close");
+  bool ret = client->sendResponse(response);
   client->shutdownSend();
-  return true;
+  return ret;
+}
+
+///////////////////////////////////////////////////////////////
+bool NetServer::handleNextRequest(NetSocket* client)
+{
+  if (bExitThread)
+  {
+    //maybe the client closed the connection
+    writeResponse(client, NetResponse(HttpStatus::STATUS_INTERNAL_SERVER_ERROR));
+    return false;
+  }
+
+  NetRequest request = client->receiveRequest();
+  if (!request.valid())
+  {
+    //in keep alive mode this is the normal way a client closes the connection
+    if (!keep_alive)
+      writeResponse(client, NetResponse(HttpStatus::STATUS_BAD_REQUEST));
+    return false;
+  }
+
+  bool bKeepAlive = keep_alive && StringUtils::toLower(request.getHeader("Connection")) != "close";
+
+  NetResponse response = module->handleRequest(request);
+  bool bWrote = writeResponse(client, response, bKeepAlive);
+  if (verbose)
+  {
+    if (response.isSuccessful())
+    {
+      if (!bWrote)
+        PrintInfo("Error writing the netresponse to the client, maybe he just dropped the request?");
+      else
+        PrintInfo("Wrote netresponse to the client");
+    }
+    else
+    {
+      PrintInfo("!response.isSuccessful()... skipping it");
+    }
+  }
+
+  return bWrote && bKeepAlive;
 }
 
 
@@ -113,50 +171,177 @@ void NetServer::runInThisThread()
 
   auto thread_pool = std::make_shared<ThreadPool>("HttpServer Worker", nthreads);
 
+#if __linux__
+  if (keep_alive)
+  {
+    runEventLoop(server, thread_pool);
+    thread_pool.reset();
+    return;
+  }
+#endif
+
   //loop accept connections/handle operation
+  std::atomic<int> nconnections(0);
   while (!bExitThread)
   {
     if (auto client = server->acceptConnection())
     {
-      ThreadPool::push(thread_pool,[this, client]()
+      client->setReceiveTimeout(read_timeout);
+      ++nconnections;
+      ThreadPool::push(thread_pool,[this, client, &nconnections]()
+      {
+        //NOTE: without epoll a persistent connection keeps one worker busy until it's closed
+        while (handleNextRequest(client.get()) && waitForNextRequest(client.get(), nconnections))
+          ;
+        --nconnections;
+      });
+    }
+  }
+
+  //wait for jobs referencing the local variables
+  thread_pool->waitAll();
+  thread_pool.reset();
+}
+
+///////////////////////////////////////////////////////////////
+bool NetServer::waitForNextRequest(NetSocket* client, const std::atomic<int>& nconnections)
+{
+  //an idle connection gives its worker back if other connections are waiting for one
+  for (Time t1 = Time::now(); t1.elapsedMsec() < read_timeout; )
+  {
+    if (bExitThread || nconnections > nthreads)
+      return false;
+
+    if (client->waitForData(100))
+      return true;
+  }
+  return false;
+}
+
+#if __linux__
+
+///////////////////////////////////////////////////////////////
+void NetServer::runEventLoop(SharedPtr<NetSocket> server, SharedPtr<ThreadPool> thread_pool)
+{
+  int epollfd = epoll_create1(0);
+  if (epollfd < 0)
+  {
+    PrintError("NetServer epoll_create1 failed", strerror(errno));
+    return;
+  }
+
+  int serverfd = *(int*)server->getNativeHandle();
+
+  struct epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN;
+  ev.data.fd = serverfd;
+  epoll_ctl(epollfd, EPOLL_CTL_ADD, serverfd, &ev);
+
+  //all open connections (a connection is handled at most by one worker at a time, see EPOLLONESHOT)
+  CriticalSection lock;
+  std::map<int, SharedPtr<NetSocket> > clients;
+
+  auto closeClient = [&](int fd) {
+    SharedPtr<NetSocket> client;
+    {
+      ScopedLock lock_clients(lock);
+      auto it = clients.find(fd);
+      if (it == clients.end()) return;
+      client = it->second;
+      clients.erase(it);
+    }
+    epoll_ctl(epollfd, EPOLL_CTL_DEL, fd, nullptr);
+    client->close();
+  };
+
+  const int max_events = 64;
+  struct epoll_event events[max_events];
+
+  while (!bExitThread)
+  {
+    int nevents = epoll_wait(epollfd, events, max_events, /*msec*/100);
+    if (nevents < 0)
+    {
+      if (errno == EINTR) continue;
+      PrintError("NetServer epoll_wait failed", strerror(errno));
+      break;
+    }
+
+    for (int I = 0; I < nevents; I++)
+    {
+      int fd = events[I].data.fd;
+
+      //new connection
+      if (fd == serverfd)
       {
-        if (bExitThread)
+        auto client = server->acceptConnection();
+        if (!client)
+          continue;
+
+        //a worker is busy until the request is complete
+        client->setReceiveTimeout(read_timeout);
+
+        int clientfd = *(int*)client->getNativeHandle();
         {
-          //maybe the client closed the connection
-          writeResponse(client.get(), NetResponse(HttpStatus::STATUS_INTERNAL_SERVER_ERROR));
+          ScopedLock lock_clients(lock);
+          clients[clientfd] = client;
         }
-        else
+
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+        ev.data.fd = clientfd;
+        epoll_ctl(epollfd, EPOLL_CTL_ADD, clientfd, &ev);
+        continue;
+      }
+
+      //some data is ready (or the client closed the connection)
+      SharedPtr<NetSocket> client;
+      {
+        ScopedLock lock_clients(lock);
+        auto it = clients.find(fd);
+        if (it != clients.end()) client = it->second;
+      }
+
+      if (!client)
+        continue;
+
+      if ((events[I].events & (EPOLLERR | EPOLLHUP)) || ((events[I].events & EPOLLRDHUP) && !(events[I].events & EPOLLIN)))
+      {
+        closeClient(fd);
+        continue;
+      }
+
+      ThreadPool::push(thread_pool, [this, client, fd, epollfd, &closeClient]()
+      {
+        if (!handleNextRequest(client.get()))
         {
-          NetRequest request = client->receiveRequest();
-          if (!request.valid())
-          {
-            writeResponse(client.get(), NetResponse(HttpStatus::STATUS_BAD_REQUEST));
-          }
-          else
-          {
-            NetResponse response = module->handleRequest(request);
-            bool bWrote = writeResponse(client.get(), response);
-            if (verbose)
-            {
-              if (response.isSuccessful())
-              {
-                if (!bWrote)
-                  PrintInfo("Error writing the netresponse to the client, maybe he just dropped the request?");
-                else
-                  PrintInfo("Wrote netresponse to the client");
-              }
-              else
-              {
-                PrintInfo("!response.isSuccessful()... skipping it");
-              }
-            }
-          }
+          closeClient(fd);
+          return;
         }
+
+        //re-arm, any pipelined request still in the socket buffer will wake up epoll_wait again
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+        ev.data.fd = fd;
+        epoll_ctl(epollfd, EPOLL_CTL_MOD, fd, &ev);
       });
     }
   }
-  thread_pool.reset();
-}
+
+  //wait for jobs referencing the local variables
+  thread_pool->waitAll();
+
+  for (auto it : clients)
+    it.second->close();
+  clients.clear();
+
+  close(epollfd);
+}
+
+#endif
 
 //waitForExit
 
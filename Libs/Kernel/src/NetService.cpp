@@ -60,6 +60,20 @@ int    NetService::Defaults::proxy_port=0;
 
 ///////////////////////////////////////////////////////////////////////////////////
 #if VISUS_NET
+
+//DNS and TLS sessions are shared between all the NetService instances (i.e. between threads)
+static CURLSH*     curl_share = nullptr;
+static std::mutex  curl_share_locks[CURL_LOCK_DATA_LAST];
+
+static void CurlShareLock(CURL*, curl_lock_data data, curl_lock_access, void*) {
+  curl_share_locks[data].lock();
+}
+
+static void CurlShareUnlock(CURL*, curl_lock_data data, void*) {
+  curl_share_locks[data].unlock();
+}
+
+///////////////////////////////////////////////////////////////////////////////////
 class CurlConnection
 {
 public:
@@ -83,6 +97,10 @@ public:
   bool                             done = false;
   CURLcode                         result = CURLE_OK;
 
+  bool                             keep_alive = false;
+  bool                             http2 = false;
+  bool                             stable_body = false; //body reserved from Content-Length, not reallocated while downloading
+
   //constructor
   CurlConnection(int id_, CURLM*  multi_handle_)
     : id(id_), multi_handle(multi_handle_)
@@ -185,14 +203,33 @@ public:
     memset(errbuf, 0, sizeof(errbuf));
 
     this->first_byte = false;
+    this->stable_body = false;
     this->response_code = 0;
     this->done = false;
     this->result = CURLE_OK;
 
     if (this->request.valid())
     {
-      curl_easy_setopt(this->handle, CURLOPT_FORBID_REUSE, 1L); //not sure if this is the best option (see http://www.perlmonks.org/?node_id=925760)
-      curl_easy_setopt(this->handle, CURLOPT_FRESH_CONNECT, 1L);
+      if (keep_alive)
+      {
+        //connections stay in the multi handle cache and are reused by the next requests to the same host
+        curl_easy_setopt(this->handle, CURLOPT_TCP_KEEPALIVE, 1L);
+
+        if (curl_share)
+          curl_easy_setopt(this->handle, CURLOPT_SHARE, curl_share);
+
+        if (http2)
+        {
+          curl_easy_setopt(this->handle, CURLOPT_HTTP_VERSION, (long)CURL_HTTP_VERSION_2TLS);
+          curl_easy_setopt(this->handle, CURLOPT_PIPEWAIT, 1L); //prefer waiting for a multiplexed connection rather than opening a new one
+        }
+      }
+      else
+      {
+        curl_easy_setopt(this->handle, CURLOPT_FORBID_REUSE, 1L); //not sure if this is the best option (see http://www.perlmonks.org/?node_id=925760)
+        curl_easy_setopt(this->handle, CURLOPT_FRESH_CONNECT, 1L);
+      }
+
       curl_easy_setopt(this->handle, CURLOPT_NOSIGNAL, 1L); //otherwise crash on linux
       curl_easy_setopt(this->handle, CURLOPT_TCP_NODELAY, 1L);
 
@@ -316,8 +353,8 @@ public:
       //avoid too much overhead for writeFunction function
       if (StringUtils::toLower(key) == "content-length")
       {
-        int content_length = cint(value);
-        connection->response.body->reserve(content_length, __FILE__, __LINE__);
+        Int64 content_length = cint64(value);
+        connection->stable_body = connection->response.body->reserve(content_length, __FILE__, __LINE__);
       }
     }
     return(nmemb*size);
@@ -349,6 +386,11 @@ public:
     }
 
     memcpy(connection->response.body->c_ptr() + oldsize, chunk, N);
+
+    //partial body is safe to look at only if it will not be reallocated
+    if (connection->request.on_body_progress && connection->stable_body)
+      connection->request.on_body_progress(connection->response);
+
     return (size_t)(TotIn);
   }
 
@@ -414,9 +456,23 @@ public:
 
     //important to create in this thread
     if (!multi_handle)
+    {
       multi_handle = curl_multi_init();
 
-    return std::make_shared<CurlConnection>(id, multi_handle);
+      if (owner->keep_alive)
+      {
+        curl_multi_setopt(multi_handle, CURLMOPT_MAXCONNECTS, (long)owner->nconnections);
+        curl_multi_setopt(multi_handle, CURLMOPT_PIPELINING, owner->http2 ? CURLPIPE_MULTIPLEX : CURLPIPE_NOTHING);
+      }
+
+      if (owner->max_connections_per_host > 0)
+        curl_multi_setopt(multi_handle, CURLMOPT_MAX_HOST_CONNECTIONS, (long)owner->max_connections_per_host);
+    }
+
+    auto ret = std::make_shared<CurlConnection>(id, multi_handle);
+    ret->keep_alive = owner->keep_alive;
+    ret->http2 = owner->http2;
+    return ret;
   }
 
 
@@ -645,6 +701,10 @@ public:
   {
     connection->request.statistics.run_msec = (int)connection->request.statistics.run_t1.elapsedMsec();
 
+    long num_connects = 0;
+    if (curl_easy_getinfo(connection->handle, CURLINFO_NUM_CONNECTS, &num_connects) == CURLE_OK && num_connects > 0)
+      NetService::global_stats()->new_connections += num_connects;
+
     if (owner->verbose > 0 && !connection->request.aborted())
       owner->printStatistics(connection->id, connection->request, connection->response);
 
@@ -661,6 +721,12 @@ public:
 
 /////////////////////////////////////////////////////////////////////////////
 NetService::NetService(int nconnections_, bool bVerbose)
+  : NetService(nconnections_, StringTree(), bVerbose)
+{
+}
+
+/////////////////////////////////////////////////////////////////////////////
+NetService::NetService(int nconnections_, const StringTree& config, bool bVerbose)
   : nconnections(nconnections_), verbose(bVerbose)
 {
   {
@@ -669,6 +735,14 @@ NetService::NetService(int nconnections_, bool bVerbose)
       verbose = cint(s_verbose);
   }
 
+  readOptions(config);
+
+  if (http2 && !(curl_version_info(CURLVERSION_NOW)->features & CURL_VERSION_HTTP2))
+  {
+    PrintWarning("libcurl has no HTTP/2 support, using HTTP/1.1 with keep-alive");
+    http2 = false;
+  }
+
   this->pimpl = new Pimpl(this);
   this->pimpl->start();
 }
@@ -686,12 +760,24 @@ void NetService::attach()
 {
   int retcode = curl_global_init(CURL_GLOBAL_ALL);
   VisusReleaseAssert(retcode == 0);
+
+  curl_share = curl_share_init();
+  curl_share_setopt(curl_share, CURLSHOPT_LOCKFUNC, CurlShareLock);
+  curl_share_setopt(curl_share, CURLSHOPT_UNLOCKFUNC, CurlShareUnlock);
+  curl_share_setopt(curl_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+  curl_share_setopt(curl_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
 }
 
 
 /////////////////////////////////////////////////////////////////////////////
 void NetService::detach()
 {
+  if (curl_share)
+  {
+    curl_share_cleanup(curl_share);
+    curl_share = nullptr;
+  }
+
   curl_global_cleanup();
 }
 
@@ -723,6 +809,11 @@ NetService::NetService(int nconnections_, bool bVerbose)
   : nconnections(nconnections_), verbose(bVerbose){
 }
 
+NetService::NetService(int nconnections_, const StringTree& config, bool bVerbose)
+  : nconnections(nconnections_), verbose(bVerbose) {
+  readOptions(config);
+}
+
 NetService::~NetService() {
 }
 
@@ -741,6 +832,19 @@ Future<NetResponse> NetService::handleAsync(SharedPtr<NetRequest> request)
 
 #endif
 
+/////////////////////////////////////////////////////////////////////////////
+void NetService::readOptions(const StringTree& config)
+{
+  //opt-in, environment variables change the default for all the services
+  this->keep_alive = config.readBool("keep_alive", cbool(Utils::getEnv("VISUS_NETSERVICE_KEEP_ALIVE", "0")));
+  this->http2 = config.readBool("http2", cbool(Utils::getEnv("VISUS_NETSERVICE_HTTP2", "0")));
+  this->max_connections_per_host = config.readInt("max_connections_per_host", cint(Utils::getEnv("VISUS_NETSERVICE_MAX_CONNECTIONS_PER_HOST", "0")));
+
+  //multiplexing needs connections to stay open
+  if (this->http2)
+    this->keep_alive = true;
+}
+
 /////////////////////////////////////////////////////////////////////////////
 NetResponse NetService::getNetResponse(NetRequest request)
 {
@@ -85,6 +85,41 @@ public:
     ::shutdown(socketfd, SHUT_WR);
   }
 
+  //setReceiveTimeout
+  void setReceiveTimeout(int msec)
+  {
+    if (socketfd<0) return;
+#if WIN32
+    DWORD value = msec;
+#else
+    struct timeval value;
+    value.tv_sec = msec / 1000;
+    value.tv_usec = (msec % 1000) * 1000;
+#endif
+    setsockopt(socketfd, SOL_SOCKET, SO_RCVTIMEO, (const char*)&value, sizeof(value));
+  }
+
+  //waitForData
+  bool waitForData(int msec)
+  {
+    if (socketfd<0) return false;
+
+#if !WIN32
+    //cannot use select, a blocking receive will tell
+    if (socketfd >= FD_SETSIZE)
+      return true;
+#endif
+
+    fd_set fds;
+    FD_ZERO(&fds);
+    FD_SET(socketfd, &fds);
+
+    struct timeval timeout;
+    timeout.tv_sec = msec / 1000;
+    timeout.tv_usec = (msec % 1000) * 1000;
+    return ::select(socketfd + 1, &fds, nullptr, nullptr, &timeout) > 0;
+  }
+
   //connect
   bool connect(String url_) 
   {
@@ -357,9 +392,16 @@ private:
     while (len)
     {
       int n = (int)::recv(socketfd, (char*)buf, len, flags);
-      if (n <= 0)
+
+      //closed by the peer, this is not an error (e.g. a client closing a persistent connection)
+      if (n == 0)
+        return false;
+
+      if (n < 0)
       {
-        PrintError("Failed to recv data to socket errdescr",getSocketErrorDescription(n));
+        //see setReceiveTimeout
+        if (!isTimeout())
+          PrintError("Failed to recv data to socket errdescr",getSocketErrorDescription(n));
         return false;
       }
       buf += n;
@@ -368,6 +410,16 @@ private:
     return true;
   }
 
+  //isTimeout
+  static inline bool isTimeout()
+  {
+#if WIN32
+    return WSAGetLastError() == WSAETIMEDOUT;
+#else
+    return errno == EAGAIN || errno == EWOULDBLOCK;
+#endif
+  }
+
   //getSocketErrorDescription
   static inline const char* getSocketErrorDescription(int retcode)
   {
@@ -429,6 +481,10 @@ NetSocket::~NetSocket() {
   if (pimpl) delete pimpl;
 }
 
+void* NetSocket::getNativeHandle() {
+  return pimpl->getNativeHandle();
+}
+
 void NetSocket::shutdownSend() {
   return pimpl->shutdownSend();
 }
@@ -437,6 +493,14 @@ void NetSocket::close() {
   return pimpl->close();
 }
 
+void NetSocket::setReceiveTimeout(int msec) {
+  return pimpl->setReceiveTimeout(msec);
+}
+
+bool NetSocket::waitForData(int msec) {
+  return pimpl->waitForData(msec);
+}
+
 bool NetSocket::connect(String url) {
   return pimpl->connect(url);
 }
@@ -40,9 +40,84 @@ For support : support@visus.net
 
 namespace Visus {
 
+//the pool/worker the current thread belongs to (used to push nested jobs to the local queue)
+static thread_local ThreadPool* current_pool   = nullptr;
+static thread_local int         current_worker = -1;
+
+////////////////////////////////////////////////////////////
+class ThreadPool::Worker
+{
+public:
+
+  CriticalSection     lock;
+  std::deque<Task>    tasks;
+  std::atomic<Int64>  size;
+
+  //constructor
+  Worker() : size(0) {
+  }
+
+  //pop (the owner and the thieves both take the oldest job, so a single worker pool stays FIFO)
+  bool pop(Task& task)
+  {
+    if (!size.load(std::memory_order_relaxed))
+      return false;
+
+    ScopedLock lock(this->lock);
+    if (tasks.empty())
+      return false;
+
+    task = std::move(tasks.front());
+    tasks.pop_front();
+    size--;
+    return true;
+  }
+
+};
+
+////////////////////////////////////////////////////////////
+static CriticalSection& SharedPoolLock() {
+  static CriticalSection ret;
+  return ret;
+}
+
+static SharedPtr<ThreadPool> shared_pool;
+
+////////////////////////////////////////////////////////////
+SharedPtr<ThreadPool> ThreadPool::getShared()
+{
+  ScopedLock lock(SharedPoolLock());
+  if (!shared_pool)
+  {
+    int nthreads = std::max(1, (int)std::thread::hardware_concurrency());
+    if (auto env = getenv("VISUS_NUM_THREADS"))
+      nthreads = std::max(1, cint(env));
+    shared_pool = std::make_shared<ThreadPool>("Shared Worker", nthreads);
+  }
+  return shared_pool;
+}
+
+////////////////////////////////////////////////////////////
+void ThreadPool::releaseShared()
+{
+  SharedPtr<ThreadPool> pool;
+  {
+    ScopedLock lock(SharedPoolLock());
+    pool.swap(shared_pool);
+  }
+  //the last reference joins the workers (outside the lock)
+  pool.reset();
+}
+
 ////////////////////////////////////////////////////////////
 ThreadPool::ThreadPool(String basename,int num_workers) 
+  : npending(0), nactive(0), nsleeping(0), next_worker(0), bExit(false)
 {
+  num_workers = std::max(1, num_workers);
+
+  for (int I = 0; I < num_workers; I++)
+    this->workers.push_back(std::make_shared<Worker>());
+
   for (int I=0;I<num_workers;I++)
   {
     String thread_name = basename + " " + cstring(I);
@@ -56,115 +131,160 @@ ThreadPool::ThreadPool(String basename,int num_workers)
 ////////////////////////////////////////////////////////////
 ThreadPool::~ThreadPool()
 {
-  //each worker should get only one!
-  for (auto thread : threads)
-    asyncRun(std::function<void()>());
+  //workers drain all the queued jobs before exiting
+  {
+    ScopedLock lock(idle_lock);
+    bExit = true;
+    idle_cv.notify_all();
+  }
 
   for (auto thread : threads) 
     Thread::join(thread);
 
-  #ifdef _DEBUG
-  {
-    ScopedLock lock(this->lock);
-    int total_jobs=(int)waiting.size()+(int)running.size();
-    VisusAssert(total_jobs==0);
-  }
-  #endif
+  VisusAssert(npending == 0 && nactive == 0);
 }
 
 
 ////////////////////////////////////////////////////////////
-void ThreadPool::asyncRun(std::function<void()> run)
+void ThreadPool::asyncRun(Task task)
 {
-  {
-    ScopedLock lock(wait_all.lock);
-    wait_all.num_inside++;
-  }
-
+  nactive++;
   ThreadPool::global_stats()->running_jobs++;
 
+  int N = (int)workers.size();
+  int W = (current_pool == this) ? current_worker : (int)(next_worker++ % N);
+
   {
-    ScopedLock lock(this->lock);
-    waiting.push_back(std::make_shared<std::function<void()>>(run));
+    auto worker = workers[W];
+    ScopedLock lock(worker->lock);
+    worker->tasks.push_back(std::move(task));
+    worker->size++;
   }
 
-  nwaiting.up();
-}
+  npending++;
 
-////////////////////////////////////////////////////////////
-void ThreadPool::push(SharedPtr<ThreadPool> pool, std::function<void()> fn) {
-  if (pool)
-    pool->asyncRun(fn);
-  else
-    fn();
+  if (nsleeping > 0)
+  {
+    ScopedLock lock(idle_lock);
+    idle_cv.notify_one();
+  }
 }
 
-
 ////////////////////////////////////////////////////////////
-void ThreadPool::waitAll() 
+bool ThreadPool::popTask(int worker, Task& task)
 {
-  while (true)
+  int N = (int)workers.size();
+  for (int K = 0; K < N; K++)
   {
+    if (workers[(worker + K) % N]->pop(task))
     {
-      ScopedLock lock(wait_all.lock);
-      if (!wait_all.num_inside)
-        return;
+      npending--;
+      return true;
     }
+  }
+  return false;
+}
 
-    //note: possible deadlocks if I have the python GIL here
-    wait_all.num_done.down();
+////////////////////////////////////////////////////////////
+void ThreadPool::runTask(Task& task)
+{
+  task();
+  task.reset();
 
-    {
-      ScopedLock lock(wait_all.lock);
-      --wait_all.num_inside;
-    }
+  ThreadPool::global_stats()->running_jobs--;
 
+  if (--nactive == 0)
+  {
+    ScopedLock lock(done_lock);
+    done_cv.notify_all();
   }
+}
+
+////////////////////////////////////////////////////////////
+void ThreadPool::waitAll() 
+{
+  //note: possible deadlocks if I have the python GIL here
+  std::unique_lock<CriticalSection> lock(done_lock);
+  done_cv.wait(lock, [this]() {return nactive == 0; });
 };
 
 
 ////////////////////////////////////////////////////////////
 void ThreadPool::workerEntryProc(int worker)
 {
+  current_pool   = this;
+  current_worker = worker;
+
+  const int MaxSpin = 64;
+
+  Task task;
   while (true)
   {
-    this->nwaiting.down();
-
-    //waiting->running
-    SharedPtr<std::function<void()> > fn;
+    if (popTask(worker, task))
     {
-      ScopedLock lock(this->lock);
-      fn = this->waiting.front();
-      this->waiting.pop_front();
-      this->running.insert(fn);
+      runTask(task);
+      continue;
     }
 
-    bool bExit = *fn ? false : true;
-
-    if (!bExit)
-      (*fn)();
-
-    //remove from running
+    //spin a little before going to sleep, jobs often come in bursts
+    bool bWakeUp = false;
+    for (int Spin = 0; !bWakeUp && Spin < MaxSpin; Spin++)
     {
-      ScopedLock lock(this->lock);
-      VisusAssert(running.find(fn) != running.end());
-      this->running.erase(fn);
+      std::this_thread::yield();
+      bWakeUp = npending > 0 || bExit;
     }
 
-    ThreadPool::global_stats()->running_jobs--;
-
-    //for the wait all function
+    if (!bWakeUp)
     {
-      ScopedLock lock(wait_all.lock);
-      wait_all.num_done.up();
+      std::unique_lock<CriticalSection> lock(idle_lock);
+      nsleeping++;
+      idle_cv.wait(lock, [this]() {return npending > 0 || bExit; });
+      nsleeping--;
     }
 
-    if (bExit)
+    if (bExit && npending == 0)
       break;
   }
+
+  current_pool   = nullptr;
+  current_worker = -1;
+}
+
+////////////////////////////////////////////////////////////
+void ThreadPool::TaskGroup::done()
+{
+  //decrement under lock, so wait() cannot return (and the group be destroyed) while I am still notifying
+  ScopedLock lock(this->lock);
+  --npending;
+  cv.notify_all();
 }
 
+////////////////////////////////////////////////////////////
+void ThreadPool::TaskGroup::waitBelow(Int64 value)
+{
+  if (!pool)
+    return;
 
-} //namespace Visus
+  //help running jobs instead of blocking a worker (otherwise nested groups could deadlock the pool)
+  if (current_pool == pool.get())
+  {
+    Task task;
+    while (npending >= value)
+    {
+      if (pool->popTask(current_worker, task))
+      {
+        pool->runTask(task);
+        continue;
+      }
+
+      //nothing to run: sleep until a job of the group is done (timed, since jobs pushed meanwhile need help too)
+      std::unique_lock<CriticalSection> lock(this->lock);
+      cv.wait_for(lock, std::chrono::milliseconds(1), [this, value]() {return npending < value; });
+    }
+  }
 
+  std::unique_lock<CriticalSection> lock(this->lock);
+  cv.wait(lock, [this, value]() {return npending < value; });
+}
 
+} //namespace Visus
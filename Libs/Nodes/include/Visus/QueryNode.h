@@ -183,6 +183,16 @@ public:
     setProperty("SetViewDependentEnabled", this->view_dependent_enabled, value);
   }
 
+  //isReuseEnabled (a new query copies the samples of the previous result instead of reading them again, e.g. panning/zooming)
+  bool isReuseEnabled() const {
+    return reuse_enabled;
+  }
+
+  //setReuseEnabled
+  void setReuseEnabled(bool value) {
+    this->reuse_enabled = value;
+  }
+
   //exitFromDataflow (to avoid dataset stuck in memory)
   virtual void exitFromDataflow() override;
 
@@ -223,6 +233,22 @@ private:
   Frustum            node_to_screen;
   Position           query_bounds;
 
+  //last result, see BoxQuery::reuse
+  class LastResult
+  {
+  public:
+    SharedPtr<Dataset> dataset;
+    String             fieldname;
+    double             time = 0;
+    Array              buffer;
+    LogicSamples       logic_samples;
+    std::vector<BoxNi> failed_boxes;
+  };
+
+  bool               reuse_enabled = true;
+  CriticalSection    last_result_lock;
+  LastResult         last_result;
+
   //modelChanged
   virtual void modelChanged() override {
     if (dataflow)
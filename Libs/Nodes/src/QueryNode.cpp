@@ -144,6 +144,18 @@ public:
         query->end_resolutions.push_back(H);
       }
 
+      //samples of the previous result (e.g. before panning/zooming) do not need to be read again
+      {
+        ScopedLock lock(node->last_result_lock);
+        const auto& last = node->last_result;
+        if (node->reuse_enabled && last.dataset == dataset && last.fieldname == field.name && last.time == time)
+        {
+          query->reuse.buffer = last.buffer;
+          query->reuse.logic_samples = last.logic_samples;
+          query->reuse.failed_boxes = last.failed_boxes;
+        }
+      }
+
       this->box_query = query;
     }
   }
@@ -210,10 +222,23 @@ public:
         if (aborted())
           return;
 
+        //keep it for the next query
+        if (!query->filter.dataset_filter)
+        {
+          ScopedLock lock(node->last_result_lock);
+          auto& last = node->last_result;
+          last.dataset = dataset;
+          last.fieldname = field.name;
+          last.time = time;
+          last.buffer = query->buffer;
+          last.logic_samples = query->logic_samples;
+          last.failed_boxes = query->failed_boxes;
+        }
+
         auto output = query->buffer;
         output.run_time_attributes.setValue("origin", node->getName()); //origin
         PrintInfo("BoxQuery executeBoxQuery", node->getName(), I, "/", N, "/", EndH, "/", dataset->getMaxResolution(),"done in", t1.elapsedMsec(),"msec",
-          "dims", output.dims,"dtype", output.dtype,
+          "dims", output.dims,"dtype", output.dtype, "reused-blocks", query->reuse.nskipped,
           "mem", StringUtils::getStringFromByteSize(output.c_size()),
           "access", access ? "yes" : "nullptr",
           "url", dataset->getUrl());
@@ -498,6 +523,9 @@ void QueryNode::exitFromDataflow()
 {
   Node::exitFromDataflow();
   this->access.reset();
+
+  ScopedLock lock(last_result_lock);
+  this->last_result = LastResult();
 }
 
 //////////////////////////////////////////////////////////////////
@@ -3,6 +3,7 @@
 %{ 
 #include <Visus/Db.h>
 #include <Visus/StringTree.h>
+#include <Visus/BlockSummary.h>
 #include <Visus/Access.h>
 #include <Visus/Query.h>
 #include <Visus/BlockQuery.h>
@@ -81,6 +82,7 @@ def LoadIdxDataset(url):
 %ignore Visus::DbModule::attach;
 
 %include <Visus/Db.h>
+%include <Visus/BlockSummary.h>
 %include <Visus/Access.h>
 %include <Visus/LogicSamples.h>
 %include <Visus/Query.h>
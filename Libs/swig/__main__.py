@@ -274,6 +274,7 @@ def RunServer(args):
 	parser.add_argument("-p", "--port", type=int, help="Server port.", required=False,default=10000)
 	parser.add_argument("-d", "--dataset", type=str, help="Idx file", required=False,default="")
 	parser.add_argument("-e", "--exit", help="Exit immediately", action="store_true") # for debugging
+	parser.add_argument("-k", "--keep-alive", help="Persistent connections (epoll on linux)", action="store_true")
 	args = parser.parse_args(args)
 
 	modvisus = ModVisus()
@@ -286,6 +287,7 @@ def RunServer(args):
 			
 	modvisus.configureDatasets(config)
 	server=NetServer(args.port, modvisus)
+	server.setKeepAlive(args.keep_alive)
 	print("Running visus server on port",args.port)
 
 	if args.exit:
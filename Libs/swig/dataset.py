@@ -621,6 +621,27 @@ class PyDataset(object):
 		self.db.idxfile.save(url)
 		self.db=LoadDatasetCpp(url)
 		
+	# recompressDataset (native version of compressDataset/copyBlocks, see `visus recompress help`)
+	#   dst=None means in place, one file at a time
+	#   compression: one for each level (the last one is the finest), None means copy blocks as they are stored
+	#   an interrupted run is resumed from the last file done
+	def recompressDataset(self, dst=None, compression="zip", num_threads=0, resume=True):
+		args=["recompress", self.getUrl()]
+		if dst: 
+			args.append(str(dst))
+		if isinstance(compression, (list, tuple)):
+			compression=" ".join(compression)
+		if compression is not None:
+			args+=["--compression", compression]
+		args+=["--nthreads", str(num_threads)]
+		if not resume:
+			args.append("--no-resume")
+		VisusConvert().runFromArgs(args)
+
+		# the idx file can be changed (i.e. field default_compression)
+		if not dst:
+			self.db=LoadDatasetCpp(self.getUrl())
+
 	# copyBlocks
 	def copyBlocks(self, dst, time=None, field=None, num_read_per_request=1, verbose=False):
 	
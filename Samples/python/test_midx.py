@@ -0,0 +1,64 @@
+import numpy as np
+import OpenVisus as ov
+import os
+import shutil
+import unittest
+
+TMP = "tmp/test_midx"
+
+# derived fields compiled by IdxMultipleExpression (native) and the same code run by the python engine must give the same samples
+EXPRESSIONS = [
+	"output=input.A.data+input.B.data",
+	"output=input.A.data*3-input.B.data/2",
+	"output=ArrayUtils.average([input.A.data,input.B.data])",
+	"output=ArrayUtils.max([input.A.data,input.B.data])",
+	"output=ArrayUtils.cast(input.A.data, DType.fromString('float32'))*0.5",
+	"output=ArrayUtils.sqrt(input.B.data)",
+	"output=input.C.data",
+	"output=ArrayUtils.max([input.C.data,input.C.data])",
+	"output=ArrayUtils.cast(input.C.data, 'float64')",
+]
+
+class TestMidx(unittest.TestCase):
+
+	def setUp(self):
+		shutil.rmtree(TMP, ignore_errors=True)
+		rng = np.random.default_rng(0)
+		datas = {
+			"A": rng.integers(0, 1 << 20, size=(32, 32)).astype(np.int32),
+			"B": rng.random(size=(32, 32)).astype(np.float32) * 100,
+			"C": rng.integers(1 << 53, 1 << 62, size=(32, 32)).astype(np.int64), # not representable as double
+		}
+		self.datas = datas
+		for name, data in datas.items():
+			field = ov.Field("data", str(data.dtype), "row_major")
+			db = ov.CreateIdx(url=f"{TMP}/{name}/visus.idx", dim=2, dims=list(reversed(data.shape)), fields=[field])
+			db.write(data)
+
+	def tearDown(self):
+		shutil.rmtree(TMP, ignore_errors=True)
+
+	def loadMidx(self, native):
+		filename = f"{TMP}/native_{native}.midx"
+		with open(filename, "wt") as f:
+			f.write(f"<dataset typename='IdxMultipleDataset' native_expressions='{'true' if native else 'false'}'>\n")
+			for name in self.datas:
+				f.write(f"\t<dataset url='./{name}/visus.idx' name='{name}' />\n")
+			f.write("</dataset>\n")
+		return ov.LoadDataset(filename)
+
+	def test_native_vs_python(self):
+		native, python = self.loadMidx(True), self.loadMidx(False)
+		for code in EXPRESSIONS:
+			a = native.read(field=code)
+			b = python.read(field=code)
+			self.assertEqual(a.dtype, b.dtype, code)
+			self.assertTrue(np.array_equal(a, b), code)
+
+	def test_int64_exact(self):
+		midx = self.loadMidx(True)
+		self.assertTrue(np.array_equal(midx.read(field="output=input.C.data"), self.datas["C"]))
+
+
+if __name__ == '__main__':
+	unittest.main()